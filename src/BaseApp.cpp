@@ -3,6 +3,14 @@
 #include <stdarg.h>
 
 #include <Server/ENetServer.h>
+#include <Items/ItemInfoPublisher.h>
+#include <World/WorldStore.h>
+#include <World/WorldIOService.h>
+#include <World/WorldJournal.h>
+#include <World/WorldScheduler.h>
+#include <World/WorldTemplatePool.h>
+#include <GrowRender/TextureCache.h>
+#include <GrowRender/WorldThumbnailer.h>
 
 #include <Client/GameClient.h>
 
@@ -211,8 +219,31 @@ void BaseApp::Init()
 	GetGrowConfig()->Load(m_config);
 
 	//GetItemInfoManager()->LoadFile();
-	GetItemInfoManager()->Load();
-	GetItemInfoManager()->Serialize(5);
+	GetItemInfoPublisher()->Load();
+	GetWorldStore()->Init();
+	GetWorldTemplatePool()->Start();
+	GetWorldIOService()->Start();
+	if (GetWorldStore()->IsLoaded())
+	{
+		// tile changes are only journaled for worlds that are stored
+		GetWorldJournal()->Start();
+	}
+
+	GetWorldScheduler()->Start();
+	if (!GetConfig().worldImagePath.empty())
+	{
+		GetTextureCache()->Init();
+		GetTextureCache()->Start();
+		GetWorldThumbnailer()->Start(GetConfig().worldRenderThreads);
+	}
 
 	GetENetServer()->Run(GetConfig().address.c_str(), GetConfig().basePort);
+
+	// server stopped, writing the worlds that are still waiting to be saved
+	GetWorldScheduler()->Stop();
+	GetWorldIOService()->Stop();
+	GetWorldJournal()->Stop();
+	GetWorldTemplatePool()->Stop();
+	GetWorldThumbnailer()->Stop();
+	GetTextureCache()->Stop();
 }
\ No newline at end of file
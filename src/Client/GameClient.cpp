@@ -2,6 +2,7 @@
 
 #include <Client/GameClient.h>
 #include <World/World.h>
+#include <World/WorldScheduler.h>
 
 GameClient::GameClient(ENetPeer * pConnectionPeer)
 {
@@ -49,7 +50,7 @@ nova_str GameClient::GetDisplayName()
 
 	if (m_pWorld && m_pWorld->GetWorldLockIndex() != 0 && m_pWorld->GetWorldOwnerID() != -1)
 	{
-		Tile * pLockTile = m_pWorld->GetWorldTileMap()->GetTile(m_pWorld->GetWorldLockIndex());
+		Tile pLockTile = m_pWorld->GetWorldTileMap()->GetTile(m_pWorld->GetWorldLockIndex());
 		if (pLockTile == NULL)
 		{
 			// lock tile not found
@@ -363,7 +364,60 @@ void GameClient::SendPacketRaw(eNetMessageType messageType, const void* pRawData
 		std::memcpy(pClientPacket->data + 4, pRawData, packetLen);
 	}
 
-	if (enet_peer_send(m_pConnectionPeer, 0, pClientPacket) != 0)
+	if (!Deliver(pClientPacket))
+	{
+		enet_packet_destroy(pClientPacket);
+	}
+}
+
+bool GameClient::SendENetPacket(ENetPacket* pPacket)
+{
+	if (m_pConnectionPeer == NULL || m_pConnectionPeer->state != ENET_PEER_STATE_CONNECTED || pPacket == NULL)
+	{
+		return false;
+	}
+
+	// the packet is not destroyed on failure, the caller owns it until a peer took a reference
+	return Deliver(pPacket);
+}
+
+bool GameClient::Deliver(ENetPacket* pPacket)
+{
+	if (GetWorldScheduler()->IsWorldThread())
+	{
+		// enet isn't thread safe, the event loop sends it once the worlds are done
+		GetWorldScheduler()->QueueSend(m_pConnectionPeer, pPacket);
+		return true;
+	}
+
+	return enet_peer_send(m_pConnectionPeer, 0, pPacket) == 0;
+}
+
+void GameClient::SendPacketExtended(eNetMessageType messageType, const GameUpdatePacket* pPacket, const void* pExtendedData, const enet_uint32& packetFlags)
+{
+	// same as SendPacketRaw, but the extended data doesn't have to follow the packet header in memory
+	// the header and the data are copied straight into the enet packet, no intermediate buffer
+	if (m_pConnectionPeer == NULL || m_pConnectionPeer->state != ENET_PEER_STATE_CONNECTED || pPacket == NULL)
+	{
+		return;
+	}
+
+	const uint32_t extendedLen = pExtendedData != NULL ? pPacket->dataLength : 0;
+	ENetPacket * pClientPacket = enet_packet_create(NULL, 5 + GUP_SIZE + extendedLen, packetFlags);
+	if (pClientPacket == NULL)
+	{
+		return;
+	}
+
+	std::memcpy(pClientPacket->data, &messageType, 4);
+	std::memcpy(pClientPacket->data + 4, pPacket, GUP_SIZE);
+	if (extendedLen != 0)
+	{
+		std::memcpy(pClientPacket->data + 4 + GUP_SIZE, pExtendedData, extendedLen);
+	}
+
+	pClientPacket->data[4 + GUP_SIZE + extendedLen] = 0;
+	if (!Deliver(pClientPacket))
 	{
 		enet_packet_destroy(pClientPacket);
 	}
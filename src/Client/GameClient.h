@@ -163,6 +163,8 @@ public:
 	void                SendPacket(eNetMessageType messageType, const std::string& textData);
 
 	void                SendPacketRaw(eNetMessageType messageType, const void* pRawData, const uintmax_t& packetLen, const enet_uint32& packetFlags = ENET_PACKET_FLAG_RELIABLE);
+	bool                SendENetPacket(ENetPacket* pPacket); // for packets shared between peers, enet frees it once every peer sent it
+	void                SendPacketExtended(eNetMessageType messageType, const GameUpdatePacket* pPacket, const void* pExtendedData, const enet_uint32& packetFlags = ENET_PACKET_FLAG_RELIABLE);
 	void                SendVariantPacket(VariantList variant, const int& netID = -1, const int& delayMS = 0);
 	void                SendInventoryState();
 
@@ -172,6 +174,8 @@ public:
 
 
 private:
+	bool                Deliver(ENetPacket* pPacket); // enet_peer_send, or the outbox of the world thread we're on
+
 	ENetPeer            *m_pConnectionPeer = NULL; // the connection peer
 	World               *m_pWorld = NULL; // the world pointer we are located in
 
@@ -33,6 +33,11 @@ bool GrowConfig::Load(Config& conf)
 	conf.enetMaxPeers = t.GetParmInt("max_clients", 1);
 	conf.maxPlayersInWorld = t.GetParmInt("max_clients_per_world", 1);
 	conf.daysToDeleteLock = t.GetParmInt("days_required_to_delete_lock", 1);
+	conf.delayedWorldDeleteTimeMS = t.GetParmInt("delayed_world_delete_time_ms", 1);
+	conf.worldCacheBudgetMB = t.GetParmInt("world_cache_budget_mb", 1);
+	conf.autoSaveSeconds = t.GetParmInt("auto_save_seconds", 1);
+	conf.worldImagePath = t.GetParmString("world_image_path", 1);
+	conf.worldRenderThreads = t.GetParmInt("world_render_threads", 1);
 	conf.bDisableGamePack = (bool)t.GetParmInt("disable_gamepack", 1);
 	conf.bCollidateDrops = (bool)t.GetParmInt("consolidate_drops", 1);
 	conf.bWorldBalance = (bool)t.GetParmInt("world_balance", 1);
@@ -93,6 +98,9 @@ bool GrowConfig::Reload(Config& conf)
 
 	conf.maxPlayersInWorld = t.GetParmInt("max_clients_per_world", 1);
 	conf.daysToDeleteLock = t.GetParmInt("days_required_to_delete_lock", 1);
+	conf.delayedWorldDeleteTimeMS = t.GetParmInt("delayed_world_delete_time_ms", 1);
+	conf.worldCacheBudgetMB = t.GetParmInt("world_cache_budget_mb", 1);
+	conf.autoSaveSeconds = t.GetParmInt("auto_save_seconds", 1);
 	conf.bDisableGamePack = (bool)t.GetParmInt("disable_gamepack", 1);
 	conf.bCollidateDrops = (bool)t.GetParmInt("consolidate_drops", 1);
 	conf.bWorldBalance = (bool)t.GetParmInt("world_balance", 1);
@@ -19,6 +19,7 @@ struct Config
 
 	std::string downloadServerURL = "";
 	std::string downloadServerPath = "";
+	std::string worldImagePath = ""; // where world thumbnails are rendered to, empty turns them off
 
 	bool        bBetaServer = false;
 	std::string betaMsg = "";
@@ -34,6 +35,10 @@ struct Config
 	int         maxPlayersInWorld = 60;
 	int         daysToDeleteLock = 179;
 	uint8_t     mapVersion = 5;
+	int         delayedWorldDeleteTimeMS = 120000; // how long an empty world stays cached before it can be evicted
+	int         worldCacheBudgetMB = 256; // memory budget of the worlds in memory, empty worlds are evicted above it
+	int         autoSaveSeconds = 3600; // how often changed worlds are saved while players are in them
+	int         worldRenderThreads = 2; // threads rendering world thumbnails into worldImagePath
 
 
 	double      gemsMultiplier = 1.0;
@@ -8,19 +8,19 @@ GrowRenderCache g_renderCache;
 GrowRenderCache * GetGrowCache() { return &g_renderCache; }
 
 
-RTFont GrowRenderCache::GetFont(eFontTypes font)
+const RTFont& GrowRenderCache::GetFont(eFontTypes font) const
 {
     switch (font)
     {
-        case eFontTypes::SMALL_FONT:
-            return m_smallFont;
-
         case eFontTypes::BIG_FONT:
             return m_bigFont;
+
+        default:
+            return m_smallFont;
     }
 }
 
-void GrowRenderCache::SetActiveFile(RTTEX& tex, const std::string& fName, const bool& bUseIconTex)
+const RTTEX* GrowRenderCache::GetTexture(const std::string& fName, const bool& bUseIconTex) const
 {
     nova_str texture_name = fName;
     bool bDirectoryFound = fName.find('/') != std::string::npos;
@@ -30,14 +30,13 @@ void GrowRenderCache::SetActiveFile(RTTEX& tex, const std::string& fName, const
         texture_name = "game/" + texture_name + "";
     }
 
-    // setting the texture
+    // handing out the one we hold, copying a texture copies it on the gpu
     auto it = m_textures.find(texture_name);
     if (it == m_textures.end())
     {
         // texture not found
-        tex = RTTEX();
-        return;
+        return NULL;
     }
 
-    tex = it->second;
+    return &it->second;
 }
\ No newline at end of file
@@ -26,14 +26,14 @@ public:
 
 
     // get
-    std::unordered_map<std::string, RTTEX>       GetTextures() const { return m_textures; }
-    RTFont                                       GetFont(eFontTypes font);          
+    const std::unordered_map<std::string, RTTEX>& GetTextures() const { return m_textures; }
+    const RTTEX                                  *GetTexture(const std::string& fName, const bool& bUseIconTex = false) const; // NULL if it isn't loaded, valid until the textures change
+    const RTFont                                 &GetFont(eFontTypes font) const;
 
     // set
 
 
     // fn
-    void                                         SetActiveFile(RTTEX& tex, const std::string& fName, const bool& bUseIconTex = false);
 
 private:
     RTFont                                       m_smallFont;
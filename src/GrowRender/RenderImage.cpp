@@ -0,0 +1,182 @@
+#include <BaseApp.h> // precompiled
+#include <GrowRender/RenderImage.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RENDER_IMAGE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <SDK/Proton/RTTEX.h>
+
+// sfml-graphics carries its own copy, ours stays inside this file
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image/stb_image_write.h>
+
+RenderImage::RenderImage(const int& width, const int& height, const uint32_t& color)
+{
+    m_width = std::max(0, width);
+    m_height = std::max(0, height);
+    m_pixels.assign((size_t)m_width * m_height, color);
+}
+
+void RenderImage::SetPixels(const int& width, const int& height, const void* pPixels)
+{
+    m_width = std::max(0, width);
+    m_height = std::max(0, height);
+    m_pixels.resize((size_t)m_width * m_height);
+    std::memcpy(m_pixels.data(), pPixels, m_pixels.size() * sizeof(uint32_t));
+}
+
+bool RenderImage::LoadRTTex(const std::string& fileName)
+{
+    std::vector<uint8_t> data = GetFileData(fileName);
+    std::vector<uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+    if (data.empty() || !DecodeRTTex(data, pixels, width, height))
+    {
+        return false;
+    }
+
+    SetPixels(width, height, pixels.data());
+    return true;
+}
+
+bool RenderImage::SavePNG(const std::string& fileName) const
+{
+    if (m_pixels.empty())
+    {
+        // nothing to save
+        return false;
+    }
+
+    return stbi_write_png(fileName.c_str(), m_width, m_height, 4, m_pixels.data(), m_width * 4) != 0;
+}
+
+RenderImage RenderImage::Downscale(const int& factor) const
+{
+    if (factor <= 1)
+    {
+        return *this;
+    }
+
+    RenderImage image(m_width / factor, m_height / factor);
+    for (int y = 0; y < image.m_height; y++)
+    {
+        for (int x = 0; x < image.m_width; x++)
+        {
+            // colors weighted by their alpha, so transparent pixels don't darken the edges
+            uint32_t r = 0, g = 0, b = 0, a = 0;
+            for (int blockY = 0; blockY < factor; blockY++)
+            {
+                const uint32_t * pRow = m_pixels.data() + (size_t)(y * factor + blockY) * m_width + x * factor;
+                for (int blockX = 0; blockX < factor; blockX++)
+                {
+                    const uint32_t pixel = pRow[blockX];
+                    const uint32_t alpha = pixel >> 24;
+                    r += (pixel & 0xFF) * alpha;
+                    g += ((pixel >> 8) & 0xFF) * alpha;
+                    b += ((pixel >> 16) & 0xFF) * alpha;
+                    a += alpha;
+                }
+            }
+
+            if (a != 0)
+            {
+                image.m_pixels[(size_t)y * image.m_width + x] = (r / a) | (g / a) << 8 | (b / a) << 16 | (a / (factor * factor)) << 24;
+            }
+        }
+    }
+
+    return image;
+}
+
+// src over an opaque dst, (src * a + dst * (255 - a)) / 255 rounded
+static inline uint32_t BlendPixel(const uint32_t& src, const uint32_t& dst)
+{
+    const uint32_t alpha = src >> 24;
+    const uint32_t inverse = 255 - alpha;
+    uint32_t out = RENDER_ALPHA_MASK;
+    for (int shift = 0; shift < 24; shift += 8)
+    {
+        const uint32_t channel = ((src >> shift) & 0xFF) * alpha + ((dst >> shift) & 0xFF) * inverse + 128;
+        out |= ((channel + (channel >> 8)) >> 8) << shift;
+    }
+
+    return out;
+}
+
+#ifdef RENDER_IMAGE_SSE2
+// the same for 2 pixels widened to 16 bits per channel
+static inline __m128i BlendPixels16(const __m128i& src, const __m128i& dst)
+{
+    const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    __m128i out = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(src, alpha), _mm_mullo_epi16(dst, inverse)), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(out, _mm_srli_epi16(out, 8)), 8);
+}
+#endif
+
+void RenderImage::Blend(const RenderImage& src, int srcX, int srcY, int width, int height, int dstX, int dstY)
+{
+    // clipping the rect to both images
+    if (srcX < 0) { width += srcX; dstX -= srcX; srcX = 0; }
+    if (srcY < 0) { height += srcY; dstY -= srcY; srcY = 0; }
+    if (dstX < 0) { width += dstX; srcX -= dstX; dstX = 0; }
+    if (dstY < 0) { height += dstY; srcY -= dstY; dstY = 0; }
+    width = std::min({ width, src.m_width - srcX, m_width - dstX });
+    height = std::min({ height, src.m_height - srcY, m_height - dstY });
+    if (width <= 0 || height <= 0)
+    {
+        // nothing left to draw
+        return;
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint32_t * pSrc = src.m_pixels.data() + (size_t)(srcY + y) * src.m_width + srcX;
+        uint32_t * pDst = m_pixels.data() + (size_t)(dstY + y) * m_width + dstX;
+        int x = 0;
+#ifdef RENDER_IMAGE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i alphaMask = _mm_set1_epi32((int)RENDER_ALPHA_MASK);
+        for (; x + 4 <= width; x += 4)
+        {
+            const __m128i srcPixels = _mm_loadu_si128((const __m128i*)(pSrc + x));
+            const int opaque = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(srcPixels, alphaMask), alphaMask));
+            if (opaque == 0xFFFF)
+            {
+                // the usual inside of a tile
+                _mm_storeu_si128((__m128i*)(pDst + x), srcPixels);
+                continue;
+            }
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(srcPixels, alphaMask), zero)) == 0xFFFF)
+            {
+                // fully transparent
+                continue;
+            }
+
+            const __m128i dstPixels = _mm_loadu_si128((const __m128i*)(pDst + x));
+            const __m128i low = BlendPixels16(_mm_unpacklo_epi8(srcPixels, zero), _mm_unpacklo_epi8(dstPixels, zero));
+            const __m128i high = BlendPixels16(_mm_unpackhi_epi8(srcPixels, zero), _mm_unpackhi_epi8(dstPixels, zero));
+            _mm_storeu_si128((__m128i*)(pDst + x), _mm_or_si128(_mm_packus_epi16(low, high), alphaMask));
+        }
+#endif
+
+        for (; x < width; x++)
+        {
+            pDst[x] = BlendPixel(pSrc[x], pDst[x]);
+        }
+    }
+}
+
+void RenderImage::Blend(const RenderImage& src, const std::vector<RenderQuad>& quads, const int& size)
+{
+    for (int i = 0; i < quads.size(); i++)
+    {
+        const RenderQuad& quad = quads[i];
+        Blend(src, quad.srcX, quad.srcY, size, size, quad.dstX, quad.dstY);
+    }
+}
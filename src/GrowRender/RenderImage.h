@@ -0,0 +1,57 @@
+#ifndef RENDERIMAGE_H
+#define RENDERIMAGE_H
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// pixels are RGBA bytes, read as little endian uint32_t the alpha is the top byte
+#define RENDER_ALPHA_MASK 0xFF000000
+
+// a square of the source image drawn at a spot of the target
+struct RenderQuad
+{
+    uint16_t                                     srcX;
+    uint16_t                                     srcY;
+    uint16_t                                     dstX;
+    uint16_t                                     dstY;
+};
+
+/*
+* An RGBA image in memory, for rendering without a gpu. Blending works on 4 pixels at a time with SSE2 where it's
+* available, the rest of the row & other cpus go through the same math one pixel at a time.
+*/
+class RenderImage
+{
+public:
+    RenderImage() = default;
+    RenderImage(const int& width, const int& height, const uint32_t& color = 0);
+    ~RenderImage() = default;
+
+
+    // get
+    int                                          GetWidth() const { return m_width; }
+    int                                          GetHeight() const { return m_height; }
+    uint32_t                                     *GetPixels() { return m_pixels.data(); }
+    const uint32_t                               *GetPixels() const { return m_pixels.data(); }
+    size_t                                       GetMemoryUsage() const { return sizeof(RenderImage) + m_pixels.capacity() * sizeof(uint32_t); }
+
+
+    // set
+    void                                         SetPixels(const int& width, const int& height, const void* pPixels); // width * height RGBA pixels
+
+
+    // fn
+    bool                                         LoadRTTex(const std::string& fileName); // false if it can't be read or decoded
+    bool                                         SavePNG(const std::string& fileName) const;
+
+    RenderImage                                  Downscale(const int& factor) const; // every factor x factor block becomes a pixel, averaged by alpha
+    void                                         Blend(const RenderImage& src, int srcX, int srcY, int width, int height, int dstX, int dstY); // src over this image, which has to be opaque
+    void                                         Blend(const RenderImage& src, const std::vector<RenderQuad>& quads, const int& size); // every quad is size x size
+
+private:
+    int                                          m_width = 0;
+    int                                          m_height = 0;
+    std::vector<uint32_t>                        m_pixels;
+};
+
+#endif RENDERIMAGE_H
@@ -0,0 +1,136 @@
+#include <BaseApp.h> // precompiled
+#include <GrowRender/TextureAtlas.h>
+
+size_t TextureAtlas::GetMemoryUsage() const
+{
+    size_t usage = sizeof(TextureAtlas);
+    for (int i = 0; i < m_pages.size(); i++)
+    {
+        usage += m_pages[i].pImage->GetMemoryUsage() + m_pages[i].skyline.capacity() * sizeof(SkylineNode);
+    }
+
+    return usage;
+}
+
+AtlasRegion TextureAtlas::Add(const RenderImage& image)
+{
+    AtlasRegion region;
+    if (image.GetWidth() <= 0 || image.GetHeight() <= 0)
+    {
+        // nothing to pack
+        return region;
+    }
+
+    region.width = image.GetWidth();
+    region.height = image.GetHeight();
+    for (int i = 0; i < m_pages.size() && region.page == -1; i++)
+    {
+        if (Fit(m_pages[i], region.width, region.height, region.x, region.y))
+        {
+            region.page = i;
+        }
+    }
+
+    if (region.page == -1)
+    {
+        // every page is full
+        const int width = std::max(TEXTURE_ATLAS_PAGE_SIZE, region.width);
+        const int height = std::max(TEXTURE_ATLAS_PAGE_SIZE, region.height);
+
+        TextureAtlasPage page;
+        page.pImage = std::make_unique<RenderImage>(width, height);
+        page.skyline.push_back({ 0, 0, width });
+        Fit(page, region.width, region.height, region.x, region.y);
+
+        region.page = (int)m_pages.size();
+        m_pages.emplace_back(std::move(page));
+    }
+
+    RenderImage& pageImage = *m_pages[region.page].pImage;
+    region.pPage = &pageImage;
+    for (int y = 0; y < region.height; y++)
+    {
+        std::memcpy(pageImage.GetPixels() + (size_t)(region.y + y) * pageImage.GetWidth() + region.x, image.GetPixels() + (size_t)y * region.width, region.width * sizeof(uint32_t));
+    }
+
+    return region;
+}
+
+void TextureAtlas::Clear()
+{
+    m_pages.clear();
+}
+
+bool TextureAtlas::Fit(TextureAtlasPage& page, const int& width, const int& height, int& x, int& y)
+{
+    const int pageWidth = page.pImage->GetWidth();
+    const int pageHeight = page.pImage->GetHeight();
+    std::vector<SkylineNode>& skyline = page.skyline;
+
+    // lowest spot first, leftmost among the equally low ones
+    int best = -1;
+    int bestY = pageHeight;
+    for (int i = 0; i < skyline.size(); i++)
+    {
+        if (skyline[i].x + width > pageWidth)
+        {
+            break;
+        }
+
+        // resting on the highest node it spans
+        int top = 0;
+        int remaining = width;
+        for (int j = i; remaining > 0; j++)
+        {
+            top = std::max(top, skyline[j].y);
+            remaining -= skyline[j].width;
+        }
+
+        if (top + height <= pageHeight && top < bestY)
+        {
+            best = i;
+            bestY = top;
+        }
+    }
+
+    if (best == -1)
+    {
+        // doesn't fit
+        return false;
+    }
+
+    x = skyline[best].x;
+    y = bestY;
+
+    // the new node covers the spanned nodes, the last one is cut to what sticks out on the right
+    const int right = x + width;
+    int end = best;
+    while (end < skyline.size() && skyline[end].x + skyline[end].width <= right)
+    {
+        end++;
+    }
+
+    if (end < skyline.size() && skyline[end].x < right)
+    {
+        skyline[end].width -= right - skyline[end].x;
+        skyline[end].x = right;
+    }
+
+    skyline.erase(skyline.begin() + best, skyline.begin() + end);
+    skyline.insert(skyline.begin() + best, { x, y + height, width });
+
+    // neighbours at the same height become one node
+    for (int i = 0; i + 1 < skyline.size();)
+    {
+        if (skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+            continue;
+        }
+
+        i++;
+    }
+
+    return true;
+}
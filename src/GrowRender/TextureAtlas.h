@@ -0,0 +1,64 @@
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+#include <memory>
+#include <vector>
+
+#include <GrowRender/RenderImage.h>
+
+#define TEXTURE_ATLAS_PAGE_SIZE 1024 // width & height of an atlas page, larger images get a page of their own
+
+// where an image ended up, pPage stays valid as long as the atlas isn't cleared
+struct AtlasRegion
+{
+    const RenderImage                            *pPage = NULL; // NULL if the image never made it into the atlas
+    int                                          page = -1;
+    int                                          x = 0;
+    int                                          y = 0;
+    int                                          width = 0;
+    int                                          height = 0;
+};
+
+// the top edge of the packed images over a run of columns
+struct SkylineNode
+{
+    int                                          x;
+    int                                          y;
+    int                                          width;
+};
+
+struct TextureAtlasPage
+{
+    std::unique_ptr<RenderImage>                 pImage; // never moves, so regions can point at it
+    std::vector<SkylineNode>                     skyline;
+};
+
+/*
+* Packs images into a few large pages with a bottom-left skyline packer, so drawing from many images turns into drawing from
+* a few pages. Images are added one at a time & never move once they're placed.
+*
+* Not thread safe. Pixels of a region are only written by Add(), so threads that got the region from the owner under a lock
+* can read it while other regions are being added.
+*/
+class TextureAtlas
+{
+public:
+    TextureAtlas() = default;
+    ~TextureAtlas() = default;
+
+
+    // get
+    int                                          GetPageCount() const { return (int)m_pages.size(); }
+    size_t                                       GetMemoryUsage() const;
+
+
+    // fn
+    AtlasRegion                                  Add(const RenderImage& image); // copies the image into the first page it fits in
+    void                                         Clear();
+
+private:
+    bool                                         Fit(TextureAtlasPage& page, const int& width, const int& height, int& x, int& y);
+
+    std::vector<TextureAtlasPage>                m_pages;
+};
+
+#endif TEXTUREATLAS_H
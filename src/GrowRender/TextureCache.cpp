@@ -0,0 +1,341 @@
+#include <BaseApp.h> // precompiled
+#include <GrowRender/TextureCache.h>
+
+#include <fstream>
+#include <filesystem>
+
+#include <SDK/Proton/TextScanner.h>
+#include <SDK/Proton/MiscUtils.h>
+#include <SDK/Proton/FileSystem/MappedFile.h>
+
+TextureCache g_textureCache;
+TextureCache* GetTextureCache() { return &g_textureCache; }
+
+// like the client, textures without a folder are inside game/
+static std::string GetTexturePath(const std::string& texture)
+{
+    return texture.find('/') == std::string::npos ? "game/" + texture : texture;
+}
+
+TextureCache::~TextureCache()
+{
+    Stop();
+}
+
+size_t TextureCache::GetMemoryUsage()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryUsage;
+}
+
+void TextureCache::Init()
+{
+    TextScanner t;
+    t.LoadFile("file_hashes.txt");
+    if (!t.IsLoaded())
+    {
+        LogError("failed to load file_hashes.txt, textures get hashed from their files");
+    }
+    else
+    {
+        std::vector<std::string> lines = t.GetLines();
+        for (int i = 0; i < lines.size(); i++)
+        {
+            if (lines[i].starts_with('#') || lines[i].empty())
+            {
+                continue;
+            }
+
+            std::vector<std::string> tokens = Utils::StringTokenize(lines[i]);
+            if (tokens.size() < 2)
+            {
+                continue;
+            }
+
+            m_fileHashes[tokens[0]] = (uint32_t)std::strtoul(tokens[1].c_str(), NULL, 10);
+        }
+
+        t.Kill();
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(TEXTURE_CACHE_PATH, ec);
+}
+
+void TextureCache::Start(int threads)
+{
+    std::lock_guard<std::mutex> threadsLock(m_threadsMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_threads.empty())
+    {
+        // already running
+        return;
+    }
+
+    m_bStopping = false;
+    for (int i = 0; i < threads; i++)
+    {
+        m_threads.emplace_back(&TextureCache::DecodeThread, this);
+    }
+}
+
+void TextureCache::Stop()
+{
+    std::lock_guard<std::mutex> threadsLock(m_threadsMutex);
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStopping = true;
+        m_prefetches.clear();
+        threads.swap(m_threads);
+    }
+
+    m_prefetchAdded.notify_all();
+    for (int i = 0; i < threads.size(); i++)
+    {
+        if (threads[i].joinable())
+        {
+            threads[i].join();
+        }
+    }
+}
+
+std::shared_ptr<const RenderImage> TextureCache::Get(const std::string& texture)
+{
+    std::shared_ptr<const RenderImage> pImage = NULL;
+    std::shared_ptr<std::promise<std::shared_ptr<const RenderImage>>> pPromise = NULL;
+    TextureFuture future;
+    uint32_t hash = 0;
+    if (Find(texture, pImage, future, pPromise, hash))
+    {
+        return pImage;
+    }
+
+    if (pPromise == NULL)
+    {
+        // another thread is decoding it, or there's no such texture
+        return future.valid() ? future.get() : NULL;
+    }
+
+    try
+    {
+        pImage = Decode(texture, hash);
+    }
+    catch (const std::exception& e)
+    {
+        // out of memory most likely, not cached so the next Get() tries again
+        LogError("failed to decode the texture %s: %s", texture.c_str(), e.what());
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decoding.erase(hash);
+        }
+
+        pPromise->set_value(NULL);
+        return NULL;
+    }
+
+    Insert(hash, pImage);
+    pPromise->set_value(pImage);
+    return pImage;
+}
+
+void TextureCache::Prefetch(const std::vector<std::string>& textures)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_threads.empty() || m_bStopping)
+        {
+            // not running, they're decoded on the first Get() instead
+            return;
+        }
+
+        for (int i = 0; i < textures.size(); i++)
+        {
+            auto it = m_fileHashes.find(textures[i]);
+            auto computedIt = m_computedHashes.find(textures[i]);
+            const uint32_t hash = it != m_fileHashes.end() ? it->second : computedIt != m_computedHashes.end() ? computedIt->second : 0;
+            if (hash != 0 && (m_entries.contains(hash) || m_decoding.contains(hash)))
+            {
+                // nothing to do
+                continue;
+            }
+
+            m_prefetches.push_back(textures[i]);
+        }
+    }
+
+    m_prefetchAdded.notify_all();
+}
+
+void TextureCache::DecodeThread()
+{
+    while (true)
+    {
+        std::string texture;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_prefetchAdded.wait(lock, [this]() { return m_bStopping || !m_prefetches.empty(); });
+            if (m_bStopping)
+            {
+                return;
+            }
+
+            texture = std::move(m_prefetches.front());
+            m_prefetches.pop_front();
+        }
+
+        Get(texture);
+    }
+}
+
+bool TextureCache::Find(const std::string& texture, std::shared_ptr<const RenderImage>& pImage, TextureFuture& future,
+                        std::shared_ptr<std::promise<std::shared_ptr<const RenderImage>>>& pPromise, uint32_t& hash)
+{
+    auto hashIt = m_fileHashes.find(texture);
+    if (hashIt != m_fileHashes.end())
+    {
+        hash = hashIt->second;
+    }
+    else
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto computedIt = m_computedHashes.find(texture);
+            hash = computedIt != m_computedHashes.end() ? computedIt->second : 0;
+        }
+
+        if (hash == 0)
+        {
+            // not listed, hashed from the file once
+            hash = Utils::GetHashOfFile(GetTexturePath(texture));
+            if (hash != 0)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_computedHashes[texture] = hash;
+            }
+        }
+    }
+
+    if (hash == 0)
+    {
+        // no such texture
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(hash);
+    if (it != m_entries.end())
+    {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+        pImage = it->second.pImage;
+        return true;
+    }
+
+    auto decodingIt = m_decoding.find(hash);
+    if (decodingIt != m_decoding.end())
+    {
+        future = decodingIt->second;
+        return false;
+    }
+
+    // the caller decodes it
+    pPromise = std::make_shared<std::promise<std::shared_ptr<const RenderImage>>>();
+    future = pPromise->get_future().share();
+    m_decoding[hash] = future;
+    return false;
+}
+
+std::shared_ptr<const RenderImage> TextureCache::Decode(const std::string& texture, const uint32_t& hash)
+{
+    char fileName[64];
+    std::snprintf(fileName, sizeof(fileName), TEXTURE_CACHE_PATH "%08x.raw", hash);
+
+    std::shared_ptr<RenderImage> pImage = std::make_shared<RenderImage>();
+    if (LoadRaw(fileName, *pImage))
+    {
+        return pImage;
+    }
+
+    if (!pImage->LoadRTTex(GetTexturePath(texture)))
+    {
+        LogError("failed to decode the texture %s", texture.c_str());
+        return NULL;
+    }
+
+    SaveRaw(fileName, *pImage);
+    return pImage;
+}
+
+void TextureCache::Insert(const uint32_t& hash, const std::shared_ptr<const RenderImage>& pImage)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_decoding.erase(hash);
+
+    m_lru.push_front(hash);
+    TextureCacheEntry& entry = m_entries[hash];
+    entry.pImage = pImage;
+    entry.lru = m_lru.begin();
+    entry.size = sizeof(TextureCacheEntry) + (pImage != NULL ? pImage->GetMemoryUsage() : 0);
+    m_memoryUsage += entry.size;
+
+    // textures that are still used elsewhere live on until they're released, only the cache lets go of them
+    const size_t budget = (size_t)TEXTURE_CACHE_BUDGET_MB * 1024 * 1024;
+    while (m_memoryUsage > budget && m_lru.size() > 1)
+    {
+        auto it = m_entries.find(m_lru.back());
+        m_memoryUsage -= std::min(m_memoryUsage, it->second.size);
+        m_entries.erase(it);
+        m_lru.pop_back();
+    }
+}
+
+bool TextureCache::LoadRaw(const std::string& fileName, RenderImage& image)
+{
+    MappedFile f;
+    if (!f.Open(fileName) || f.GetSize() < sizeof(TextureCacheFileHeader))
+    {
+        // not decoded yet
+        return false;
+    }
+
+    TextureCacheFileHeader header;
+    std::memcpy(&header, f.GetAsBytes(), sizeof(header));
+    if (header.magic != TEXTURE_CACHE_FILE_MAGIC || header.version != TEXTURE_CACHE_FILE_VERSION || header.width <= 0 || header.height <= 0 ||
+        f.GetSize() != sizeof(header) + (size_t)header.width * header.height * sizeof(uint32_t))
+    {
+        // written by another version or cut off, decoded again & overwritten
+        return false;
+    }
+
+    image.SetPixels(header.width, header.height, f.GetAsBytes() + sizeof(header));
+    return true;
+}
+
+void TextureCache::SaveRaw(const std::string& fileName, const RenderImage& image)
+{
+    // written next to the file and renamed over it, so nobody maps a half written texture
+    const std::string tempName = fileName + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    std::ofstream o(tempName, std::ios::binary | std::ios::trunc);
+    if (!o.is_open())
+    {
+        // cache folder is missing or read only, the texture just stays in memory
+        return;
+    }
+
+    TextureCacheFileHeader header = { TEXTURE_CACHE_FILE_MAGIC, TEXTURE_CACHE_FILE_VERSION, image.GetWidth(), image.GetHeight() };
+    o.write((const char*)&header, sizeof(header));
+    o.write((const char*)image.GetPixels(), (size_t)image.GetWidth() * image.GetHeight() * sizeof(uint32_t));
+    o.close();
+    if (o.fail())
+    {
+        LogError("failed to write %s", tempName.c_str());
+        std::remove(tempName.c_str());
+        return;
+    }
+
+    if (std::rename(tempName.c_str(), fileName.c_str()) != 0)
+    {
+        // another thread or run already wrote it, the file is keyed by hash so its pixels are the same
+        std::remove(tempName.c_str());
+    }
+}
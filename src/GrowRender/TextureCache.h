@@ -0,0 +1,99 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+#include <list>
+#include <deque>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <GrowRender/RenderImage.h>
+
+#define TEXTURE_CACHE_PATH "cache/textures/" // the decoded textures on disk, can be cleared at any time
+#define TEXTURE_CACHE_FILE_MAGIC 0x52435854 // TXCR
+#define TEXTURE_CACHE_FILE_VERSION 1
+#define TEXTURE_CACHE_BUDGET_MB 128 // decoded textures kept in memory, the least recently used ones are dropped above it
+#define TEXTURE_CACHE_THREADS 2 // threads decoding prefetched textures
+
+// the header of a decoded texture on disk, followed by width * height RGBA pixels
+struct TextureCacheFileHeader
+{
+    uint32_t                                     magic;
+    uint32_t                                     version;
+    int32_t                                      width;
+    int32_t                                      height;
+};
+
+struct TextureCacheEntry
+{
+    std::shared_ptr<const RenderImage>           pImage; // NULL for textures that couldn't be decoded
+    std::list<uint32_t>::iterator                lru;
+    size_t                                       size;
+};
+
+using TextureFuture = std::shared_future<std::shared_ptr<const RenderImage>>;
+
+/*
+* Decoded item & interface textures, keyed by the hash of their rttex file so a texture is inflated & decoded once no matter
+* how many renders ask for it.
+*
+* The hash comes from file_hashes.txt, textures it doesn't list are hashed from their file. Decoded textures are kept in memory
+* up to TEXTURE_CACHE_BUDGET_MB, least recently used first out, and written raw to TEXTURE_CACHE_PATH/<hash>.raw where later
+* runs map them instead of decoding the rttex again. A changed texture gets a new hash, so the files on disk are never stale.
+*
+* Get() can be called from any thread, threads asking for a texture that is being decoded wait for that decode.
+*/
+class TextureCache
+{
+public:
+    TextureCache() = default;
+    ~TextureCache();
+
+
+    // get
+    size_t                                       GetMemoryUsage();
+
+
+    // fn
+    void                                         Init(); // reads file_hashes.txt, call before anything asks for textures
+    void                                         Start(int threads = TEXTURE_CACHE_THREADS);
+    void                                         Stop(); // the textures being decoded are finished first
+
+    std::shared_ptr<const RenderImage>           Get(const std::string& texture); // name as in the item data, NULL if it can't be decoded
+    void                                         Prefetch(const std::vector<std::string>& textures); // decoded by the cache threads, if they're running
+
+private:
+    void                                         DecodeThread();
+    // true with pImage set when it's cached, otherwise future is the decode in flight or pPromise the one the caller has to do,
+    // both are left empty if there's no such texture
+    bool                                         Find(const std::string& texture, std::shared_ptr<const RenderImage>& pImage, TextureFuture& future,
+                                                      std::shared_ptr<std::promise<std::shared_ptr<const RenderImage>>>& pPromise, uint32_t& hash);
+    std::shared_ptr<const RenderImage>           Decode(const std::string& texture, const uint32_t& hash);
+    void                                         Insert(const uint32_t& hash, const std::shared_ptr<const RenderImage>& pImage);
+
+    bool                                         LoadRaw(const std::string& fileName, RenderImage& image);
+    void                                         SaveRaw(const std::string& fileName, const RenderImage& image);
+
+    std::unordered_map<std::string, uint32_t>    m_fileHashes; // from file_hashes.txt, read only after Init()
+
+    std::mutex                                   m_mutex;
+    std::unordered_map<std::string, uint32_t>    m_computedHashes; // hashed from the file for textures file_hashes.txt doesn't list
+    std::unordered_map<uint32_t, TextureCacheEntry> m_entries;
+    std::unordered_map<uint32_t, TextureFuture>  m_decoding; // textures a thread is decoding right now
+    std::list<uint32_t>                          m_lru; // most recently used first
+    size_t                                       m_memoryUsage = 0;
+
+    std::mutex                                   m_threadsMutex; // held through Start() & Stop(), a Start() can't revive threads being stopped
+    std::vector<std::thread>                     m_threads; // changed under both mutexes
+    std::condition_variable                      m_prefetchAdded;
+    std::deque<std::string>                      m_prefetches;
+    bool                                         m_bStopping = false;
+};
+
+TextureCache*                                    GetTextureCache();
+
+#endif TEXTURECACHE_H
@@ -0,0 +1,257 @@
+#include <BaseApp.h> // precompiled
+#include <GrowRender/WorldThumbnailer.h>
+
+#include <GrowRender/TextureCache.h>
+#include <World/World.h>
+#include <Items/ItemInfoManager.h>
+
+WorldThumbnailer g_worldThumbnailer;
+WorldThumbnailer* GetWorldThumbnailer() { return &g_worldThumbnailer; }
+
+WorldThumbnailer::~WorldThumbnailer()
+{
+    Stop();
+}
+
+void WorldThumbnailer::Start(int threads)
+{
+    if (!m_threads.empty() || threads <= 0)
+    {
+        // already running or turned off
+        return;
+    }
+
+    m_bStopping = false;
+    for (int i = 0; i < threads; i++)
+    {
+        m_threads.emplace_back(&WorldThumbnailer::RenderThread, this);
+    }
+
+    LogMsg("rendering world thumbnails on %d threads", threads);
+}
+
+void WorldThumbnailer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStopping = true;
+    }
+
+    m_jobAdded.notify_all();
+    for (int i = 0; i < m_threads.size(); i++)
+    {
+        if (m_threads[i].joinable())
+        {
+            m_threads[i].join();
+        }
+    }
+
+    m_threads.clear();
+    m_sheets.clear();
+    m_atlas.Clear();
+}
+
+void WorldThumbnailer::Queue(World* pWorld)
+{
+    if (pWorld == NULL || m_threads.empty())
+    {
+        // world is null or not rendering
+        return;
+    }
+
+    WorldTileMap * pTileMap = pWorld->GetWorldTileMap();
+    if (pTileMap == NULL)
+    {
+        // tile map is null
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_jobs.size() >= WORLD_RENDER_MAX_QUEUED)
+        {
+            // the render threads are behind, it gets rendered on its next save
+            return;
+        }
+    }
+
+    WorldRenderJob job;
+    job.fileName = GetConfig().worldImagePath + pWorld->GetName() + ".png";
+    job.width = pTileMap->GetWidth();
+    job.height = pTileMap->GetHeight();
+
+    std::unordered_map<std::string, uint16_t> textureIndexes;
+    std::vector<uint8_t> masks;
+    for (int layer = 0; layer < 2; layer++)
+    {
+        const bool bForeground = layer == 1;
+        std::vector<WorldRenderTile>& tiles = bForeground ? job.foregrounds : job.backgrounds;
+        pTileMap->GetNeighbourMasks(bForeground, masks);
+        for (int i = 0; i < pTileMap->GetTileCount(); i++)
+        {
+            Tile pTile = pTileMap->GetTile((uint16_t)i);
+            const uint16_t itemID = bForeground ? pTile->GetForeground() : pTile->GetBackground();
+            if (itemID == 0)
+            {
+                // nothing to draw
+                continue;
+            }
+
+            ItemInfo * pItemInfo = GetItemInfoManager()->GetItemByID(itemID);
+            if (pItemInfo == NULL)
+            {
+                // item info is null
+                continue;
+            }
+
+            pItemInfo->DecodeColdFields();
+            if (pItemInfo->texture.empty())
+            {
+                continue;
+            }
+
+            int textureOffsetX = 0;
+            int textureOffsetY = 0;
+            if (bForeground)
+            {
+                pTileMap->ChooseVisualForeground(pTile, pItemInfo, masks[i], textureOffsetX, textureOffsetY);
+            }
+            else
+            {
+                pTileMap->ChooseVisualBackground(pTile, pItemInfo, masks[i], textureOffsetX, textureOffsetY);
+            }
+
+            auto it = textureIndexes.emplace(pItemInfo->texture, (uint16_t)job.textures.size());
+            if (it.second)
+            {
+                job.textures.push_back(pItemInfo->texture);
+            }
+
+            tiles.push_back({ it.first->second, (uint8_t)(pItemInfo->textureX + textureOffsetX), (uint8_t)(pItemInfo->textureY + textureOffsetY), (uint16_t)i });
+        }
+    }
+
+    {
+        // decoding the textures that weren't used yet starts right away, not when a render thread gets to the world
+        std::vector<std::string> missing;
+        std::lock_guard<std::mutex> lock(m_sheetMutex);
+        for (int i = 0; i < job.textures.size(); i++)
+        {
+            if (!m_sheets.contains(job.textures[i]))
+            {
+                missing.push_back(job.textures[i]);
+            }
+        }
+
+        GetTextureCache()->Prefetch(missing);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.emplace_back(std::move(job));
+    }
+
+    m_jobAdded.notify_one();
+}
+
+void WorldThumbnailer::RenderThread()
+{
+    while (true)
+    {
+        WorldRenderJob job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAdded.wait(lock, [this]() { return m_bStopping || !m_jobs.empty(); });
+            if (m_jobs.empty())
+            {
+                // stopping & every render is done
+                return;
+            }
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        Render(job);
+    }
+}
+
+void WorldThumbnailer::Render(const WorldRenderJob& job)
+{
+    std::vector<AtlasRegion> sheets(job.textures.size());
+    for (int i = 0; i < job.textures.size(); i++)
+    {
+        sheets[i] = GetSheet(job.textures[i]);
+    }
+
+    RenderImage image(job.width * WORLD_RENDER_TILE_SIZE, job.height * WORLD_RENDER_TILE_SIZE, WORLD_RENDER_SKY_COLOR);
+    const std::vector<WorldRenderTile> * layers[] = { &job.backgrounds, &job.foregrounds };
+    std::vector<RenderBatch> batches;
+    for (const std::vector<WorldRenderTile> * pTiles : layers)
+    {
+        for (const WorldRenderTile& tile : *pTiles)
+        {
+            const AtlasRegion& sheet = sheets[tile.texture];
+            const int srcX = sheet.x + tile.textureX * WORLD_RENDER_TILE_SIZE;
+            const int srcY = sheet.y + tile.textureY * WORLD_RENDER_TILE_SIZE;
+            if (sheet.pPage == NULL || srcX + WORLD_RENDER_TILE_SIZE > sheet.x + sheet.width || srcY + WORLD_RENDER_TILE_SIZE > sheet.y + sheet.height)
+            {
+                // texture couldn't be loaded or the item points outside of it
+                continue;
+            }
+
+            if (batches.size() <= sheet.page)
+            {
+                batches.resize(sheet.page + 1);
+            }
+
+            RenderBatch& batch = batches[sheet.page];
+            batch.pPage = sheet.pPage;
+            batch.quads.push_back({ (uint16_t)srcX, (uint16_t)srcY, (uint16_t)((tile.index % job.width) * WORLD_RENDER_TILE_SIZE), (uint16_t)((tile.index / job.width) * WORLD_RENDER_TILE_SIZE) });
+        }
+
+        for (RenderBatch& batch : batches)
+        {
+            if (!batch.quads.empty())
+            {
+                image.Blend(*batch.pPage, batch.quads, WORLD_RENDER_TILE_SIZE);
+                batch.quads.clear();
+            }
+        }
+    }
+
+    if (!image.SavePNG(job.fileName))
+    {
+        LogError("failed to write the world thumbnail %s", job.fileName.c_str());
+    }
+}
+
+AtlasRegion WorldThumbnailer::GetSheet(const std::string& texture)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sheetMutex);
+        auto it = m_sheets.find(texture);
+        if (it != m_sheets.end())
+        {
+            return it->second;
+        }
+    }
+
+    // downscaled outside of the lock, the texture cache decodes every texture only once
+    RenderImage sheet;
+    std::shared_ptr<const RenderImage> pTexture = GetTextureCache()->Get(texture);
+    if (pTexture != NULL)
+    {
+        sheet = pTexture->Downscale(WORLD_RENDER_TEXTURE_TILE_SIZE / WORLD_RENDER_TILE_SIZE);
+    }
+
+    std::lock_guard<std::mutex> lock(m_sheetMutex);
+    auto it = m_sheets.find(texture);
+    if (it == m_sheets.end())
+    {
+        // another thread may have packed it in the meantime
+        it = m_sheets.emplace(texture, m_atlas.Add(sheet)).first;
+    }
+
+    return it->second;
+}
@@ -0,0 +1,91 @@
+#ifndef WORLDTHUMBNAILER_H
+#define WORLDTHUMBNAILER_H
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <GrowRender/RenderImage.h>
+#include <GrowRender/TextureAtlas.h>
+
+#define WORLD_RENDER_TEXTURE_TILE_SIZE 32 // pixels of a tile inside the item textures
+#define WORLD_RENDER_TILE_SIZE 8 // pixels of a tile inside the thumbnails
+#define WORLD_RENDER_SKY_COLOR 0xFFFFC660 // RGBA bytes as little endian, behind every tile
+#define WORLD_RENDER_MAX_QUEUED 64 // renders waiting for a thread, worlds queued above it are skipped until the next save
+
+// fowarded definitions
+class World;
+
+struct WorldRenderTile
+{
+    uint16_t                                     texture; // index into WorldRenderJob::textures
+    uint8_t                                      textureX; // in tiles
+    uint8_t                                      textureY;
+    uint16_t                                     index;
+};
+
+// everything a render needs from the world, taken on the event loop so the render threads never touch the world
+struct WorldRenderJob
+{
+    std::string                                  fileName;
+    int                                          width = 0;
+    int                                          height = 0;
+    std::vector<std::string>                     textures;
+    std::vector<WorldRenderTile>                 backgrounds;
+    std::vector<WorldRenderTile>                 foregrounds;
+};
+
+// the tiles of a layer that come from one atlas page, drawn in one go
+struct RenderBatch
+{
+    const RenderImage                            *pPage = NULL;
+    std::vector<RenderQuad>                      quads;
+};
+
+/*
+* Renders thumbnails of worlds into world_image_path/<world name>.png without a gpu. The tiles of a world are snapshotted by
+* Queue() on the event loop, the render threads blend them onto the sky from the item textures & write the png.
+*
+* Item textures come from the texture cache & are packed into an atlas downscaled to WORLD_RENDER_TILE_SIZE, shared by every
+* render. Each layer is drawn as one batch per atlas page, the tiles of a layer never overlap so their order doesn't matter.
+*/
+class WorldThumbnailer
+{
+public:
+    WorldThumbnailer() = default;
+    ~WorldThumbnailer();
+
+
+    // get
+    bool                                         IsStarted() const { return !m_threads.empty(); }
+
+
+    // fn
+    void                                         Start(int threads); // only once the item database is loaded
+    void                                         Stop(); // renders the queued worlds first
+
+    void                                         Queue(World* pWorld); // event loop only
+
+private:
+    void                                         RenderThread();
+    void                                         Render(const WorldRenderJob& job);
+    AtlasRegion                                  GetSheet(const std::string& texture); // the region has no page if it can't be loaded
+
+    std::vector<std::thread>                     m_threads;
+    std::mutex                                   m_mutex;
+    std::condition_variable                      m_jobAdded;
+    bool                                         m_bStopping = false;
+    std::deque<WorldRenderJob>                   m_jobs;
+
+    std::mutex                                   m_sheetMutex;
+    TextureAtlas                                 m_atlas;
+    std::unordered_map<std::string, AtlasRegion> m_sheets;
+};
+
+WorldThumbnailer*                                GetWorldThumbnailer();
+
+#endif WORLDTHUMBNAILER_H
@@ -23,6 +23,8 @@ bool ItemInfo::IsSolidCollision()
 
 size_t ItemInfo::GetMemoryEstimated(const uint16_t& version)
 {
+    DecodeColdFields();
+
     size_t len = 0;
 
     len += sizeof(uint32_t);
@@ -165,6 +167,8 @@ size_t ItemInfo::GetMemoryEstimated(const uint16_t& version)
 
 void ItemInfo::SerializeToMem(const uint16_t& version, uint8_t* pMem, int& offsetInOut)
 {
+    DecodeColdFields();
+
     bool bWriteToMem = true;
 
     MemorySerializeRaw(ID, pMem, offsetInOut, bWriteToMem);
@@ -309,151 +313,265 @@ void ItemInfo::SerializeToMem(const uint16_t& version, uint8_t* pMem, int& offse
     }
 }
 
-void ItemInfo::SerializeFromMem(const uint16_t& version, uint8_t* pMem, int& offsetInOut)
+size_t ItemInfo::GetCacheMemoryEstimated()
 {
-    bool bWriteToMem = false;
+    size_t len = GetMemoryEstimated(ITEM_CACHE_DATA_VERSION);
+
+    len += sizeof(bLocked);
+    len += sizeof(punchID);
+    len += sizeof(punchRangeModifier);
+    len += sizeof(buildRangeModifier);
+    len += sizeof(maxFruits);
+    len += sizeof(recycleValue);
+    len += sizeof(chi);
+    len += sizeof(uint16_t) + desc.length();
+    len += sizeof(spliceOne);
+    len += sizeof(spliceTwo);
+    len += sizeof(playmodID);
+    len += sizeof(randGroup);
+    len += sizeof(lockPower);
 
-    MemorySerializeRaw(ID, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(editableTypes, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(type, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(soundType, pMem, offsetInOut, bWriteToMem);
+    return len;
+}
 
-    if (version >= 3)
+void ItemInfo::SerializeCache(uint8_t* pMem, int& offsetInOut, const bool& bWriteToMem)
+{
+    if (bWriteToMem)
     {
-        MemorySerializeStringEncrypted(name, pMem, offsetInOut, bWriteToMem, ID, "PBG892FXX982ABC*");
+        SerializeToMem(ITEM_CACHE_DATA_VERSION, pMem, offsetInOut);
     }
     else
     {
-        MemorySerialize(name, pMem, offsetInOut, bWriteToMem);
+        SerializeFromMem(ITEM_CACHE_DATA_VERSION, pMem, offsetInOut);
+    }
+
+    MemorySerializeRaw(bLocked, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(punchID, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(punchRangeModifier, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(buildRangeModifier, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(maxFruits, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(recycleValue, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(chi, pMem, offsetInOut, bWriteToMem);
+    MemorySerialize(desc, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(spliceOne, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(spliceTwo, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(playmodID, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(randGroup, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(lockPower, pMem, offsetInOut, bWriteToMem);
+}
+
+// reads that would run past memSize read nothing & move the offset past memSize, so every read after them fails too
+template <typename T> static void ReadRaw(T& var, uint8_t* pMem, int& offsetInOut, const int& memSize)
+{
+    if (offsetInOut > memSize - (int)sizeof(T))
+    {
+        offsetInOut = memSize + 1;
+        return;
     }
 
-    MemorySerialize(texture, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(textureHash, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(visualType, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(cookingTime, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(textureX, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(textureY, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(tileStorage, pMem, offsetInOut, bWriteToMem);
+    MemorySerializeRaw(var, pMem, offsetInOut, false);
+}
 
-    MemorySerializeRaw(layer, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(tileCollision, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(hardness, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(regenTime, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(bodyPart, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(rarity, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(maxCount, pMem, offsetInOut, bWriteToMem);
-    MemorySerialize(textureExtra, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(textureExtraHash, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(animMS, pMem, offsetInOut, bWriteToMem);
+// reads a string field, or only steps over it when the string is decoded later on
+static void MemorySerializeString(std::string& str, uint8_t* pMem, int& offsetInOut, const bool& bDecode, const int& memSize)
+{
+    uint16_t strLen = 0;
+    int offset = offsetInOut;
+    ReadRaw(strLen, pMem, offset, memSize);
+    if (offset > memSize - strLen)
+    {
+        offsetInOut = memSize + 1;
+        return;
+    }
+
+    if (bDecode)
+    {
+        MemorySerialize(str, pMem, offsetInOut, false);
+        return;
+    }
+
+    offsetInOut = offset + strLen;
+}
+
+static void ReadEncryptedString(std::string& str, uint8_t* pMem, int& offsetInOut, const int& memSize, const uint32_t& cryptID)
+{
+    uint16_t strLen = 0;
+    int offset = offsetInOut;
+    ReadRaw(strLen, pMem, offset, memSize);
+    if (offset > memSize - strLen)
+    {
+        offsetInOut = memSize + 1;
+        return;
+    }
+
+    MemorySerializeStringEncrypted(str, pMem, offsetInOut, false, cryptID, "PBG892FXX982ABC*");
+}
+
+bool ItemInfo::SerializeFromMem(const uint16_t& version, uint8_t* pMem, int& offsetInOut, const bool& bDecodeStrings, const int& memSize)
+{
+    ReadRaw(ID, pMem, offsetInOut, memSize);
+    ReadRaw(editableTypes, pMem, offsetInOut, memSize);
+    ReadRaw(type, pMem, offsetInOut, memSize);
+    ReadRaw(soundType, pMem, offsetInOut, memSize);
+
+    if (version >= 3 && bDecodeStrings)
+    {
+        ReadEncryptedString(name, pMem, offsetInOut, memSize, ID);
+    }
+    else
+    {
+        MemorySerializeString(name, pMem, offsetInOut, bDecodeStrings, memSize);
+    }
+
+    MemorySerializeString(texture, pMem, offsetInOut, bDecodeStrings, memSize);
+    ReadRaw(textureHash, pMem, offsetInOut, memSize);
+    ReadRaw(visualType, pMem, offsetInOut, memSize);
+    ReadRaw(cookingTime, pMem, offsetInOut, memSize);
+    ReadRaw(textureX, pMem, offsetInOut, memSize);
+    ReadRaw(textureY, pMem, offsetInOut, memSize);
+    ReadRaw(tileStorage, pMem, offsetInOut, memSize);
+
+    ReadRaw(layer, pMem, offsetInOut, memSize);
+    ReadRaw(tileCollision, pMem, offsetInOut, memSize);
+    ReadRaw(hardness, pMem, offsetInOut, memSize);
+    ReadRaw(regenTime, pMem, offsetInOut, memSize);
+    ReadRaw(bodyPart, pMem, offsetInOut, memSize);
+    ReadRaw(rarity, pMem, offsetInOut, memSize);
+    ReadRaw(maxCount, pMem, offsetInOut, memSize);
+    MemorySerializeString(textureExtra, pMem, offsetInOut, bDecodeStrings, memSize);
+    ReadRaw(textureExtraHash, pMem, offsetInOut, memSize);
+    ReadRaw(animMS, pMem, offsetInOut, memSize);
 
     if (version >= 4)
     {
-        MemorySerialize(petName, pMem, offsetInOut, bWriteToMem);
-        MemorySerialize(petPrefix, pMem, offsetInOut, bWriteToMem);
-        MemorySerialize(petSuffix, pMem, offsetInOut, bWriteToMem);
+        MemorySerializeString(petName, pMem, offsetInOut, bDecodeStrings, memSize);
+        MemorySerializeString(petPrefix, pMem, offsetInOut, bDecodeStrings, memSize);
+        MemorySerializeString(petSuffix, pMem, offsetInOut, bDecodeStrings, memSize);
     }
 
     if (version >= 5)
     {
-        MemorySerialize(petAbility, pMem, offsetInOut, bWriteToMem);
+        MemorySerializeString(petAbility, pMem, offsetInOut, bDecodeStrings, memSize);
     }
 
-    MemorySerializeRaw(seedBase, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(seedOver, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(treeBase, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(treeOver, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(seedColor, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(treeColor, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(seed1, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(seed2, pMem, offsetInOut, bWriteToMem);
-    MemorySerializeRaw(bloomTime, pMem, offsetInOut, bWriteToMem);
+    ReadRaw(seedBase, pMem, offsetInOut, memSize);
+    ReadRaw(seedOver, pMem, offsetInOut, memSize);
+    ReadRaw(treeBase, pMem, offsetInOut, memSize);
+    ReadRaw(treeOver, pMem, offsetInOut, memSize);
+    ReadRaw(seedColor, pMem, offsetInOut, memSize);
+    ReadRaw(treeColor, pMem, offsetInOut, memSize);
+    ReadRaw(seed1, pMem, offsetInOut, memSize);
+    ReadRaw(seed2, pMem, offsetInOut, memSize);
+    ReadRaw(bloomTime, pMem, offsetInOut, memSize);
 
     if (version >= 7)
     {
-        MemorySerializeRaw(animationType, pMem, offsetInOut, bWriteToMem);
-        MemorySerialize(animString, pMem, offsetInOut, bWriteToMem);
+        ReadRaw(animationType, pMem, offsetInOut, memSize);
+        MemorySerializeString(animString, pMem, offsetInOut, bDecodeStrings, memSize);
     }
 
     if (version >= 8)
     {
-        MemorySerialize(animTexture, pMem, offsetInOut, bWriteToMem);
-        MemorySerialize(animString2, pMem, offsetInOut, bWriteToMem);
-        MemorySerializeRaw(DLayer1, pMem, offsetInOut, bWriteToMem);
-        MemorySerializeRaw(DLayer2, pMem, offsetInOut, bWriteToMem);
+        MemorySerializeString(animTexture, pMem, offsetInOut, bDecodeStrings, memSize);
+        MemorySerializeString(animString2, pMem, offsetInOut, bDecodeStrings, memSize);
+        ReadRaw(DLayer1, pMem, offsetInOut, memSize);
+        ReadRaw(DLayer2, pMem, offsetInOut, memSize);
     }
 
     if (version >= 9)
     {
-        MemorySerializeRaw(flags, pMem, offsetInOut, bWriteToMem);
+        ReadRaw(flags, pMem, offsetInOut, memSize);
         for (int i = 0; i < 60; i++)
         {
-            MemorySerializeRaw(clientData[i], pMem, offsetInOut, bWriteToMem);
+            ReadRaw(clientData[i], pMem, offsetInOut, memSize);
         }
 
     }
 
     if (version >= 10)
     {
-        MemorySerializeRaw(tileRange, pMem, offsetInOut, bWriteToMem);
-        MemorySerializeRaw(pileRange, pMem, offsetInOut, bWriteToMem);
+        ReadRaw(tileRange, pMem, offsetInOut, memSize);
+        ReadRaw(pileRange, pMem, offsetInOut, memSize);
     }
 
     if (version >= 11)
     {
-        MemorySerialize(customPunch, pMem, offsetInOut, bWriteToMem);
+        MemorySerializeString(customPunch, pMem, offsetInOut, bDecodeStrings, memSize);
     }
 
     if (version >= 12)
     {
-        MemorySerializeRaw(fxFlags, pMem, offsetInOut, bWriteToMem);
+        ReadRaw(fxFlags, pMem, offsetInOut, memSize);
         for (int i = 0; i < 9; i++)
         {
-            MemorySerializeRaw(bodyParts[i], pMem, offsetInOut, bWriteToMem);
+            ReadRaw(bodyParts[i], pMem, offsetInOut, memSize);
         }
     }
 
     if (version >= 13)
     {
-        MemorySerializeRaw(clockDivider, pMem, offsetInOut, bWriteToMem);
+        ReadRaw(clockDivider, pMem, offsetInOut, memSize);
     }
 
     if (version >= 14)
     {
-        MemorySerializeRaw(parentID, pMem, offsetInOut, bWriteToMem);
+        ReadRaw(parentID, pMem, offsetInOut, memSize);
     }
 
     if (version >= 13)
     {
-        MemorySerializeRaw(sitable, pMem, offsetInOut, bWriteToMem);
-        MemorySerializeRaw(sitOffsetX, pMem, offsetInOut, bWriteToMem);
-        MemorySerializeRaw(sitOffsetY, pMem, offsetInOut, bWriteToMem);
-        MemorySerializeRaw(sitOverlayX, pMem, offsetInOut, bWriteToMem);
-        MemorySerializeRaw(sitOverlayY, pMem, offsetInOut, bWriteToMem);
-        MemorySerializeRaw(sitOverlayOffsetX, pMem, offsetInOut, bWriteToMem);
-        MemorySerializeRaw(sitOverlayOffsetY, pMem, offsetInOut, bWriteToMem);
-        MemorySerialize(sitTexture, pMem, offsetInOut, bWriteToMem);
+        ReadRaw(sitable, pMem, offsetInOut, memSize);
+        ReadRaw(sitOffsetX, pMem, offsetInOut, memSize);
+        ReadRaw(sitOffsetY, pMem, offsetInOut, memSize);
+        ReadRaw(sitOverlayX, pMem, offsetInOut, memSize);
+        ReadRaw(sitOverlayY, pMem, offsetInOut, memSize);
+        ReadRaw(sitOverlayOffsetX, pMem, offsetInOut, memSize);
+        ReadRaw(sitOverlayOffsetY, pMem, offsetInOut, memSize);
+        MemorySerializeString(sitTexture, pMem, offsetInOut, bDecodeStrings, memSize);
     }
 
     if (version >= 16)
     {
-        MemorySerialize(rendererFile, pMem, offsetInOut, bWriteToMem);
+        MemorySerializeString(rendererFile, pMem, offsetInOut, bDecodeStrings, memSize);
     }
 
     if (version >= 17)
     {
-        MemorySerializeRaw(unwantedV17, pMem, offsetInOut, bWriteToMem);
+        ReadRaw(unwantedV17, pMem, offsetInOut, memSize);
     }
 
     if (version >= 18)
     {
-        MemorySerializeRaw(rendererHash, pMem, offsetInOut, bWriteToMem);
+        ReadRaw(rendererHash, pMem, offsetInOut, memSize);
     }
 
     if (version >= 19)
     {
         for (int i = 0; i < 9; i++)
         {
-            MemorySerializeRaw(unwantedV19[i], pMem, offsetInOut, bWriteToMem);
+            ReadRaw(unwantedV19[i], pMem, offsetInOut, memSize);
         }
     }
+
+    // reads past the end pushed the offset beyond memSize
+    return offsetInOut <= memSize;
+}
+
+void ItemInfo::DecodeColdFields()
+{
+    // the threads coming in while it's decoded wait for it
+    std::call_once(coldDecoded, [this]()
+    {
+        if (pColdData == NULL)
+        {
+            // parsed from the item definitions or the cache, nothing is left to decode
+            return;
+        }
+
+        uint8_t* pMem = pColdData;
+        int offset = 0;
+
+        pColdData = NULL;
+        SerializeFromMem(coldVersion, pMem, offset, true);
+    });
 }
\ No newline at end of file
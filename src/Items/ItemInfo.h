@@ -1,10 +1,14 @@
 #ifndef ITEMINFO_H
 #define ITEMINFO_H
+#include <mutex>
 #include <cstdint>
+#include <climits>
 #include <string>
 
 #include <Items/Defs.h>
 
+#define ITEM_CACHE_DATA_VERSION 19 // items.dat version used for the client side fields inside the item definitions cache
+
 class ItemInfo
 {
 public:
@@ -109,6 +113,11 @@ public:
     uint8_t randGroup = 0; //rand seeds like tangram, growsabers
     uint32_t lockPower = 0;
 
+    /*lazy decoding*/
+    uint8_t* pColdData = NULL; // record of this item inside the mapped items.dat, cleared once the string fields got decoded
+    uint16_t coldVersion = 0;
+    std::once_flag coldDecoded; // items are shared by every thread, only the first DecodeColdFields() decodes
+
 
     bool IsDropable();
     bool IsTrashable();
@@ -116,7 +125,14 @@ public:
 
     size_t GetMemoryEstimated(const uint16_t& version);
     void SerializeToMem(const uint16_t& version, uint8_t* pMem, int& offsetInOut);
-    void SerializeFromMem(const uint16_t& version, uint8_t* pMem, int& offsetInOut);
+    bool SerializeFromMem(const uint16_t& version, uint8_t* pMem, int& offsetInOut, const bool& bDecodeStrings = true, const int& memSize = INT_MAX); // false if the record runs past memSize, nothing past it is read
+
+    // client side fields (as items.dat V19) followed by the server side info, used by the item definitions cache
+    size_t GetCacheMemoryEstimated();
+    void SerializeCache(uint8_t* pMem, int& offsetInOut, const bool& bWriteToMem);
+
+    // decodes the string fields that were skipped while loading items.dat, call before touching name, textures, pet info, ...
+    void DecodeColdFields();
 };
 
 #endif ITEMINFO_H
\ No newline at end of file
@@ -6,11 +6,23 @@
 #include <SDK/Proton/MiscUtils.h>
 #include <SDK/Proton/FileSystem/FileManager.h>
 
-ItemInfoManager g_itemsManager;
-ItemInfoManager* GetItemInfoManager() { return &g_itemsManager; }
+#include <Items/ItemInfoPublisher.h>
+
+// the snapshot pinned for the current event loop iteration, see ItemInfoPublisher
+ItemInfoManager* GetItemInfoManager() { return GetItemInfoPublisher()->GetPinned(); }
 
 
 ItemInfoManager::~ItemInfoManager()
+{
+    Kill();
+    if (m_pUpdatePacket != NULL)
+    {
+        nova_dealloc(m_pUpdatePacket);
+        m_pUpdatePacket = NULL;
+    }
+}
+
+void ItemInfoManager::Kill()
 {
     for (int i = 0; i < m_items.size(); i++)
     {
@@ -20,27 +32,38 @@ ItemInfoManager::~ItemInfoManager()
             continue;
         }
 
-        // de-allocating the item
-        nova_delete(pItem);
+        // de-allocating the item, deleted through its type so the strings are freed too
+        delete pItem;
     }
 
     m_items.clear();
+    m_itemsByID.clear();
 }
 
-ItemInfo* ItemInfoManager::GetItemByID(const uint16_t& ID)
+void ItemInfoManager::AddItem(ItemInfo* pItem)
 {
-    for (int i = 0; i < m_items.size(); i++)
+    if (pItem->ID >= m_itemsByID.size())
     {
-        ItemInfo* pItem = m_items[i];
-        if (pItem == NULL || pItem->ID != ID)
-        {
-            continue;
-        }
+        m_itemsByID.resize(pItem->ID + 1, NULL);
+    }
 
-        return pItem;
+    // the first item added with an ID wins, same as the old linear lookup
+    if (m_itemsByID[pItem->ID] == NULL)
+    {
+        m_itemsByID[pItem->ID] = pItem;
     }
 
-    return NULL;
+    m_items.push_back(pItem);
+}
+
+ItemInfo* ItemInfoManager::GetItemByID(const uint16_t& ID)
+{
+    if (ID >= m_itemsByID.size())
+    {
+        return NULL;
+    }
+
+    return m_itemsByID[ID];
 }
 
 ItemInfo* ItemInfoManager::GetItemByName(std::string fName)
@@ -48,7 +71,13 @@ ItemInfo* ItemInfoManager::GetItemByName(std::string fName)
     for (int i = 0; i < m_items.size(); i++)
     {
         ItemInfo* pItem = m_items[i];
-        if (pItem == NULL || pItem->name != fName)
+        if (pItem == NULL)
+        {
+            continue;
+        }
+
+        pItem->DecodeColdFields();
+        if (pItem->name != fName)
         {
             continue;
         }
@@ -67,6 +96,7 @@ ItemInfo* ItemInfoManager::CreateSeedVersionOfLastAddedItem(const uint16_t& tile
         return NULL;
     }
 
+    pFruitItem->DecodeColdFields();
     ItemInfo* pTargetItem = GetItemByID(tileID + 1);
     if (pTargetItem != NULL)
     {
@@ -794,31 +824,244 @@ std::string ItemInfoManager::ItemFxFlagToString(const int& fxFlag)
     return "NONE";
 }
 
-bool ItemInfoManager::Load()
+// splits the definition lines into tokens, the lines are cut in equal chunks and tokenized on every core
+static std::vector<nova_stringarr> TokenizeDefinitionLines(const std::vector<nova_str>& lines)
 {
-    TextScanner t;
-    if (!t.LoadFile("item_definitions.txt"))
+    std::vector<nova_stringarr> records(lines.size());
+    size_t workersCount = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunkSize = (lines.size() + workersCount - 1) / workersCount;
+
+    auto tokenizeChunk = [&](const size_t& begin, const size_t& end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            const nova_str& line = lines[i];
+            if (line.starts_with('#') || line.empty())
+            {
+                continue;
+            }
+
+            records[i] = Utils::StringTokenize(line, "|");
+        }
+    };
+
+    if (workersCount == 1 || chunkSize == 0)
+    {
+        tokenizeChunk(0, lines.size());
+        return records;
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t begin = 0; begin < lines.size(); begin += chunkSize)
+    {
+        workers.emplace_back(tokenizeChunk, begin, std::min(begin + chunkSize, lines.size()));
+    }
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    return records;
+}
+
+bool ItemInfoManager::Load(const bool& bUseCache)
+{
+    if (!GetFileManager()->FileExists("file_hashes.txt"))
+    {
+        // the texture hashes come from it, cached or not
+        return false;
+    }
+
+    const uint32_t definitionsHash = Utils::GetHashOfFile("item_definitions.txt");
+    const uint32_t fileHashesHash = Utils::GetHashOfFile("file_hashes.txt");
+    if (bUseCache && LoadCache(ITEMS_CACHE_FILE, definitionsHash, fileHashesHash))
+    {
+        return true;
+    }
+
+    if (!ParseDefinitions())
+    {
+        return false;
+    }
+
+    if (bUseCache && !SaveCache(ITEMS_CACHE_FILE, definitionsHash, fileHashesHash))
+    {
+        LogError("failed to write %s, item definitions will be parsed again on next boot", ITEMS_CACHE_FILE);
+    }
+
+    return true;
+}
+
+bool ItemInfoManager::LoadCache(const std::string& fName, const uint32_t& definitionsHash, const uint32_t& fileHashesHash)
+{
+    MappedFile f;
+    if (!f.Open(fName))
+    {
+        // no cache yet
+        return false;
+    }
+
+    uint8_t* pMem = f.GetAsBytes();
+    int fileSize = (int)f.GetSize();
+    int offset = 0;
+
+    uint32_t magic = 0;
+    uint16_t cacheVersion = 0;
+    uint32_t cachedDefinitionsHash = 0;
+    uint32_t cachedFileHashesHash = 0;
+    int itemCount = 0;
+    uint32_t payloadLen = 0;
+    uint32_t checksum = 0;
+
+    const int headerSize = sizeof(magic) + sizeof(cacheVersion) + sizeof(cachedDefinitionsHash) + sizeof(cachedFileHashesHash) + sizeof(itemCount) + sizeof(payloadLen) + sizeof(checksum);
+    if (fileSize < headerSize)
+    {
+        return false;
+    }
+
+    MemorySerializeRaw(magic, pMem, offset, false);
+    MemorySerializeRaw(cacheVersion, pMem, offset, false);
+    MemorySerializeRaw(cachedDefinitionsHash, pMem, offset, false);
+    MemorySerializeRaw(cachedFileHashesHash, pMem, offset, false);
+    MemorySerializeRaw(itemCount, pMem, offset, false);
+    MemorySerializeRaw(payloadLen, pMem, offset, false);
+    MemorySerializeRaw(checksum, pMem, offset, false);
+
+    if (magic != ITEMS_CACHE_MAGIC || cacheVersion != ITEMS_CACHE_VERSION)
+    {
+        LogMsg("%s was written by another version, rebuilding it", fName.c_str());
+        return false;
+    }
+
+    if (cachedDefinitionsHash != definitionsHash || cachedFileHashesHash != fileHashesHash)
+    {
+        LogMsg("item definitions have changed, rebuilding %s", fName.c_str());
+        return false;
+    }
+
+    if (payloadLen != (uint32_t)(fileSize - headerSize) || Utils::HashString(pMem + headerSize, payloadLen) != checksum)
+    {
+        LogError("%s is corrupted, rebuilding it", fName.c_str());
+        return false;
+    }
+
+    m_items.reserve(itemCount);
+    for (int i = 0; i < itemCount; i++)
+    {
+        ItemInfo* pItem = new ItemInfo();
+        pItem->SerializeCache(pMem, offset, false);
+        if (offset > fileSize)
+        {
+            // the checksum matched but the items don't fit, cache is from a broken writer
+            delete pItem;
+            Kill();
+            return false;
+        }
+
+        AddItem(pItem);
+    }
+
+    LogMsg("loaded %d items from %s", (int)m_items.size(), fName.c_str());
+    return true;
+}
+
+bool ItemInfoManager::SaveCache(const std::string& fName, const uint32_t& definitionsHash, const uint32_t& fileHashesHash)
+{
+    size_t payloadLen = 0;
+    for (int i = 0; i < m_items.size(); i++)
+    {
+        ItemInfo* pItem = m_items[i];
+        if (pItem == NULL)
+        {
+            continue;
+        }
+
+        payloadLen += pItem->GetCacheMemoryEstimated();
+    }
+
+    uint32_t magic = ITEMS_CACHE_MAGIC;
+    uint16_t cacheVersion = ITEMS_CACHE_VERSION;
+    uint32_t cachedDefinitionsHash = definitionsHash;
+    uint32_t cachedFileHashesHash = fileHashesHash;
+    int itemCount = 0;
+    uint32_t payloadLen32 = (uint32_t)payloadLen;
+    uint32_t checksum = 0;
+
+    const int headerSize = sizeof(magic) + sizeof(cacheVersion) + sizeof(cachedDefinitionsHash) + sizeof(cachedFileHashesHash) + sizeof(itemCount) + sizeof(payloadLen32) + sizeof(checksum);
+    std::vector<uint8_t> data(headerSize + payloadLen, 0);
+    uint8_t* pMem = data.data();
+    int offset = headerSize;
+
+    for (int i = 0; i < m_items.size(); i++)
+    {
+        ItemInfo* pItem = m_items[i];
+        if (pItem == NULL)
+        {
+            continue;
+        }
+
+        pItem->SerializeCache(pMem, offset, true);
+        itemCount++;
+    }
+
+    checksum = Utils::HashString(pMem + headerSize, payloadLen32);
+    offset = 0;
+
+    MemorySerializeRaw(magic, pMem, offset, true);
+    MemorySerializeRaw(cacheVersion, pMem, offset, true);
+    MemorySerializeRaw(cachedDefinitionsHash, pMem, offset, true);
+    MemorySerializeRaw(cachedFileHashesHash, pMem, offset, true);
+    MemorySerializeRaw(itemCount, pMem, offset, true);
+    MemorySerializeRaw(payloadLen32, pMem, offset, true);
+    MemorySerializeRaw(checksum, pMem, offset, true);
+
+    // written next to the cache and renamed over it, a crash mid-write never leaves a half written cache behind
+    const std::string tempName = fName + ".tmp";
+    std::ofstream o(tempName, std::ios::binary | std::ios::trunc);
+    if (!o.is_open())
     {
         return false;
     }
 
-    TextScanner hashes;
-    if (!hashes.LoadFile("file_hashes.txt"))
+    o.write((const char*)pMem, data.size());
+    o.close();
+    if (o.fail())
+    {
+        std::remove(tempName.c_str());
+        return false;
+    }
+
+    std::remove(fName.c_str());
+    if (std::rename(tempName.c_str(), fName.c_str()) != 0)
+    {
+        std::remove(tempName.c_str());
+        return false;
+    }
+
+    LogMsg("saved %d items into %s", itemCount, fName.c_str());
+    return true;
+}
+
+bool ItemInfoManager::ParseDefinitions()
+{
+    TextScanner t;
+    if (!t.LoadFile("item_definitions.txt"))
     {
         return false;
     }
 
     int lastID = 0;
-    std::vector<nova_str> lines = t.GetLines();
-    for (int i = 0; i < lines.size(); i++)
+    std::vector<nova_stringarr> records = TokenizeDefinitionLines(t.GetLines());
+    for (int i = 0; i < records.size(); i++)
     {
-        const nova_str& line = lines[i];
-        if (line.starts_with('#') || line.empty())
+        const nova_stringarr& tokens = records[i];
+        if (tokens.empty())
         {
+            // comment or empty line
             continue;
         }
 
-        std::vector<nova_str> tokens = Utils::StringTokenize(line, "|");
         if (tokens[0] == "add_item")
         {
             if (tokens.size() < 15)
@@ -844,7 +1087,7 @@ bool ItemInfoManager::Load()
             pItem->regenTime = std::atoi(tokens[14].c_str());
 
             lastID = pItem->ID;
-            m_items.push_back(pItem);
+            AddItem(pItem);
         }
 
         if (tokens[0] == "setup_seed")
@@ -876,7 +1119,7 @@ bool ItemInfoManager::Load()
             pItem->bloomTime = std::atoi(tokens[12].c_str());
 
             lastID = pItem->ID;
-            m_items.push_back(pItem);
+            AddItem(pItem);
         }
 
         if (tokens[0] == "add_clothes")
@@ -905,7 +1148,7 @@ bool ItemInfoManager::Load()
             pItem->bodyPart = std::atoi(tokens[11].c_str());
 
             lastID = pItem->ID;
-            m_items.push_back(pItem);
+            AddItem(pItem);
         }
 
         if (tokens[0] == "set_extra_string")
@@ -1313,69 +1556,81 @@ bool ItemInfoManager::Load()
     return true;
 }
 
-bool ItemInfoManager::LoadFile()
+bool ItemInfoManager::LoadFile(const bool& bDumpDefinitions)
 {
-    FileInstance f("items.dat");
-    if (!f.IsLoaded())
+    // items.dat is mapped instead of read, the pages are shared with the page cache and the update packet is served straight from them
+    if (!m_itemsFile.Open("items.dat"))
     {
         LogError("failed to load items from file.");
         return false;
     }
 
-    char *pCharData = f.GetAsChars();
-    int size = f.GetSize();
+    uint8_t *pMem = m_itemsFile.GetAsBytes();
+    size_t size = m_itemsFile.GetSize();
     int offset = 0;
 
-    m_data = std::vector<char>(pCharData, pCharData + size);
-    m_hash = Utils::HashString(pCharData, size);
-    u8 *pMem = reinterpret_cast<u8*>(m_data.data());
+    if (size < sizeof(uint16_t) + sizeof(int))
+    {
+        LogError("items.dat is too small to contain any items.");
+        m_itemsFile.Close();
+        return false;
+    }
 
     MemorySerializeRaw(m_version, pMem, offset, false);
     MemorySerializeRaw(m_itemCount, pMem, offset, false);
 
-    std::ofstream o("enum.txt");
+    // one pass over the file, only the numeric fields are decoded
+    // string fields are stepped over and decoded on first access through ItemInfo::DecodeColdFields
+    m_items.reserve(m_itemCount);
     for (int i = 0; i < m_itemCount; i++)
     {
         ItemInfo *pItem = new ItemInfo();
-        pItem->SerializeFromMem(m_version, pMem, offset);
-        if (i != pItem->ID)
+        pItem->pColdData = pMem + offset;
+        pItem->coldVersion = m_version;
+        if (!pItem->SerializeFromMem(m_version, pMem, offset, false, (int)size) || i != pItem->ID)
         {
+            LogError("items.dat is corrupted, item %d is out of order or truncated.", i);
+            delete pItem;
             return false;
         }
 
-        std::string name = pItem->name;
-        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
-        Utils::StringReplace(" ", "_", name);
-        Utils::StringReplace("_-_", "_", name);
-        Utils::StringReplace("-", "_", name);
-        Utils::StringReplace(":", "_", name);
-        Utils::StringReplace("'", "_", name);
-        Utils::StringReplace("!", "_", name);
-        Utils::StringReplace("#", "_", name);
-        Utils::StringReplace(".", "_", name);
-        Utils::StringReplace("(", "_", name);
-        Utils::StringReplace(")", "_", name);
+        AddItem(pItem);
+    }
 
-        o << std::format("    ITEM_ID_{} = {},\n", name, pItem->ID);
-        m_items.push_back(pItem);
+    m_hash = Utils::HashString(pMem, (uint32_t)size);
+    if (!SetupUpdatePacket(pMem, (uint32_t)size))
+    {
+        return false;
     }
 
-    o.close();
-    m_pUpdatePacket = (GameUpdatePacket*)std::malloc(sizeof(GameUpdatePacket) + size);
+    LogMsg("loaded items from binary file(v%d).", m_version);
+    if (bDumpDefinitions)
+    {
+        DumpItemEnum();
+        DumpItemDefinitions();
+    }
+
+    return true;
+}
+
+bool ItemInfoManager::SetupUpdatePacket(const uint8_t* pData, const uint32_t& dataLen)
+{
     if (m_pUpdatePacket == NULL)
     {
-        return false;
+        m_pUpdatePacket = (GameUpdatePacket*)std::malloc(sizeof(GameUpdatePacket));
+        if (m_pUpdatePacket == NULL)
+        {
+            return false;
+        }
     }
 
-    std::memset(m_pUpdatePacket, 0, sizeof(GameUpdatePacket) + size);
+    std::memset(m_pUpdatePacket, 0, sizeof(GameUpdatePacket));
     m_pUpdatePacket->type = NET_GAME_PACKET_SEND_ITEM_DATABASE_DATA;
     m_pUpdatePacket->netID = -1;
     m_pUpdatePacket->flags |= NET_GAME_PACKET_FLAG_EXTENDED;
-    m_pUpdatePacket->dataLength = size;
-    nova_memcopy(&m_pUpdatePacket->data, pCharData, size, offset);
+    m_pUpdatePacket->dataLength = dataLen;
 
-    LogMsg("loaded items from binary file(v%d).", m_version);
-    DumpItemDefinitions();
+    m_pUpdateData = pData;
     return true;
 }
 
@@ -1397,20 +1652,34 @@ void ItemInfoManager::Serialize(const uint16_t& version)
     uint16_t ver = version;
     int items = (int)m_items.size();
 
-    m_pUpdatePacket = (GameUpdatePacket*)std::malloc(sizeof(GameUpdatePacket) + itemsDataLen);
-    if (m_pUpdatePacket == NULL)
+    m_data.assign(itemsDataLen, 0);
+    uint8_t* pData = reinterpret_cast<uint8_t*>(m_data.data());
+
+    MemorySerializeRaw(ver, pData, offsetIn, true);
+    MemorySerializeRaw(items, pData, offsetIn, true);
+    for (int i = 0; i < m_items.size(); i++)
+    {
+        ItemInfo* pItem = m_items[i];
+        if (pItem == NULL)
+        {
+            continue;
+        }
+
+        pItem->SerializeToMem(version, pData, offsetIn);
+    }
+
+    if (!SetupUpdatePacket(pData, (uint32_t)itemsDataLen))
     {
         return;
     }
 
-    std::memset(m_pUpdatePacket, 0, sizeof(GameUpdatePacket) + itemsDataLen);
-    m_pUpdatePacket->type = NET_GAME_PACKET_SEND_ITEM_DATABASE_DATA;
-    m_pUpdatePacket->netID = -1;
-    m_pUpdatePacket->flags |= NET_GAME_PACKET_FLAG_EXTENDED;
-    m_pUpdatePacket->dataLength = (uint32_t)itemsDataLen;
+    m_hash = Utils::HashString(pData, (uint32_t)itemsDataLen);
+    LogMsg("serializing items data for V%d completed, hash: %d", version, m_hash);
+}
 
-    MemorySerializeRaw(ver, m_pUpdatePacket->data, offsetIn, true);
-    MemorySerializeRaw(items, m_pUpdatePacket->data, offsetIn, true);
+void ItemInfoManager::DumpItemEnum()
+{
+    std::ofstream o("enum.txt");
     for (int i = 0; i < m_items.size(); i++)
     {
         ItemInfo* pItem = m_items[i];
@@ -1419,11 +1688,25 @@ void ItemInfoManager::Serialize(const uint16_t& version)
             continue;
         }
 
-        pItem->SerializeToMem(version, m_pUpdatePacket->data, offsetIn);
+        pItem->DecodeColdFields();
+
+        std::string name = pItem->name;
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        Utils::StringReplace(" ", "_", name);
+        Utils::StringReplace("_-_", "_", name);
+        Utils::StringReplace("-", "_", name);
+        Utils::StringReplace(":", "_", name);
+        Utils::StringReplace("'", "_", name);
+        Utils::StringReplace("!", "_", name);
+        Utils::StringReplace("#", "_", name);
+        Utils::StringReplace(".", "_", name);
+        Utils::StringReplace("(", "_", name);
+        Utils::StringReplace(")", "_", name);
+
+        o << std::format("    ITEM_ID_{} = {},\n", name, pItem->ID);
     }
 
-    m_hash = Utils::HashString(m_pUpdatePacket->data, (uint32_t)itemsDataLen);
-    LogMsg("serializing items data for V%d completed, hash: %d", version, m_hash);
+    o.close();
 }
 
 void ItemInfoManager::DumpItemDefinitions()
@@ -1472,6 +1755,7 @@ void ItemInfoManager::DumpItemDefinitions()
             continue;
         }
 
+        pItem->DecodeColdFields();
         if (pItem->type == TYPE_SEED)
         {
             nova_str seedRGBA = std::to_string((int)GET_RED(pItem->seedColor)) + "," + std::to_string((int)GET_GREEN(pItem->seedColor)) + "," + std::to_string((int)GET_BLUE(pItem->seedColor)) + "," + std::to_string((int)GET_ALPHA(pItem->seedColor));
@@ -5,6 +5,11 @@
 
 #include <Items/ItemInfo.h>
 #include <Packet/GameUpdatePacket.h>
+#include <SDK/Proton/FileSystem/MappedFile.h>
+
+#define ITEMS_CACHE_FILE "item_definitions.cache"
+#define ITEMS_CACHE_MAGIC 0x43494247 // GBIC
+#define ITEMS_CACHE_VERSION 1 // bump whenever ItemInfo::SerializeCache changes
 
 struct GrowSplice
 {
@@ -22,7 +27,8 @@ public:
 
 
 	uint32_t GetHash() const { return m_hash; }
-	GameUpdatePacket* GetUpdatePacket() const { return m_pUpdatePacket; }
+	GameUpdatePacket* GetUpdatePacket() const { return m_pUpdatePacket; } // header only, the items data is GetUpdatePacketData()
+	const uint8_t* GetUpdatePacketData() const { return m_pUpdateData; }
 	std::vector<ItemInfo*> GetItems() const { return m_items; }
 
 
@@ -54,21 +60,35 @@ public:
 	int StringToItemFxFlag(const std::string& str);
 	std::string ItemFxFlagToString(const int& fxFlag);
 
-	bool Load();
-	bool LoadFile();
+	// loads item_definitions.txt, through the binary cache when it's still up to date with the text files
+	bool Load(const bool& bUseCache = true);
+	bool LoadFile(const bool& bDumpDefinitions = false);
+
+	bool LoadCache(const std::string& fName, const uint32_t& definitionsHash, const uint32_t& fileHashesHash);
+	bool SaveCache(const std::string& fName, const uint32_t& definitionsHash, const uint32_t& fileHashesHash);
 
 	void Serialize(const uint16_t& version);
 	void DumpItemDefinitions();
+	void DumpItemEnum();
 
 private:
+	void Kill();
+	void AddItem(ItemInfo* pItem);
+	bool ParseDefinitions();
+	bool SetupUpdatePacket(const uint8_t* pData, const uint32_t& dataLen);
+
 	std::vector<char> m_data;
 	uint32_t m_hash = 0;
 	uint16_t m_version = 0;
 	int m_itemCount = 0;
 
 	GameUpdatePacket* m_pUpdatePacket = NULL;
+	const uint8_t* m_pUpdateData = NULL; // points either into m_data or into the mapped items.dat
+
+	MappedFile m_itemsFile;
 
 	std::vector<ItemInfo*> m_items;
+	std::vector<ItemInfo*> m_itemsByID; // indexed by item ID, NULL for unused IDs
 	std::vector<GrowSplice> m_splices;
 
 };
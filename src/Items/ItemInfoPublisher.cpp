@@ -0,0 +1,231 @@
+#include <BaseApp.h> // precompiled
+#include <Items/ItemInfoPublisher.h>
+
+#include <Server/ENetServer.h>
+#include <Client/GameClient.h>
+
+ItemInfoPublisher g_itemInfoPublisher;
+ItemInfoPublisher* GetItemInfoPublisher() { return &g_itemInfoPublisher; }
+
+// snapshot pinned by an ItemInfoPin of the current thread
+static thread_local std::shared_ptr<ItemInfoManager> t_pPinned;
+
+static std::filesystem::file_time_type GetWriteTime(const char* fName)
+{
+	std::error_code ec;
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(fName, ec);
+	if (ec)
+	{
+		// file is missing, treat as never written
+		return std::filesystem::file_time_type::min();
+	}
+
+	return writeTime;
+}
+
+ItemInfoPublisher::ItemInfoPublisher()
+{
+	// the boot snapshot, filled by Load()
+	m_pCurrent = std::make_shared<ItemInfoManager>();
+	m_pPinned = m_pCurrent.get();
+}
+
+ItemInfoPublisher::~ItemInfoPublisher()
+{
+	if (m_worker.joinable())
+	{
+		m_worker.join();
+	}
+
+	delete m_pPending.exchange(NULL);
+	m_pPinned = NULL;
+	m_pCurrent = NULL;
+
+	ReclaimRetired(true);
+}
+
+ItemInfoManager* ItemInfoPublisher::GetPinned() const
+{
+	return t_pPinned != NULL ? t_pPinned.get() : m_pPinned.load();
+}
+
+std::shared_ptr<ItemInfoManager> ItemInfoPublisher::GetCurrent()
+{
+	std::lock_guard<std::mutex> lock(m_currentMutex);
+	return m_pCurrent;
+}
+
+bool ItemInfoPublisher::BuildSnapshot(ItemInfoManager* pItems)
+{
+	if (!pItems->Load())
+	{
+		return false;
+	}
+
+	pItems->Serialize(ITEMS_DATA_SERIALIZE_VERSION);
+	return pItems->GetUpdatePacket() != NULL;
+}
+
+bool ItemInfoPublisher::Load()
+{
+	m_definitionsWriteTime = GetWriteTime("item_definitions.txt");
+	m_fileHashesWriteTime = GetWriteTime("file_hashes.txt");
+	m_lastSourceCheck = nova_clock::now();
+
+	return BuildSnapshot(m_pCurrent.get());
+}
+
+bool ItemInfoPublisher::Reload()
+{
+	if (m_bReloading.exchange(true))
+	{
+		// a snapshot is already being built or waits to be published
+		return false;
+	}
+
+	if (m_worker.joinable())
+	{
+		// the previous worker is done by now, it only clears m_bReloading on failure or after publishing
+		m_worker.join();
+	}
+
+	LogMsg("reloading items in the background...");
+	m_worker = std::thread([this]()
+	{
+		ItemInfoManager* pItems = new ItemInfoManager();
+		if (!BuildSnapshot(pItems))
+		{
+			LogError("failed to reload items, keeping the current ones");
+			delete pItems;
+
+			m_bReloading = false;
+			return;
+		}
+
+		m_pPending.store(pItems);
+	});
+
+	return true;
+}
+
+void ItemInfoPublisher::OnEventLoopTick()
+{
+	// no handler is running here, nothing holds an ItemInfo pointer from the previous iteration
+	m_epoch++;
+
+	ItemInfoManager* pPending = m_pPending.exchange(NULL);
+	if (pPending != NULL)
+	{
+		Publish(pPending);
+	}
+
+	ReclaimRetired();
+
+	auto now = nova_clock::now();
+	if (std::chrono::duration_cast<std::chrono::milliseconds>(now - m_lastSourceCheck).count() < ITEMS_SOURCE_CHECK_INTERVAL_MS)
+	{
+		return;
+	}
+
+	m_lastSourceCheck = now;
+	if (HaveSourcesChanged())
+	{
+		Reload();
+	}
+}
+
+void ItemInfoPublisher::Publish(ItemInfoManager* pItems)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_currentMutex);
+		m_retired.push_back({ m_pCurrent, m_epoch });
+		m_pCurrent = std::shared_ptr<ItemInfoManager>(pItems);
+		m_pPinned = pItems;
+	}
+
+	m_bReloading = false;
+
+	LogMsg("published new items snapshot, %d items, hash: %d", (int)pItems->GetItems().size(), pItems->GetHash());
+	PushToClients(pItems);
+}
+
+void ItemInfoPublisher::PushToClients(ItemInfoManager* pItems)
+{
+	GameUpdatePacket* pUpdatePacket = pItems->GetUpdatePacket();
+	if (pUpdatePacket == NULL || GetENetServer()->GetHostPtr() == NULL)
+	{
+		return;
+	}
+
+	// one enet packet shared by every peer, enet refcounts it and frees it once the last peer sent it
+	const eNetMessageType messageType = NET_MESSAGE_GAME_PACKET;
+	const uint32_t dataLen = pUpdatePacket->dataLength;
+	ENetPacket* pPacket = enet_packet_create(NULL, 5 + GUP_SIZE + dataLen, ENET_PACKET_FLAG_RELIABLE);
+	if (pPacket == NULL)
+	{
+		return;
+	}
+
+	std::memcpy(pPacket->data, &messageType, 4);
+	std::memcpy(pPacket->data + 4, pUpdatePacket, GUP_SIZE);
+	std::memcpy(pPacket->data + 4 + GUP_SIZE, pItems->GetUpdatePacketData(), dataLen);
+	pPacket->data[4 + GUP_SIZE + dataLen] = 0;
+
+	int clientsCount = 0;
+	GetENetServer()->Broadcast([&](GameClient* pClient)
+	{
+		if (pClient->SendENetPacket(pPacket))
+		{
+			clientsCount++;
+		}
+	});
+
+	if (pPacket->referenceCount == 0)
+	{
+		// nobody is connected
+		enet_packet_destroy(pPacket);
+	}
+
+	LogMsg("pushed new items data to %d clients", clientsCount);
+}
+
+void ItemInfoPublisher::ReclaimRetired(const bool& bForce)
+{
+	for (int i = 0; i < m_retired.size(); i++)
+	{
+		RetiredItemInfoManager& retired = m_retired[i];
+		if (!bForce && m_epoch - retired.retireEpoch < ITEMS_RETIRE_GRACE_EPOCHS)
+		{
+			continue;
+		}
+
+		// pinned threads keep their reference, the snapshot is freed with the last one
+		m_retired.erase(m_retired.begin() + i);
+		i--;
+	}
+}
+
+bool ItemInfoPublisher::HaveSourcesChanged()
+{
+	std::filesystem::file_time_type definitionsWriteTime = GetWriteTime("item_definitions.txt");
+	std::filesystem::file_time_type fileHashesWriteTime = GetWriteTime("file_hashes.txt");
+	if (definitionsWriteTime == m_definitionsWriteTime && fileHashesWriteTime == m_fileHashesWriteTime)
+	{
+		return false;
+	}
+
+	m_definitionsWriteTime = definitionsWriteTime;
+	m_fileHashesWriteTime = fileHashesWriteTime;
+	return true;
+}
+
+ItemInfoPin::ItemInfoPin()
+{
+	m_pPrevious = std::move(t_pPinned);
+	t_pPinned = GetItemInfoPublisher()->GetCurrent();
+}
+
+ItemInfoPin::~ItemInfoPin()
+{
+	t_pPinned = std::move(m_pPrevious);
+}
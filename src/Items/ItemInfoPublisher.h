@@ -0,0 +1,94 @@
+#ifndef ITEMINFOPUBLISHER_H
+#define ITEMINFOPUBLISHER_H
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+
+#include <Items/ItemInfoManager.h>
+
+#define ITEMS_DATA_SERIALIZE_VERSION 5 // items data version sent to the clients
+#define ITEMS_RETIRE_GRACE_EPOCHS 2 // event loop iterations a replaced snapshot is kept alive for
+#define ITEMS_SOURCE_CHECK_INTERVAL_MS 5000 // how often the item sources are checked for changes
+
+struct RetiredItemInfoManager
+{
+	std::shared_ptr<ItemInfoManager> pItems;
+	uint64_t retireEpoch;
+};
+
+/*
+* Owns the item database snapshots and swaps them at runtime.
+* 
+* A snapshot is an ItemInfoManager that is never modified once published. Reloads are built on a worker thread,
+* the event loop publishes the finished snapshot at the start of an iteration and readers keep using the snapshot
+* they got pinned for the whole iteration, so ItemInfo pointers never dangle in the middle of handling a packet.
+* Replaced snapshots are let go of once ITEMS_RETIRE_GRACE_EPOCHS iterations went by.
+*
+* Threads outside the event loop(world I/O, terrain generation) don't follow its iterations, they hold an ItemInfoPin while
+* they work instead. The pin keeps a reference on the snapshot it got & GetItemInfoManager() returns that snapshot on
+* the pinning thread, so a retired snapshot lives on until the last pin on it is gone.
+*/
+class ItemInfoPublisher
+{
+public:
+	ItemInfoPublisher();
+	~ItemInfoPublisher();
+
+	// get
+	ItemInfoManager*                     GetPinned() const; // the snapshot pinned by this thread, or the one of the event loop
+	uint64_t                             GetEpoch() const { return m_epoch; }
+	bool                                 IsReloading() const { return m_bReloading; }
+
+	// fn
+	bool                                 Load(); // loads the first snapshot on the calling thread, used on boot
+	bool                                 Reload(); // builds a new snapshot in the background, false if one is already being built
+	void                                 OnEventLoopTick(); // call from the event loop between events, never from a handler
+
+private:
+	friend class ItemInfoPin;
+
+	static bool                          BuildSnapshot(ItemInfoManager* pItems);
+	std::shared_ptr<ItemInfoManager>     GetCurrent();
+
+	void                                 Publish(ItemInfoManager* pItems);
+	void                                 PushToClients(ItemInfoManager* pItems);
+	void                                 ReclaimRetired(const bool& bForce = false);
+	bool                                 HaveSourcesChanged();
+
+	std::atomic<ItemInfoManager*>        m_pPinned = NULL; // snapshot handed out by GetItemInfoManager() during this iteration
+	std::shared_ptr<ItemInfoManager>     m_pCurrent; // owns m_pPinned, guarded by m_currentMutex
+	std::mutex                           m_currentMutex;
+	std::atomic<ItemInfoManager*>        m_pPending = NULL; // finished by the worker, waiting to be published
+
+	std::vector<RetiredItemInfoManager>  m_retired;
+	uint64_t                             m_epoch = 0;
+
+	std::thread                          m_worker;
+	std::atomic<bool>                    m_bReloading = false;
+
+	std::chrono::steady_clock::time_point m_lastSourceCheck;
+	std::filesystem::file_time_type      m_definitionsWriteTime;
+	std::filesystem::file_time_type      m_fileHashesWriteTime;
+};
+
+// pins the current snapshot for the lifetime of the pin, for threads outside the event loop
+class ItemInfoPin
+{
+public:
+	ItemInfoPin();
+	~ItemInfoPin();
+
+	ItemInfoPin(const ItemInfoPin&) = delete;
+	ItemInfoPin& operator=(const ItemInfoPin&) = delete;
+
+private:
+	std::shared_ptr<ItemInfoManager>     m_pPrevious; // pins nest, the outer one comes back when this one is gone
+};
+
+ItemInfoPublisher*                       GetItemInfoPublisher();
+
+#endif ITEMINFOPUBLISHER_H
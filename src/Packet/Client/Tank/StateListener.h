@@ -54,6 +54,13 @@ namespace TankPacketsListener
 			return;
 		}
 
+        if (!pWorld->GetWorldTileMap()->IsMoveValid(pClient->GetPosition(), CL_Vec2f(pTankPacket->vecX, pTankPacket->vecY)))
+		{
+            // went through a wall, noclip
+			pClient->SendVariantPacket({ "OnSetPos", pClient->GetPosition() }, pClient->GetNetID());
+			return;
+		}
+
         pTankPacket->netID = pClient->GetNetID();
 		pClient->SetPosition(pTankPacket->vecX, pTankPacket->vecY);
 
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * Read-only memory mapping of a file on disk.
+ *
+ * The mapped bytes stay valid until Close() is called or the instance is destroyed,
+ * pages are only brought into memory by the OS when they are touched.
+ */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsLoaded() const { return m_pData != NULL; }
+	uint8_t* GetAsBytes() const { return m_pData; }
+	char* GetAsChars() const { return (char*)m_pData; }
+	size_t GetSize() const { return m_size; }
+
+	bool Open(const std::string& fileName);
+	void Close();
+
+private:
+	uint8_t* m_pData = NULL;
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_hFile = NULL;
+	void* m_hMapping = NULL;
+#endif
+};
@@ -0,0 +1,136 @@
+#include <BaseApp.h> // precompiled
+#include <SDK/Proton/MemoryWriter.h>
+
+MemoryWriter::MemoryWriter(const size_t& initialCapacity)
+{
+	m_buffer.resize(initialCapacity > 0 ? initialCapacity : 1);
+	m_pData = m_buffer.data();
+	m_capacity = m_buffer.size();
+}
+
+MemoryWriter::MemoryWriter(const size_t& initialCapacity, const enet_uint32& packetFlags)
+{
+	m_pPacket = enet_packet_create(NULL, initialCapacity > 0 ? initialCapacity : 1, packetFlags);
+	if (m_pPacket == NULL)
+	{
+		m_bFailed = true;
+		return;
+	}
+
+	m_pData = m_pPacket->data;
+	m_capacity = m_pPacket->dataLength;
+}
+
+MemoryWriter::~MemoryWriter()
+{
+	if (m_pPacket != NULL)
+	{
+		// never released, nobody else references it
+		enet_packet_destroy(m_pPacket);
+		m_pPacket = NULL;
+	}
+}
+
+bool MemoryWriter::Grow(const size_t& needed)
+{
+	if (m_bFailed)
+	{
+		return false;
+	}
+
+	if (m_size + needed <= m_capacity)
+	{
+		return true;
+	}
+
+	size_t newCapacity = m_capacity * 2;
+	if (newCapacity < m_size + needed)
+	{
+		newCapacity = m_size + needed;
+	}
+
+	if (m_pPacket != NULL)
+	{
+		// enet keeps dataLength as the allocated size, it's shrunk back to m_size on release
+		if (enet_packet_resize(m_pPacket, newCapacity) != 0)
+		{
+			m_bFailed = true;
+			return false;
+		}
+
+		m_pData = m_pPacket->data;
+	}
+	else
+	{
+		m_buffer.resize(newCapacity);
+		m_pData = m_buffer.data();
+	}
+
+	m_capacity = newCapacity;
+	return true;
+}
+
+void MemoryWriter::WriteRaw(const void* pSource, const size_t& len)
+{
+	if (len == 0 || !Grow(len))
+	{
+		return;
+	}
+
+	std::memcpy(m_pData + m_size, pSource, len);
+	m_size += len;
+}
+
+void MemoryWriter::WriteString(const std::string& str)
+{
+	uint16_t len = (uint16_t)str.length();
+	if (str.length() > UINT16_MAX)
+	{
+		// wouldn't fit the length prefix, same limit as MemorySerialize
+		m_bFailed = true;
+		return;
+	}
+
+	Write(len);
+	WriteRaw(str.data(), len);
+}
+
+size_t MemoryWriter::Reserve(const size_t& len)
+{
+	size_t offset = m_size;
+	if (!Grow(len))
+	{
+		return offset;
+	}
+
+	std::memset(m_pData + m_size, 0, len);
+	m_size += len;
+	return offset;
+}
+
+void MemoryWriter::Reset()
+{
+	m_size = 0;
+	if (m_pPacket == NULL)
+	{
+		m_bFailed = false;
+	}
+}
+
+ENetPacket* MemoryWriter::ReleasePacket()
+{
+	if (m_pPacket == NULL || m_bFailed)
+	{
+		return NULL;
+	}
+
+	// shrinking only updates the length, the payload isn't copied
+	enet_packet_resize(m_pPacket, m_size);
+
+	ENetPacket* pPacket = m_pPacket;
+	m_pPacket = NULL;
+	m_pData = NULL;
+	m_size = 0;
+	m_capacity = 0;
+	return pPacket;
+}
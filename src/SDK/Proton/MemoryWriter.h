@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <enet/enet.h>
+
+/**
+ * Growable, bounds checked write buffer, used for single pass serialization.
+ *
+ * There's no need to estimate the size of what is written up front, the buffer grows geometrically as needed.
+ * It either writes into its own heap buffer (which keeps its capacity on Reset(), so the writer can be reused),
+ * or straight into the payload of an ENet packet, which is then handed over by ReleasePacket() without any extra copy.
+ *
+ * If growing fails the writer is marked as failed and every following write is ignored, check IsValid() when done.
+ */
+class MemoryWriter
+{
+public:
+	MemoryWriter(const size_t& initialCapacity = 256); // heap buffer
+	MemoryWriter(const size_t& initialCapacity, const enet_uint32& packetFlags); // enet packet payload
+	~MemoryWriter();
+
+	MemoryWriter(const MemoryWriter&) = delete;
+	MemoryWriter& operator=(const MemoryWriter&) = delete;
+
+	uint8_t* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_size; }
+	bool IsValid() const { return !m_bFailed; }
+
+	template <typename T> void Write(const T& var)
+	{
+		WriteRaw(&var, sizeof(T));
+	}
+
+	void WriteRaw(const void* pSource, const size_t& len);
+	void WriteString(const std::string& str); // uint16 length + chars, same layout as MemorySerialize
+	size_t Reserve(const size_t& len); // reserves len zeroed bytes to fill later(headers, sizes) & returns their offset, pointers into the buffer don't survive a write
+
+	void Reset(); // empties the buffer but keeps its capacity
+	ENetPacket* ReleasePacket(); // shrinks the enet packet to the written size & gives up ownership, NULL if failed or not in packet mode
+
+private:
+	bool Grow(const size_t& needed);
+
+	uint8_t* m_pData = NULL;
+	size_t m_size = 0;
+	size_t m_capacity = 0;
+	bool m_bFailed = false;
+
+	std::vector<uint8_t> m_buffer;
+	ENetPacket* m_pPacket = NULL;
+};
@@ -85,7 +85,7 @@ class Randomizer
 public:
     template<typename T> static T Get(T min, T max) 
     {
-        static std::mt19937 rng{ std::random_device()() };
+        static thread_local std::mt19937 rng{ std::random_device()() }; // worlds run on several threads at once
         if constexpr (std::is_integral<T>::value) 
         {
             std::uniform_int_distribution<T> distrib(min, max);
@@ -102,7 +102,7 @@ public:
 
     template<typename T> static T Get() 
     {
-        static std::mt19937 rng{ std::random_device()() };
+        static thread_local std::mt19937 rng{ std::random_device()() }; // worlds run on several threads at once
 
         if constexpr (std::is_integral<T>::value) 
         {
@@ -119,6 +119,27 @@ public:
     }
 };
 
+// small seeded generator(splitmix64) for bulk work like terrain generation, one instance per thread since it has no locking
+class FastRandom
+{
+public:
+    FastRandom(const uint64_t& seed) : m_state(seed) {}
+
+    uint64_t Next()
+    {
+        uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    int Get(const int& min, const int& max) { return min + (int)(Next() % (uint64_t)(max - min + 1)); } // both inclusive, like Randomizer::Get
+    bool Chance(const uint32_t& outOf, const uint32_t& hits) { return Next() % outOf < hits; } // hits in outOf
+
+private:
+    uint64_t m_state;
+};
+
 void MemorySerialize(std::string& num, uint8_t* pMem, int &offsetInOut, bool bWriteToMem);
 template <typename T> void MemorySerializeRaw(T& var, uint8_t* pMem, int& offsetInOut, bool bWriteToMem)
 {
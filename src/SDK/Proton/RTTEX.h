@@ -141,7 +141,7 @@ static bool IsTexHeaderGood(const uint8_t * pData, size_t& memOffset, RTTexHeade
 
 
 // func to read and parse RTTexMipHeader
-void ReadMipHeaders(const uint8_t * pData, size_t& memOffset, std::vector<RTTexMipHeader>& mipHeaders, int mipCount)
+static void ReadMipHeaders(const uint8_t * pData, size_t& memOffset, std::vector<RTTexMipHeader>& mipHeaders, int mipCount)
 {
 	if (pData == NULL)
 	{
@@ -159,8 +159,85 @@ void ReadMipHeaders(const uint8_t * pData, size_t& memOffset, std::vector<RTTexM
 	}
 }
 
+// decodes the largest mip of a rttex, RTPACK compressed or not, into RGBA pixels from the top row down
+static bool DecodeRTTex(const std::vector<uint8_t>& data, std::vector<uint8_t>& pixels, int& width, int& height)
+{
+	const uint8_t * pData = data.data();
+	size_t size = data.size();
+	std::vector<uint8_t> inflated;
+	if (size >= sizeof(RTPackHeader) && std::strncmp((const char*)pData, C_RTFILE_PACKAGE_HEADER, C_RTFILE_PACKAGE_HEADER_BYTE_SIZE) == 0)
+	{
+		RTPackHeader pack;
+		std::memcpy(&pack, pData, sizeof(RTPackHeader));
+		if (size < sizeof(RTPackHeader) + pack.CompressedSize)
+		{
+			// cut off
+			return false;
+		}
+
+		if (pack.CompressionType == C_COMPRESSION_ZLIB)
+		{
+			inflated.resize(pack.DecompressedSize);
+			uLongf inflatedSize = pack.DecompressedSize;
+			if (uncompress(inflated.data(), &inflatedSize, pData + sizeof(RTPackHeader), pack.CompressedSize) != Z_OK)
+			{
+				// broken zlib stream
+				return false;
+			}
+
+			pData = inflated.data();
+			size = inflatedSize;
+		}
+		else
+		{
+			pData += sizeof(RTPackHeader);
+			size = pack.CompressedSize;
+		}
+	}
+
+	size_t memOffset = 0;
+	RTTexHeader header;
+	if (size < sizeof(RTTexHeader) + sizeof(RTTexMipHeader) || !IsTexHeaderGood(pData, memOffset, header) || header.MipmapCount <= 0 || header.bAlreadyCompressed || header.Format == RT_FORMAT_EMBEDDED_FILE)
+	{
+		// not a texture, or one we can't decode without a gpu or image library
+		return false;
+	}
+
+	// every mip header is followed by its data, the largest mip comes first
+	RTTexMipHeader mip;
+	std::memcpy(&mip, pData + memOffset, sizeof(RTTexMipHeader));
+	memOffset += sizeof(RTTexMipHeader);
+
+	const size_t pixelsCount = (size_t)mip.Width * mip.Height;
+	const size_t bytesPerPixel = mip.Width <= 0 || mip.Height <= 0 ? 0 : mip.DataSize / pixelsCount;
+	if ((bytesPerPixel != 4 && bytesPerPixel != 3) || mip.DataSize != pixelsCount * bytesPerPixel || size < memOffset + mip.DataSize)
+	{
+		// only 8 bit RGBA & RGB
+		return false;
+	}
+
+	// stored upside down, the way opengl wants them
+	width = mip.Width;
+	height = mip.Height;
+	pixels.resize(pixelsCount * 4);
+	for (int y = 0; y < height; y++)
+	{
+		const uint8_t * pRow = pData + memOffset + (size_t)(height - 1 - y) * width * bytesPerPixel;
+		uint8_t * pOut = pixels.data() + (size_t)y * width * 4;
+		for (int x = 0; x < width; x++)
+		{
+			pOut[x * 4 + 0] = pRow[x * bytesPerPixel + 0];
+			pOut[x * 4 + 1] = pRow[x * bytesPerPixel + 1];
+			pOut[x * 4 + 2] = pRow[x * bytesPerPixel + 2];
+			pOut[x * 4 + 3] = bytesPerPixel == 4 ? pRow[x * bytesPerPixel + 3] : 255;
+		}
+	}
+
+	return true;
+}
+
 // proccess rttex file
-void ProcessRTTexFile(const std::string& filePath) 
+static void ProcessRTTexFile(const std::string& filePath) 
 {
 	try 
 	{
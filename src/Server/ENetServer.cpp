@@ -2,6 +2,9 @@
 
 #include <Server/ENetServer.h>
 #include <Client/GameClient.h>
+#include <Items/ItemInfoPublisher.h>
+#include <World/WorldsManager.h>
+#include <World/WorldScheduler.h>
 
 ENetServer g_server;
 ENetServer* GetENetServer() { return &g_server; }
@@ -84,8 +87,15 @@ void ENetServer::RunEventListener()
 	ENetEvent eEvent;
     while (m_bRunning)
     {
-        while (enet_host_service(m_pHost, &eEvent, GetConfig().enetTimeout) > 0)
+        // safe point between iterations, a reloaded items snapshot gets published here
+        GetItemInfoPublisher()->OnEventLoopTick();
+        GetWorldScheduler()->Run();
+        GetWorldsManager()->OnEventLoopTick();
+
+        // world packets wait in their mailboxes while more events are read, so there's no waiting for events while some are queued
+        while (enet_host_service(m_pHost, &eEvent, GetWorldScheduler()->GetPendingCount() > 0 ? 0 : GetConfig().enetTimeout) > 0)
         {
+            GetItemInfoPublisher()->OnEventLoopTick();
             switch (eEvent.type)
             {
                 case ENET_EVENT_TYPE_CONNECT:
@@ -108,7 +118,9 @@ void ENetServer::RunEventListener()
                         break;
                     }
 
-					// deleting player
+					// deleting player, after its queued world packets ran
+					GetWorldScheduler()->Run();
+					GetWorldsManager()->CancelEnter((GameClient*)eEvent.peer->data);
 					nova_delete(eEvent.peer->data);
                     eEvent.peer->data = NULL;
                     break;
@@ -121,12 +133,48 @@ void ENetServer::RunEventListener()
                         break;
                     }
 
-					// handling incoming packet
+					// packets that only concern the client's world run on the world threads, in parallel with other worlds
+					if (GetPacketHandler()->QueueWorldPacket(eEvent.peer, eEvent.packet))
+					{
+						break;
+					}
+
+					// anything else may touch any world or client, the queued world packets go first to keep the order
+					GetWorldScheduler()->Run();
                     GetPacketHandler()->HandleIncomingClientPacket(eEvent.peer, eEvent.packet);
                     enet_packet_destroy(eEvent.packet);
                     break;
                 }
             }
+
+            if (GetWorldScheduler()->GetPendingCount() >= WORLD_SCHEDULER_MAX_PENDING)
+            {
+                // busy server, not reading more events before these ran
+                GetWorldScheduler()->Run();
+            }
+
+            // tiles changed while handling the event go out as one tile update per world
+            GetWorldsManager()->OnEventLoopTick();
         }
     }
+}
+
+void ENetServer::Broadcast(std::function<void(GameClient*)> fCall)
+{
+	if (m_pHost == NULL)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_pHost->peerCount; i++)
+	{
+		ENetPeer* pPeer = &m_pHost->peers[i];
+		if (pPeer->state != ENET_PEER_STATE_CONNECTED || pPeer->data == NULL)
+		{
+			// slot is free or the peer is still connecting
+			continue;
+		}
+
+		fCall((GameClient*)pPeer->data);
+	}
 }
\ No newline at end of file
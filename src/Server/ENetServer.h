@@ -2,11 +2,13 @@
 #define ENETSERVER_H
 #include <cstdint>
 #include <vector>
+#include <functional>
 
 #include <enet/enet.h>
 #include <Server/PacketHandler.h>
 
 
+class GameClient;
 class ENetServer
 {
 public:
@@ -22,6 +24,9 @@ public:
 	void                        Kill();
 	void                        RunEventListener();
 
+	// calls fCall for every connected peer that has a client attached
+	void                        Broadcast(std::function<void(GameClient*)> fCall);
+
 private:
 	ENetHost *                  m_pHost = NULL;
 	uint16_t                    m_port = 17000;
@@ -2,6 +2,8 @@
 #include <Server/PacketHandler.h>
 
 #include <Client/GameClient.h>
+#include <World/World.h>
+#include <World/WorldScheduler.h>
 
 // text packets
 #include <Packet/Client/LogonPacketListener.h>
@@ -26,6 +28,38 @@ PacketHandler::PacketHandler(ENetHost* pHost)
 	m_pHost = pHost;
 }
 
+bool PacketHandler::QueueWorldPacket(ENetPeer* pConnectionPeer, ENetPacket* pPacket)
+{
+	if (pConnectionPeer == NULL || pConnectionPeer->data == NULL || pPacket == NULL || pPacket->dataLength < 60 || pPacket->dataLength > 61 || *(int*)pPacket->data != NET_MESSAGE_GAME_PACKET)
+	{
+		// not a tank packet, handled on the event loop
+		return false;
+	}
+
+	GameClient* pClient = (GameClient*)pConnectionPeer->data;
+	World* pWorld = pClient->GetWorld();
+	if (pWorld == NULL)
+	{
+		// not in a world
+		return false;
+	}
+
+	// only the tank packets that stay inside the world, HandleIncomingClientPacket handles them on the world thread
+	GameUpdatePacket* pTankPacket = reinterpret_cast<GameUpdatePacket*>(pPacket->data + 4);
+	switch (pTankPacket->type)
+	{
+		case NET_GAME_PACKET_STATE:
+		case NET_GAME_PACKET_UPDATE_STATUS:
+		case NET_GAME_PACKET_TILE_CHANGE_REQUEST:
+		{
+			GetWorldScheduler()->Post(pWorld, pClient, pPacket);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void PacketHandler::HandleIncomingClientPacket(ENetPeer* pConnectionPeer, ENetPacket* pPacket)
 {
 	if (pConnectionPeer == NULL || pPacket == NULL || pPacket->dataLength < 4)
@@ -113,7 +147,7 @@ void PacketHandler::HandleIncomingClientPacket(ENetPeer* pConnectionPeer, ENetPa
 				}
 
 				// sending the packet to update the items
-				pClient->SendPacketRaw(NET_MESSAGE_GAME_PACKET, pRefreshItemsPacket, GUP_SIZE + pRefreshItemsPacket->dataLength, ENET_PACKET_FLAG_RELIABLE);
+				pClient->SendPacketExtended(NET_MESSAGE_GAME_PACKET, pRefreshItemsPacket, GetItemInfoManager()->GetUpdatePacketData(), ENET_PACKET_FLAG_RELIABLE);
 				return;
 			}
 
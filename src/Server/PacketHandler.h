@@ -13,6 +13,7 @@ public:
 
 
     void        HandleIncomingClientPacket(ENetPeer* pConnectionPeer, ENetPacket* pPacket);
+    bool        QueueWorldPacket(ENetPeer* pConnectionPeer, ENetPacket* pPacket); // posts packets that only concern the client's world to its mailbox, true if the packet was taken
 
 private:
     ENetHost    *m_pHost = NULL;
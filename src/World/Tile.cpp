@@ -3,97 +3,125 @@
 
 #include <Items/ItemInfoManager.h>
 #include <World/TileExtraManager.h>
+#include <World/WorldTileMap.h>
 
-Tile::~Tile()
+#include <SDK/Proton/MiscUtils.h>
+
+uint8_t Tile::GetDamage() const
 {
-	//
-}
+	auto it = m_pTileMap->m_timers.find(m_index);
+	if (it == m_pTileMap->m_timers.end())
+	{
+		// tile was never damaged
+		return 0;
+	}
 
-bool Tile::HasFlag(const uint16_t& flag) 
-{ 
-	return m_flags & flag; 
+	return it->second.damage;
 }
 
-ItemInfo* Tile::GetItemInfo()
+std::chrono::steady_clock::time_point Tile::GetDamageTick() const
 {
-	if (m_foreground != ITEM_ID_BLANK)
+	auto it = m_pTileMap->m_timers.find(m_index);
+	if (it == m_pTileMap->m_timers.end())
 	{
-		// getting foreground item info
-		return GetItemInfoManager()->GetItemByID(m_foreground);
+		return std::chrono::steady_clock::time_point();
 	}
 
-	// getting background item info instead
-	return GetItemInfoManager()->GetItemByID(m_background);
+	return it->second.damageTick;
 }
 
-size_t Tile::GetMemoryEstimated(const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion)
+std::chrono::steady_clock::time_point Tile::GetTileFxTick() const
 {
-	ItemInfo * pItemInfo = GetItemInfo();
-	if (pItemInfo == NULL)
+	auto it = m_pTileMap->m_timers.find(m_index);
+	if (it == m_pTileMap->m_timers.end())
 	{
-		// item is null
-		return 0;
+		return std::chrono::steady_clock::time_point();
 	}
-	
-	size_t estimated = 0;
-	estimated += sizeof(uint16_t); // foreground item ID
-	estimated += sizeof(uint16_t); // background item ID
-	estimated += sizeof(uint16_t); // world lock tile index
-	estimated += sizeof(uint16_t); // tile flags
 
-	if (bClientSide && m_flags & TILEFLAG_LOCKED)
-	{
-		// when tile is locked by an area lock, we write parent tile's index to the packet, which represents x + y * width index of the tile in the world tile map
-		estimated += sizeof(uint16_t);
-	}
+	return it->second.fxTick;
+}
 
-	if (bClientSide == false)
+TileExtra* Tile::GetTileExtra() const
+{
+	auto it = m_pTileMap->m_extras.find(m_index);
+	if (it == m_pTileMap->m_extras.end())
 	{
-		// server side contains 2 more indexes:
-		// - index > x + y * width of where the tile is located in the tile map
-		// - parent > x + y * width of the world lock, if the tile is locked by an area lock instead of a world lock
-		estimated += sizeof(uint16_t);
+		// tile has no extra data
+		return NULL;
 	}
 
-	// now handling extended tile data(TileExtra)
-	if (m_pExtraData != NULL && m_flags & TILEFLAG_EXTRA_DATA && GetTileExtraManager()->IsSupported(pItemInfo->type, worldMapVersion))
+	return it->second;
+}
+
+ItemInfo* Tile::GetItemInfo() const
+{
+	const uint16_t foreground = GetForeground();
+	if (foreground != ITEM_ID_BLANK)
 	{
-		// if this check was passed, it means we have supported by the map version extra data to handle, otherwise client would either receive "bugged" / corrupted world data...
-		// or crash entirely when entering in it
-		estimated += sizeof(uint8_t); // extra tile type
-		switch (pItemInfo->type)
-		{
-			case TYPE_DOOR: case TYPE_PORTAL: case TYPE_MAIN_DOOR:
-		    {
-				TileExtraDoor * pExtraData = dynamic_cast<TileExtraDoor*>(m_pExtraData);
-				if (pExtraData == NULL)
-				{
-					// extra data is null
-					break;
-				}
-
-				estimated += pExtraData->GetMemoryEstimated(bClientSide, fClientVersion, worldMapVersion);
-				break;
-			}
-		}
+		// getting foreground item info
+		return GetItemInfoManager()->GetItemByID(foreground);
 	}
-	
-	return estimated;
+
+	// getting background item info instead
+	return GetItemInfoManager()->GetItemByID(GetBackground());
 }
 
 void Tile::ToggleFlag(const uint16_t& flag, const bool& bActivate)
 {
-	if (HasFlag(flag) && bActivate == false)
+	uint16_t& flags = m_pTileMap->GetWritableField(TILEFIELD_FLAGS, m_index);
+	if ((flags & flag) && bActivate == false)
 	{
 		// removing the flag
-		m_flags &= ~flag;
+		flags &= ~flag;
 	}
 
-	if (HasFlag(flag) == false && bActivate)
+	if ((flags & flag) == 0 && bActivate)
 	{
 		// adding the flag
-		m_flags |= flag;
+		flags |= flag;
+	}
+}
+
+void Tile::SetDamage(const uint8_t& damage)
+{
+	if (damage != 0)
+	{
+		m_pTileMap->m_timers[m_index].damage = damage;
+		return;
+	}
+
+	auto it = m_pTileMap->m_timers.find(m_index);
+	if (it == m_pTileMap->m_timers.end())
+	{
+		// wasn't damaged
+		return;
+	}
+
+	if (it->second.fxTick == std::chrono::steady_clock::time_point())
+	{
+		// nothing else is kept for this tile, dropping the entry
+		m_pTileMap->m_timers.erase(it);
+		return;
 	}
+
+	it->second.damage = 0;
+}
+
+void Tile::SetDamageTick(const std::chrono::steady_clock::time_point& tick)
+{
+	auto it = m_pTileMap->m_timers.find(m_index);
+	if (it == m_pTileMap->m_timers.end())
+	{
+		// not damaged, the tick only matters for the regeneration of damage
+		return;
+	}
+
+	it->second.damageTick = tick;
+}
+
+void Tile::SetTileFxTick(const std::chrono::steady_clock::time_point& tick)
+{
+	m_pTileMap->m_timers[m_index].fxTick = tick;
 }
 
 bool Tile::SetForeground(const uint16_t& tileID)
@@ -105,7 +133,7 @@ bool Tile::SetForeground(const uint16_t& tileID)
 		return false;
 	}
 
-	nova_delete(m_pExtraData); // deleting previous extra data to not leak memory
+	ResetTileExtra(); // deleting previous extra data to not leak memory
 	if (GetTileExtraManager()->HasExtraData(pItemInfo->type))
 	{
 		// item requires extra data to world
@@ -115,31 +143,12 @@ bool Tile::SetForeground(const uint16_t& tileID)
 			return false;
 		}
 
-		m_flags |= TILEFLAG_EXTRA_DATA;
-		switch (pItemInfo->type)
-		{
-			case TYPE_DOOR: case TYPE_PORTAL: case TYPE_MAIN_DOOR:
-			{
-				m_pExtraData = new TileExtraDoor();
-				m_pExtraData->SetExtraType(TILE_EXTRA_TYPE_DOOR);
-				TileExtraDoor * pExtraData = dynamic_cast<TileExtraDoor*>(m_pExtraData);
-				if (pExtraData == NULL)
-				{
-					// door data is null
-					break;
-				}
-
-				pExtraData->Label = "";
-				pExtraData->Flag = 0x3;
-				pExtraData->Destination = "";
-				pExtraData->UniqueID = "";
-				pExtraData->Password = "";
-				break;
-			}
-		}
+		// the extra starts out with the defaults of its type
+		m_pTileMap->GetWritableField(TILEFIELD_FLAGS, m_index) |= TILEFLAG_EXTRA_DATA;
+		m_pTileMap->m_extras[m_index] = m_pTileMap->m_extraPool.Create(GetTileExtraManager()->GetExtraType(pItemInfo->type));
 	}
 
-	m_foreground = tileID;
+	m_pTileMap->GetWritableField(TILEFIELD_FOREGROUND, m_index) = tileID;
 	return false;
 }
 
@@ -152,66 +161,93 @@ bool Tile::SetBackground(const uint16_t& tileID)
 		return false;
 	}
 
-	m_background = tileID;
+	m_pTileMap->GetWritableField(TILEFIELD_BACKGROUND, m_index) = tileID;
 	return true;
 }
 
 // removing all flags, then adding only the ones that don't reset when tile is broken
 void Tile::ResetNeccesaryFlags()
 {
+	uint16_t& flags = m_pTileMap->GetWritableField(TILEFIELD_FLAGS, m_index);
 	u8 new_flags = 0;
-	if (m_flags & TILEFLAG_WATER)
+	if (flags & TILEFLAG_WATER)
 	{
 		new_flags |= TILEFLAG_WATER;
 	}
 
-	if (m_flags & TILEFLAG_FIRE)
+	if (flags & TILEFLAG_FIRE)
 	{
 		new_flags |= TILEFLAG_FIRE;
 	}
 
-	if (m_flags & TILEFLAG_GLUE)
+	if (flags & TILEFLAG_GLUE)
 	{
 		new_flags |= TILEFLAG_GLUE;
 	}
 
-	if (m_flags & TILEFLAG_LOCKED)
+	if (flags & TILEFLAG_LOCKED)
 	{
 		new_flags |= TILEFLAG_LOCKED;
 	}
 
-	m_flags = new_flags;
+	flags = new_flags;
 }
 
 void Tile::ResetTileExtra()
 {
-	// nova_delete already has null pointer safety check, so we don't need it here
-	nova_delete(m_pExtraData);
-}
-
-void Tile::Serialize(uint8_t * pData, int& memOffset, const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion)
-{
-    if (pData == NULL)
+	auto it = m_pTileMap->m_extras.find(m_index);
+	if (it == m_pTileMap->m_extras.end())
 	{
-        // data is null
+		// tile has no extra data
 		return;
 	}
 
-	MemorySerializeRaw(m_foreground, pData, memOffset, true);
-	MemorySerializeRaw(m_background, pData, memOffset, true);
-	MemorySerializeRaw(m_lockIndex, pData, memOffset, true);
-	MemorySerializeRaw(m_flags, pData, memOffset, true);
+	// handing the slot back to the pool of the tile map
+	m_pTileMap->m_extraPool.Destroy(it->second);
+	m_pTileMap->m_extras.erase(it);
+}
+
+void Tile::Serialize(MemoryWriter& writer, const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion) const
+{
+	const uint16_t flags = GetFlags();
+	writer.Write(GetForeground());
+	writer.Write(GetBackground());
+	writer.Write(GetLockIndex());
+	writer.Write(flags);
 
-	if (bClientSide && m_flags & TILEFLAG_LOCKED)
+	if (bClientSide && flags & TILEFLAG_LOCKED)
 	{
-		MemorySerializeRaw(m_parent, pData, memOffset, true);
+		// when tile is locked by an area lock, we write parent tile's index to the packet, which represents x + y * width index of the tile in the world tile map
+		writer.Write(GetParent());
 	}
 
+	// the extra data is only looked up for the tiles flagged to have it
+	TileExtra * pExtraData = (flags & TILEFLAG_EXTRA_DATA) ? GetTileExtra() : NULL;
 	if (bClientSide == false)
 	{
-		// server side info explained in GetMemoryEstimated func
-		MemorySerializeRaw(m_index, pData, memOffset, true);
-		MemorySerializeRaw(m_lockIndex, pData, memOffset, true);
+		// server side contains 3 more indexes:
+		// - index > x + y * width of where the tile is located in the tile map
+		// - lock index > x + y * width of the world lock
+		// - parent > x + y * width of the area lock the tile is locked by
+		writer.Write(m_index);
+		writer.Write(GetLockIndex());
+		writer.Write(GetParent());
+
+		// followed by the extra type(TILE_EXTRA_TYPE_NONE when there's none), so loading doesn't depend on the item database
+		uint8_t extraType = pExtraData != NULL ? pExtraData->GetExtraType() : TILE_EXTRA_TYPE_NONE;
+		writer.Write(extraType);
+		if (extraType != TILE_EXTRA_TYPE_NONE)
+		{
+			pExtraData->Serialize(writer, bClientSide, fClientVersion, worldMapVersion);
+		}
+
+		return;
+	}
+
+	if (pExtraData == NULL)
+	{
+		// no extended tile data
+		return;
 	}
 
 	ItemInfo * pItemInfo = GetItemInfo();
@@ -222,28 +258,66 @@ void Tile::Serialize(uint8_t * pData, int& memOffset, const bool& bClientSide, c
 	}
 
 	// now handling extended tile data(TileExtra)
-	if (m_pExtraData != NULL && m_flags & TILEFLAG_EXTRA_DATA && GetTileExtraManager()->IsSupported(pItemInfo->type, worldMapVersion))
+	if (GetTileExtraManager()->IsSupported(pItemInfo->type, worldMapVersion))
 	{
 		// if this check was passed, it means we have supported by the map version extra data to handle, otherwise client would either receive "bugged" / corrupted world data...
 		// or crash entirely when entering in it
-		uint8_t extra_data_type = m_pExtraData->GetExtraType();
-		MemorySerializeRaw(extra_data_type, pData, memOffset, true);
-		LogMsgSafe("serializing extra data for type %d", extra_data_type);
+		writer.Write(pExtraData->GetExtraType());
+		pExtraData->Serialize(writer, bClientSide, fClientVersion, worldMapVersion);
+	}
+}
 
-		switch (pItemInfo->type)
-		{
-			case TYPE_DOOR: case TYPE_PORTAL: case TYPE_MAIN_DOOR:
-		    {
-				TileExtraDoor * pExtraData = dynamic_cast<TileExtraDoor*>(m_pExtraData);
-				if (pExtraData == NULL)
-				{
-					// extra data is null
-					break;
-				}
-
-				pExtraData->Serialize(pData, memOffset, bClientSide, fClientVersion, worldMapVersion);
-				break;
-			}
-		}
+bool Tile::Load(uint8_t* pData, int& memOffset, const bool& bClientSide, const uint16_t& worldMapVersion)
+{
+	if (pData == NULL || bClientSide)
+	{
+		// data is null, or client side data which can't be read back without the item database
+		return false;
+	}
+
+	// the stored index is skipped, the tile is loaded into the slot it's read for
+	uint16_t storedIndex = 0;
+	uint16_t parent = 0;
+	MemorySerializeRaw(m_pTileMap->GetWritableField(TILEFIELD_FOREGROUND, m_index), pData, memOffset, false);
+	MemorySerializeRaw(m_pTileMap->GetWritableField(TILEFIELD_BACKGROUND, m_index), pData, memOffset, false);
+	MemorySerializeRaw(m_pTileMap->GetWritableField(TILEFIELD_LOCK_INDEX, m_index), pData, memOffset, false);
+	MemorySerializeRaw(m_pTileMap->GetWritableField(TILEFIELD_FLAGS, m_index), pData, memOffset, false);
+	MemorySerializeRaw(storedIndex, pData, memOffset, false);
+	MemorySerializeRaw(m_pTileMap->GetWritableField(TILEFIELD_LOCK_INDEX, m_index), pData, memOffset, false);
+	MemorySerializeRaw(parent, pData, memOffset, false);
+	SetParent(parent);
+
+	uint8_t extraType = TILE_EXTRA_TYPE_NONE;
+	MemorySerializeRaw(extraType, pData, memOffset, false);
+
+	ResetTileExtra();
+	if (m_pTileMap->GetLock(m_index) != NULL)
+	{
+		// the lock that was here doesn't grant anything anymore, unless it's read back below
+		m_pTileMap->SetLockAccess(m_index, -1, {});
 	}
-}
\ No newline at end of file
+
+	if (extraType == TILE_EXTRA_TYPE_NONE)
+	{
+		return true;
+	}
+
+	TileExtra * pExtraData = m_pTileMap->m_extraPool.Create(extraType);
+	if (pExtraData == NULL)
+	{
+		// the data was written by a newer server, there's no way to know how long the extra data is
+		LogError("tile %d has unknown extra type %d", m_index, extraType);
+		return false;
+	}
+
+	pExtraData->Load(pData, memOffset, bClientSide, worldMapVersion);
+	m_pTileMap->m_extras[m_index] = pExtraData;
+	if (extraType == TILE_EXTRA_TYPE_LOCK)
+	{
+		// build checks read the access from the tile map
+		TileExtraLock * pLock = static_cast<TileExtraLock*>(pExtraData);
+		m_pTileMap->SetLockAccess(m_index, pLock->OwnerID, pLock->Admins);
+	}
+
+	return true;
+}
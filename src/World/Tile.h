@@ -2,6 +2,7 @@
 #define TILE_H
 #include <string>
 #include <chrono>
+#include <cstddef>
 
 #include <World/TileExtra.h>
 
@@ -44,76 +45,64 @@
 #define GAMEBATTLEFLAG_ENDLESS 0x0100 // whether game's timer is irrelevant and runs forever
 
 class ItemInfo;
+class WorldTileMap;
 class TileExtraManager;
+
+/*
+* Handle to a tile of a WorldTileMap. The tile itself is spread over the parallel arrays of the tile map(see WorldTileMap),
+* the handle only knows the map & the index, so it's copied around by value & used like the pointer it replaced:
+* pTile->GetForeground(), pTile == NULL, if (pTile). It stays valid until the tile map is resized.
+*/
 class Tile
 {
 public:
-	Tile()
-	{
-		m_foreground = ITEM_ID_BLANK;
-		m_background = ITEM_ID_BLANK;
-		m_parent = 0;
-		m_flags = TILEFLAGS_NONE;
-	}
-
-	Tile(const uint16_t& fg, const uint16_t& bg, const uint16_t& lockIndex, const uint16_t& flags)
-	{
-		m_foreground = fg;
-		m_background = bg;
-		m_parent = lockIndex;
-		m_flags = flags;
-	}
+	Tile() = default;
+	Tile(std::nullptr_t) {}
+	Tile(WorldTileMap* pTileMap, const uint16_t& index) : m_pTileMap(pTileMap), m_index(index) {}
 
-	~Tile();
+	Tile                                  *operator->() { return this; }
+	explicit                              operator bool() const { return m_pTileMap != NULL; }
+	bool                                  operator==(std::nullptr_t) const { return m_pTileMap == NULL; }
+	bool                                  operator==(const Tile& other) const { return m_pTileMap == other.m_pTileMap && m_index == other.m_index; }
 
 
 
 	// get
-	uint16_t                              GetForeground() const { return m_foreground; }
-	uint16_t                              GetBackground() const { return m_background; }
-	uint16_t                              GetParent() const { return m_parent; }
-	uint16_t                              GetFlags() const { return m_flags; }
+	uint16_t                              GetForeground() const;
+	uint16_t                              GetBackground() const;
+	uint16_t                              GetParent() const;
+	uint16_t                              GetFlags() const;
 	uint16_t                              GetIndex() const { return m_index; }
-	uint16_t                              GetLockIndex() const { return m_lockIndex; }
-	uint8_t                               GetDamage() const { return m_damage; }
-	bool                                  HasFlag(const uint16_t& flag);
-	TileExtra                             *GetTileExtra() { return m_pExtraData; }
-	ItemInfo                              *GetItemInfo();
-	size_t                                GetMemoryEstimated(const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5);
+	WorldTileMap                          *GetTileMap() const { return m_pTileMap; }
+	uint16_t                              GetLockIndex() const;
+	uint8_t                               GetDamage() const;
+	std::chrono::steady_clock::time_point GetDamageTick() const;
+	std::chrono::steady_clock::time_point GetTileFxTick() const;
+	bool                                  HasFlag(const uint16_t& flag) const { return GetFlags() & flag; }
+	TileExtra                             *GetTileExtra() const;
+	ItemInfo                              *GetItemInfo() const;
 
 	// set
 	bool                                  SetForeground(const uint16_t& tileID);
 	bool                                  SetBackground(const uint16_t& tileID);
-	void                                  SetParent(const uint16_t& lockIndex) { m_parent = lockIndex; }
-	void                                  SetFlags(const uint16_t& flags) { m_flags = flags; }
+	void                                  SetParent(const uint16_t& lockIndex);
+	void                                  SetFlags(const uint16_t& flags);
 	void                                  ToggleFlag(const uint16_t& flag, const bool& bActivate = false);
-	void                                  SetIndex(const uint16_t& index) { m_index = index; }
-	void                                  SetLockIndex(const uint16_t& lockIndex) { m_lockIndex = lockIndex; }
-	void                                  SetDamage(const uint8_t& damage) { m_damage = damage; }
+	void                                  SetLockIndex(const uint16_t& lockIndex);
+	void                                  SetDamage(const uint8_t& damage);
+	void                                  SetDamageTick(const std::chrono::steady_clock::time_point& tick); // only kept while the tile is damaged
+	void                                  SetTileFxTick(const std::chrono::steady_clock::time_point& tick);
 
 	// fn
 	void                                  ResetNeccesaryFlags();
 	void                                  ResetTileExtra();
 
-	void                                  Serialize(uint8_t * pData, int& memOffset, const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5);
-    void                                  Load(uint8_t * pData, int& memOffset, const bool& bClientSide = true, const uint16_t& worldMapVersion = 5);
-	
-public:
-	std::chrono::steady_clock::time_point DamageTick;
-	std::chrono::steady_clock::time_point TileFxTick;
+	void                                  Serialize(MemoryWriter& writer, const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5) const;
+	bool                                  Load(uint8_t * pData, int& memOffset, const bool& bClientSide = false, const uint16_t& worldMapVersion = 5); // server side data only, false if it can't be read
 
 private:
-	uint16_t                              m_foreground = ITEM_ID_BLANK;
-	uint16_t                              m_background = ITEM_ID_BLANK;
-	uint16_t                              m_parent = 0; // the index(x + y * width) of the parent lock
-	uint16_t                              m_flags = TILEFLAGS_NONE;
-
-	TileExtra                             *m_pExtraData = NULL;
-
-	// server side information
+	WorldTileMap                          *m_pTileMap = NULL; // NULL for the tiles outside of the map
 	uint16_t                              m_index = 0; // the index(x + y * width) of this tile
-	uint16_t                              m_lockIndex = 0; // the index(x + y * width) of the world lock
-	uint8_t                               m_damage = 0; // the amount of damage, that has been applied to this tile
 };
 
 #endif TILE_H
\ No newline at end of file
@@ -1,56 +1,165 @@
 #include <BaseApp.h> // precompiled
 #include <World/TileExtra.h>
 
-size_t TileExtraDoor::GetMemoryEstimated(const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion)
+// fields of every type, in the order they're serialized
+static constexpr TileExtraField s_doorFields[] =
 {
-    size_t estimated = 0;
-	estimated += sizeof(uint16_t) + Label.length();
-	estimated += sizeof(uint8_t); //door flags
+    TILE_EXTRA_FIELD(TileExtraDoor, Label, 0, 0),
+    TILE_EXTRA_FIELD(TileExtraDoor, Flag, 0, 0),
+    TILE_EXTRA_FIELD(TileExtraDoor, UniqueID, TILE_EXTRA_FIELD_SERVER_SIDE, 0),
+    TILE_EXTRA_FIELD(TileExtraDoor, Destination, TILE_EXTRA_FIELD_SERVER_SIDE, 0),
+    TILE_EXTRA_FIELD(TileExtraDoor, Password, TILE_EXTRA_FIELD_SERVER_SIDE, 0)
+};
 
-	if (bClientSide == false)
-	{
-		estimated += sizeof(uint16_t) + UniqueID.length();
-		estimated += sizeof(uint16_t) + Destination.length();
-		estimated += sizeof(uint16_t) + Password.length();
-	}
+static constexpr TileExtraField s_lockFields[] =
+{
+    TILE_EXTRA_FIELD(TileExtraLock, Flags, 0, 0),
+    TILE_EXTRA_FIELD(TileExtraLock, OwnerID, 0, 0),
+    TILE_EXTRA_FIELD(TileExtraLock, Admins, 0, 0),
+    TILE_EXTRA_FIELD(TileExtraLock, Reserved, 0, 0)
+};
+
+static constexpr TileExtraSchema s_tileExtraSchemas[] =
+{
+    TILE_EXTRA_SCHEMA(TileExtraDoor, s_doorFields),
+    TILE_EXTRA_SCHEMA(TileExtraLock, s_lockFields)
+};
+
+// extra type to its schema, built once at compile time so the lookup is a single load
+static constexpr std::array<const TileExtraSchema*, 256> s_tileExtraSchemaTable = []()
+{
+    std::array<const TileExtraSchema*, 256> table = {};
+    for (const TileExtraSchema& schema : s_tileExtraSchemas)
+    {
+        table[schema.type] = &schema;
+    }
 
-	return estimated;
+    return table;
+}();
+
+const TileExtraSchema* GetTileExtraSchema(const uint8_t& type)
+{
+    return s_tileExtraSchemaTable[type];
 }
 
-void TileExtraDoor::Serialize(uint8_t* pData, int& memOffset, const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion)
+size_t TileExtra::GetHeapUsage() const
 {
-    if (pData == NULL)
-	{
-        // data is null
-		return;
-	}
+    const TileExtraSchema * pSchema = GetTileExtraSchema(m_type);
+    if (pSchema == NULL)
+    {
+        return 0;
+    }
+
+    size_t usage = 0;
+    for (int i = 0; i < pSchema->fieldsCount; i++)
+    {
+        usage += pSchema->pFields[i].heapUsage(this);
+    }
 
-	MemorySerialize(Label, pData, memOffset, true);
-	MemorySerializeRaw(Flag, pData, memOffset, true);
-	if (bClientSide == false)
-	{
-        // server side infos
-		MemorySerialize(UniqueID, pData, memOffset, true);
-		MemorySerialize(Destination, pData, memOffset, true);
-		MemorySerialize(Password, pData, memOffset, true);
-	}
+    return usage;
 }
 
-void TileExtraDoor::Load(uint8_t* pData, int& memOffset, const bool& bClientSide, const uint16_t& worldMapVersion)
+void TileExtra::Serialize(MemoryWriter& writer, const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion) const
 {
-    if (pData == NULL)
-	{
+    const TileExtraSchema * pSchema = GetTileExtraSchema(m_type);
+    if (pSchema == NULL)
+    {
+        // extras are only created for handled types
+        return;
+    }
+
+    for (int i = 0; i < pSchema->fieldsCount; i++)
+    {
+        const TileExtraField& field = pSchema->pFields[i];
+        if ((bClientSide && (field.flags & TILE_EXTRA_FIELD_SERVER_SIDE)) || worldMapVersion < field.minMapVersion)
+        {
+            // not part of this serialization
+            continue;
+        }
+
+        field.write(this, writer);
+    }
+}
+
+void TileExtra::Load(uint8_t* pData, int& memOffset, const bool& bClientSide, const uint16_t& worldMapVersion)
+{
+    const TileExtraSchema * pSchema = GetTileExtraSchema(m_type);
+    if (pData == NULL || pSchema == NULL)
+    {
         // data is null
-		return;
-	}
-
-	MemorySerialize(Label, pData, memOffset, false);
-	MemorySerializeRaw(Flag, pData, memOffset, false);
-	if (bClientSide == false)
-	{
-        // server side infos
-		MemorySerialize(UniqueID, pData, memOffset, false);
-		MemorySerialize(Destination, pData, memOffset, false);
-		MemorySerialize(Password, pData, memOffset, false);
-	}
-}
\ No newline at end of file
+        return;
+    }
+
+    for (int i = 0; i < pSchema->fieldsCount; i++)
+    {
+        const TileExtraField& field = pSchema->pFields[i];
+        if ((bClientSide && (field.flags & TILE_EXTRA_FIELD_SERVER_SIDE)) || worldMapVersion < field.minMapVersion)
+        {
+            // not part of this serialization
+            continue;
+        }
+
+        field.load(this, pData, memOffset);
+    }
+}
+
+TileExtraPool::~TileExtraPool()
+{
+    for (auto& pool : m_pools)
+    {
+        const TileExtraSchema * pSchema = GetTileExtraSchema(pool.first);
+        for (int i = 0; i < pool.second.blocks.size(); i++)
+        {
+            ::operator delete(pool.second.blocks[i], std::align_val_t(pSchema->alignment));
+        }
+    }
+}
+
+size_t TileExtraPool::GetMemoryUsage() const
+{
+    size_t usage = 0;
+    for (auto& pool : m_pools)
+    {
+        const TileExtraSchema * pSchema = GetTileExtraSchema(pool.first);
+        usage += pool.second.blocks.size() * pSchema->size * TILE_EXTRA_POOL_BLOCK + pool.second.freeSlots.capacity() * sizeof(void*);
+    }
+
+    return usage;
+}
+
+TileExtra* TileExtraPool::Create(const uint8_t& type)
+{
+    const TileExtraSchema * pSchema = GetTileExtraSchema(type);
+    if (pSchema == NULL)
+    {
+        // type isn't handled
+        return NULL;
+    }
+
+    TileExtraTypePool& pool = m_pools[type];
+    if (pool.freeSlots.empty())
+    {
+        // out of slots, carving a new block
+        uint8_t * pBlock = (uint8_t*)::operator new(pSchema->size * TILE_EXTRA_POOL_BLOCK, std::align_val_t(pSchema->alignment));
+        pool.blocks.push_back(pBlock);
+        for (int i = TILE_EXTRA_POOL_BLOCK - 1; i >= 0; i--)
+        {
+            pool.freeSlots.push_back(pBlock + i * pSchema->size);
+        }
+    }
+
+    void * pSlot = pool.freeSlots.back();
+    pool.freeSlots.pop_back();
+    return pSchema->construct(pSlot);
+}
+
+void TileExtraPool::Destroy(TileExtra* pExtra)
+{
+    if (pExtra == NULL)
+    {
+        return;
+    }
+
+    const uint8_t type = pExtra->GetExtraType();
+    m_pools[type].freeSlots.push_back(GetTileExtraSchema(type)->destruct(pExtra));
+}
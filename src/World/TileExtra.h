@@ -5,9 +5,12 @@
 #include <random>
 #include <chrono>
 #include <vector>
+#include <new>
+#include <type_traits>
 #include <unordered_map>
 
 #include <SDK/Proton/MiscUtils.h>
+#include <SDK/Proton/MemoryWriter.h>
 
 enum eTileExtraType : uint8_t
 {
@@ -177,6 +180,42 @@ struct GameConfig
 	int         duration;
 };
 
+#define TILE_EXTRA_POOL_BLOCK 64 // slots a TileExtraPool allocates at once for a type
+#define TILE_EXTRA_FIELD_SERVER_SIDE 0x1 // field is only kept by the server, never sent to clients
+
+// fowarded definitions
+class TileExtra;
+
+// one serialized field of a tile extra, declared with TILE_EXTRA_FIELD
+struct TileExtraField
+{
+    uint8_t                  flags;
+    uint16_t                 minMapVersion; // only written & read from this world map version on
+    void                     (*write)(const TileExtra* pExtra, MemoryWriter& writer);
+    void                     (*load)(TileExtra* pExtra, uint8_t* pData, int& memOffset);
+    size_t                   (*heapUsage)(const TileExtra* pExtra); // bytes the field holds outside of the extra itself
+};
+
+// describes a tile extra type once, serializing, loading, allocating & measuring it is all driven by this
+struct TileExtraSchema
+{
+    uint8_t                  type;
+    size_t                   size;
+    size_t                   alignment;
+    const TileExtraField     *pFields;
+    int                      fieldsCount;
+    TileExtra                *(*construct)(void* pMem);
+    void                     *(*destruct)(TileExtra* pExtra); // returns the slot the extra was constructed in
+};
+
+// NULL for the types that aren't handled
+const TileExtraSchema        *GetTileExtraSchema(const uint8_t& type);
+
+/*
+* Tile extras are plain data, the fields of every type are listed in its schema(see TileExtra.cpp) in the order they're
+* serialized, so adding a type only takes the struct & its field list. There are no virtuals, the schema is looked up by
+* the extra type.
+*/
 class TileExtra
 {
 public:
@@ -185,20 +224,15 @@ public:
         m_type = type;
     }
 
-    ~TileExtra() = default;
-
     
     // get
     uint8_t                  GetExtraType() const { return m_type; }
-    virtual size_t           GetMemoryEstimated(const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5) = 0;
-
-    // set
-    void                     SetExtraType(const uint8_t& type) { m_type = type; }
+    size_t                   GetHeapUsage() const; // bytes the fields hold outside of the extra, strings mostly
 
 
     // fn
-    virtual void             Serialize(uint8_t * pData, int& memOffset, const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5) = 0;
-    virtual void             Load(uint8_t * pData, int& memOffset, const bool& bClientSide = true, const uint16_t& worldMapVersion = 5) = 0;
+    void                     Serialize(MemoryWriter& writer, const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5) const;
+    void                     Load(uint8_t * pData, int& memOffset, const bool& bClientSide = true, const uint16_t& worldMapVersion = 5);
 
 private:
     uint8_t                  m_type = 0;
@@ -208,23 +242,140 @@ private:
 class TileExtraDoor : public TileExtra
 {
 public:
-    TileExtraDoor() : TileExtra(TILE_EXTRA_TYPE_DOOR) {}
-    ~TileExtraDoor() = default;
-
-
-    // get
-    size_t           GetMemoryEstimated(const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5) override;
-
-    // fn
-    void             Serialize(uint8_t * pData, int& memOffset, const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5) override;
-    void             Load(uint8_t * pData, int& memOffset, const bool& bClientSide = true, const uint16_t& worldMapVersion = 5) override;
+    static constexpr uint8_t Type = TILE_EXTRA_TYPE_DOOR;
+    TileExtraDoor() : TileExtra(Type) {}
 
 public:
     std::string      Label = "";
     std::string      Destination = "";
     std::string      UniqueID = "";
     std::string      Password = "";
-    uint8_t          Flag = 0;
+    uint8_t          Flag = 0x3;
+
+};
+
+class TileExtraLock : public TileExtra
+{
+public:
+    static constexpr uint8_t Type = TILE_EXTRA_TYPE_LOCK;
+    TileExtraLock() : TileExtra(Type) {}
+
+public:
+    uint8_t          Flags = LOCK_FLAG_NONE;
+    int              OwnerID = -1; // userID
+    std::vector<int> Admins; // userIDs that can build in the lock besides the owner
+    uint64_t         Reserved = 0; // the client reads 8 more bytes after the admins
+
+};
+
+template <typename T, typename V, V T::*Member>
+struct TileExtraFieldCodec
+{
+    static void Write(const TileExtra* pExtra, MemoryWriter& writer)
+    {
+        const V& value = static_cast<const T*>(pExtra)->*Member;
+        if constexpr (std::is_same_v<V, std::string>)
+        {
+            writer.WriteString(value);
+        }
+        else if constexpr (std::is_same_v<V, std::vector<int>>)
+        {
+            // count first, same as the client reads it
+            writer.Write((uint32_t)value.size());
+            for (int i = 0; i < value.size(); i++)
+            {
+                writer.Write(value[i]);
+            }
+        }
+        else
+        {
+            writer.Write(value);
+        }
+    }
+
+    static void Load(TileExtra* pExtra, uint8_t* pData, int& memOffset)
+    {
+        V& value = static_cast<T*>(pExtra)->*Member;
+        if constexpr (std::is_same_v<V, std::string>)
+        {
+            MemorySerialize(value, pData, memOffset, false);
+        }
+        else if constexpr (std::is_same_v<V, std::vector<int>>)
+        {
+            uint32_t count = 0;
+            MemorySerializeRaw(count, pData, memOffset, false);
+            value.resize(count);
+            for (int i = 0; i < value.size(); i++)
+            {
+                MemorySerializeRaw(value[i], pData, memOffset, false);
+            }
+        }
+        else
+        {
+            MemorySerializeRaw(value, pData, memOffset, false);
+        }
+    }
+
+    static size_t HeapUsage(const TileExtra* pExtra)
+    {
+        if constexpr (std::is_same_v<V, std::string>)
+        {
+            const std::string& value = static_cast<const T*>(pExtra)->*Member;
+            return value.capacity() > std::string().capacity() ? value.capacity() + 1 : 0; // short strings are stored inline
+        }
+        else if constexpr (std::is_same_v<V, std::vector<int>>)
+        {
+            return (static_cast<const T*>(pExtra)->*Member).capacity() * sizeof(int);
+        }
+        else
+        {
+            return 0;
+        }
+    }
+};
+
+#define TILE_EXTRA_FIELD(type, member, flags, minMapVersion) \
+    TileExtraField{ flags, minMapVersion, &TileExtraFieldCodec<type, decltype(type::member), &type::member>::Write, \
+        &TileExtraFieldCodec<type, decltype(type::member), &type::member>::Load, &TileExtraFieldCodec<type, decltype(type::member), &type::member>::HeapUsage }
+
+template <typename T> TileExtra* ConstructTileExtra(void* pMem) { return new (pMem) T(); }
+template <typename T> void* DestructTileExtra(TileExtra* pExtra) { T* pTyped = static_cast<T*>(pExtra); pTyped->~T(); return pTyped; }
+
+#define TILE_EXTRA_SCHEMA(type, fields) \
+    TileExtraSchema{ type::Type, sizeof(type), alignof(type), fields, (int)(sizeof(fields) / sizeof(fields[0])), &ConstructTileExtra<type>, &DestructTileExtra<type> }
+
+struct TileExtraTypePool
+{
+    std::vector<void*>       blocks; // TILE_EXTRA_POOL_BLOCK slots each
+    std::vector<void*>       freeSlots;
+};
+
+/*
+* Allocates the tile extras of a tile map. Extras of a type are carved out of blocks of TILE_EXTRA_POOL_BLOCK slots & freed
+* slots are reused by the next extra of that type, so a world's extras sit together & placing or breaking doors doesn't
+* hit the heap. Blocks are only given back when the pool is destroyed.
+*/
+class TileExtraPool
+{
+public:
+    TileExtraPool() = default;
+    ~TileExtraPool();
+
+    TileExtraPool(const TileExtraPool&) = delete;
+    TileExtraPool& operator=(const TileExtraPool&) = delete;
+
+
+    // get
+    size_t                   GetMemoryUsage() const; // bytes of the blocks
+
+
+    // fn
+    TileExtra                *Create(const uint8_t& type); // NULL if the type isn't handled
+    template <typename T> T  *Create() { return static_cast<T*>(Create(T::Type)); }
+    void                     Destroy(TileExtra* pExtra);
+
+private:
+    std::unordered_map<uint8_t, TileExtraTypePool> m_pools; // extra type to its slots
 
 };
 
@@ -2,36 +2,40 @@
 #include <World/TileExtraManager.h>
 
 #include <Items/Defs.h> // for enums
+#include <World/TileExtra.h>
 
 TileExtraManager g_tileExtraManager;
 TileExtraManager * GetTileExtraManager() { return &g_tileExtraManager; }
 
-bool TileExtraManager::HasExtraData(const uint8_t& type, const uint16_t& worldMapVersion)
+uint8_t TileExtraManager::GetExtraType(const uint8_t& itemType)
 {
-    switch (type)
+    switch (itemType)
     {
         case TYPE_DOOR: case TYPE_PORTAL: case TYPE_MAIN_DOOR:
         {
             // door tile extra type
             // tile extra type: 1
-            return true;
+            return TILE_EXTRA_TYPE_DOOR;
+        }
+
+        case TYPE_LOCK:
+        {
+            // lock tile extra type
+            // tile extra type: 3
+            return TILE_EXTRA_TYPE_LOCK;
         }
     }
 
-    return false;
+    return TILE_EXTRA_TYPE_NONE;
 }
 
-bool TileExtraManager::IsSupported(const uint8_t& type, const uint16_t& worldMapVersion)
+bool TileExtraManager::HasExtraData(const uint8_t& type, const uint16_t& worldMapVersion)
 {
-    switch (type)
-    {
-        case TYPE_DOOR: case TYPE_PORTAL: case TYPE_MAIN_DOOR:
-        {
-            // door tile extra type
-            // tile extra type: 1
-            return true;
-        }
-    }
+    return GetExtraType(type) != TILE_EXTRA_TYPE_NONE;
+}
 
-    return false;
+bool TileExtraManager::IsSupported(const uint8_t& type, const uint16_t& worldMapVersion)
+{
+    // supported once the extra type has a schema
+    return GetTileExtraSchema(GetExtraType(type)) != NULL;
 }
\ No newline at end of file
@@ -10,6 +10,7 @@ public:
     ~TileExtraManager() = default;
 
     // get
+    uint8_t             GetExtraType(const uint8_t& itemType); // TILE_EXTRA_TYPE_NONE for items without extra data
     bool                HasExtraData(const uint8_t& type, const uint16_t& worldMapVersion = 5);
     bool                IsSupported(const uint8_t& type, const uint16_t& worldMapVersion = 5);
 };
@@ -1,8 +1,11 @@
 #include <BaseApp.h> // precompiled
 #include <World/World.h>
+#include <World/WorldJournal.h>
 
 #include <Client/GameClient.h>
 
+#include <SDK/Proton/MiscUtils.h>
+
 World::World(const std::string& name, const uint8_t& width, const uint8_t& height)
 {
 	nova_delete(m_pWorldTileMap);
@@ -15,8 +18,68 @@ World::World(const std::string& name, const uint8_t& width, const uint8_t& heigh
 
 World::~World()
 {
-	nova_delete(m_pWorldTileMap);
-	nova_delete(m_pWorldObjectMap);
+	for (int i = 0; i < m_mailbox.size(); i++)
+	{
+		enet_packet_destroy(m_mailbox[i].pPacket);
+	}
+
+	for (int i = 0; i < WORLD_MAP_DATA_CLASSES; i++)
+	{
+		ReleaseMapDataCache(m_mapDataCache[i]);
+	}
+
+	// nova_delete takes a void pointer, which wouldn't run the destructors of the maps
+	delete m_pWorldTileMap;
+	delete m_pWorldObjectMap;
+}
+
+void World::SetWorldTileMap(WorldTileMap* pTileMap)
+{
+	if (pTileMap == NULL || pTileMap == m_pWorldTileMap)
+	{
+		return;
+	}
+
+	delete m_pWorldTileMap;
+	m_pWorldTileMap = pTileMap;
+}
+
+bool World::CanBuild(GameClient* pClient, const int& tileX, const int& tileY)
+{
+	if (pClient == NULL || m_pWorldTileMap == NULL)
+	{
+		// client or tile map was null
+		return false;
+	}
+
+	Tile pTile = m_pWorldTileMap->GetTile(tileX, tileY);
+	if (pTile == NULL)
+	{
+		// tile was not found
+		return false;
+	}
+
+	if (pTile->GetParent() != 0 || m_pWorldTileMap->GetLock(pTile->GetIndex()) != NULL)
+	{
+		// area locks decide over their own tiles & themselves
+		return m_pWorldTileMap->CanBuildInAreaLock(pTile->GetIndex(), pClient->GetUserID());
+	}
+
+	if (m_lockIndex == 0 || m_ownerID == -1 || m_ownerID == pClient->GetUserID())
+	{
+		// world isn't locked, or the client owns it
+		return true;
+	}
+
+	Tile pLockTile = m_pWorldTileMap->GetTile(m_lockIndex);
+	if (pLockTile && pLockTile->HasFlag(TILEFLAG_PUBLIC))
+	{
+		// world lock is public
+		return true;
+	}
+
+	TileLock * pLock = m_pWorldTileMap->GetLock(m_lockIndex);
+	return pLock != NULL && std::find(pLock->admins.begin(), pLock->admins.end(), pClient->GetUserID()) != pLock->admins.end();
 }
 
 void World::Broadcast(std::function<void(int, GameClient*)> fCall)
@@ -115,31 +178,52 @@ int World::GetPlayersCount()
 	return count;
 }
 
-size_t World::GetMemoryEstimated(const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion)
+size_t World::GetMemoryUsage()
 {
-	if (m_pWorldTileMap == NULL || m_pWorldObjectMap == NULL)
+	size_t usage = sizeof(World) + m_clients.capacity() * sizeof(GameClient*) + m_tileUpdates.capacity() * sizeof(int);
+	if (m_pWorldTileMap != NULL)
+	{
+		usage += m_pWorldTileMap->GetMemoryUsage();
+	}
+
+	if (m_pWorldObjectMap != NULL)
+	{
+		usage += m_pWorldObjectMap->GetMemoryUsage();
+	}
+
+	for (int i = 0; i < WORLD_MAP_DATA_CLASSES; i++)
 	{
-		// tile or object map is null
-		return 0;
+		const MapDataCache& cache = m_mapDataCache[i];
+		if (cache.pPacket != NULL)
+		{
+			usage += cache.pPacket->dataLength + cache.tiles.offsets.capacity() * sizeof(uint32_t);
+		}
 	}
 
-	size_t estimated = 0;
-	estimated += sizeof(uint16_t); // map version
-	estimated += sizeof(int); // bits
-	estimated += sizeof(uint16_t) + m_name.length();
+	return usage;
+}
 
-	estimated += m_pWorldTileMap->GetMemoryEstimated(bClientSide, fClientVersion, worldMapVersion);
-	if (bClientSide && fClientVersion >= 4.31f)
+uint32_t World::GetRevision()
+{
+	uint32_t revision = m_stateRevision;
+	if (m_pWorldTileMap != NULL)
 	{
-		// some new ubisoft garbage for client side only
-		estimated += sizeof(int);
-		estimated += sizeof(int);
-		estimated += sizeof(int);
+		revision += m_pWorldTileMap->GetRevision();
 	}
 
-	estimated += m_pWorldObjectMap->GetMemoryEstimated();
-	estimated += sizeof(int) * 2; // active & base weather machine ID
-	return estimated;
+	if (m_pWorldObjectMap != NULL)
+	{
+		revision += m_pWorldObjectMap->GetRevision();
+	}
+
+	// every revision only goes up, so the sum changes whenever one of them does
+	return revision;
+}
+
+void World::MarkSaved()
+{
+	m_savedRevision = GetRevision();
+	m_lastSaveTime = std::chrono::steady_clock::now();
 }
 
 void World::ToggleBit(const int& bit, const bool& bSetAsActive)
@@ -148,40 +232,464 @@ void World::ToggleBit(const int& bit, const bool& bSetAsActive)
 	{
 		// removing bit
 		m_bits &= ~bit;
+		m_stateRevision++;
 	}
 
 	if (HasBit(bit) == false && bSetAsActive)
 	{
 		// adding bit
 		m_bits |= bit;
+		m_stateRevision++;
 	}
 }
 
-void World::Serialize(uint8_t * pData, int& memOffset, const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion)
+void World::Serialize(MemoryWriter& writer, const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion, const SerializedTiles* pPreviousTiles, SerializedTiles* pOutTiles)
 {
-    if (pData == NULL || m_pWorldTileMap == NULL || m_pWorldObjectMap == NULL)
+    if (m_pWorldTileMap == NULL || m_pWorldObjectMap == NULL)
 	{
-        // data, tile map or object map is null
+        // tile map or object map is null
 		return;
 	}
 
-	MemorySerializeRaw(m_mapVersion, pData, memOffset, true);
-	MemorySerializeRaw(m_bits, pData, memOffset, true);
-	MemorySerialize(m_name, pData, memOffset, true);
-	m_pWorldTileMap->Serialize(pData, memOffset, bClientSide, fClientVersion, worldMapVersion);
+	writer.Write(m_mapVersion);
+	writer.Write(m_bits);
+	writer.WriteString(m_name);
+	m_pWorldTileMap->Serialize(writer, bClientSide, fClientVersion, worldMapVersion, pPreviousTiles, pOutTiles);
 	
 	if (bClientSide && fClientVersion >= 4.31f)
 	{
 		// some new ubisoft garbage for client side only
 		int zero = 0;
-		MemorySerializeRaw(zero, pData, memOffset, true);
-		MemorySerializeRaw(zero, pData, memOffset, true);
-		MemorySerializeRaw(zero, pData, memOffset, true);
+		writer.Write(zero);
+		writer.Write(zero);
+		writer.Write(zero);
 	}
 
-	m_pWorldObjectMap->Serialize(pData, memOffset, bClientSide);
-	MemorySerializeRaw(m_activeWeather, pData, memOffset, true);
-	MemorySerializeRaw(m_baseWeather, pData, memOffset, true);
+	m_pWorldObjectMap->Serialize(writer, bClientSide);
+	writer.Write(m_activeWeather);
+	writer.Write(m_baseWeather);
+
+	if (bClientSide == false)
+	{
+		// server side infos
+		writer.Write(m_ID);
+		writer.Write(m_ownerID);
+		writer.Write(m_lockIndex);
+		writer.Write(m_category);
+	}
+}
+
+bool World::Load(uint8_t* pData, int& memOffset, const bool& bClientSide)
+{
+	if (pData == NULL || bClientSide || m_pWorldTileMap == NULL || m_pWorldObjectMap == NULL)
+	{
+		// data, tile map or object map is null, or client side data which can't be read back
+		return false;
+	}
+
+	MemorySerializeRaw(m_mapVersion, pData, memOffset, false);
+	MemorySerializeRaw(m_bits, pData, memOffset, false);
+	MemorySerialize(m_name, pData, memOffset, false);
+	if (!m_pWorldTileMap->Load(pData, memOffset, bClientSide, m_mapVersion))
+	{
+		LogError("failed to load tiles of world %s", m_name.c_str());
+		return false;
+	}
+
+	m_pWorldObjectMap->Reset();
+	m_pWorldObjectMap->Load(pData, memOffset);
+	MemorySerializeRaw(m_activeWeather, pData, memOffset, false);
+	MemorySerializeRaw(m_baseWeather, pData, memOffset, false);
+
+	// server side infos
+	MemorySerializeRaw(m_ID, pData, memOffset, false);
+	MemorySerializeRaw(m_ownerID, pData, memOffset, false);
+	MemorySerializeRaw(m_lockIndex, pData, memOffset, false);
+	MemorySerializeRaw(m_category, pData, memOffset, false);
+
+	m_stateRevision++;
+	return true;
+}
+
+ENetPacket* World::GetMapDataPacket(const float& fClientVersion)
+{
+	if (m_pWorldTileMap == NULL || m_pWorldObjectMap == NULL)
+	{
+		// tile map or object map is null
+		return NULL;
+	}
+
+	MapDataCache& cache = m_mapDataCache[fClientVersion >= 4.31f ? 1 : 0];
+	uint32_t itemsHash = GetItemInfoManager()->GetHash();
+	if (cache.pPacket != NULL && cache.mapVersion == m_mapVersion && cache.itemsHash == itemsHash &&
+		cache.tiles.revision == m_pWorldTileMap->GetRevision() && cache.objectsRevision == m_pWorldObjectMap->GetRevision() && cache.stateRevision == m_stateRevision)
+	{
+		// nothing changed since the last join, every client of this protocol class gets the same packet
+		return cache.pPacket;
+	}
+
+	// the world is serialized straight into the enet packet, sized after the last packet of this world so it rarely has to grow
+	MemoryWriter writer(m_mapDataSizeHint, ENET_PACKET_FLAG_RELIABLE);
+
+	eNetMessageType messageType = NET_MESSAGE_GAME_PACKET;
+	writer.Write(messageType);
+
+	size_t headerOffset = writer.Reserve(sizeof(GameUpdatePacket));
+	size_t dataOffset = writer.GetSize();
+
+	// tiles of chunks that didn't change since the cached packet are copied out of it instead of serialized again
+	bool bPatch = cache.pPacket != NULL && cache.mapVersion == m_mapVersion && cache.itemsHash == itemsHash;
+	SerializedTiles tiles;
+	Serialize(writer, true, fClientVersion, m_mapVersion, bPatch ? &cache.tiles : NULL, &tiles);
+
+	uint8_t zero = 0;
+	uint32_t dataLength = (uint32_t)(writer.GetSize() - dataOffset);
+	writer.Write(zero); // same trailing zero as GameClient::SendPacketRaw
+	if (!writer.IsValid())
+	{
+		return NULL;
+	}
+
+	GameUpdatePacket* pMapDataPacket = (GameUpdatePacket*)(writer.GetData() + headerOffset);
+	pMapDataPacket->type = NET_GAME_PACKET_SEND_MAP_DATA;
+	pMapDataPacket->netID = -1;
+	pMapDataPacket->flags |= NET_GAME_PACKET_FLAG_EXTENDED;
+	pMapDataPacket->dataLength = dataLength;
+
+	m_mapDataSizeHint = writer.GetSize();
+	ENetPacket* pPacket = writer.ReleasePacket();
+	if (pPacket == NULL)
+	{
+		return NULL;
+	}
+
+	// the cache keeps its own reference, so the packet outlives the peers it's queued on
+	ReleaseMapDataCache(cache);
+	pPacket->referenceCount++;
+
+	cache.pPacket = pPacket;
+	cache.mapVersion = m_mapVersion;
+	cache.itemsHash = itemsHash;
+	cache.objectsRevision = m_pWorldObjectMap->GetRevision();
+	cache.stateRevision = m_stateRevision;
+	cache.tiles = std::move(tiles);
+	cache.tiles.pData = pPacket->data;
+	return pPacket;
+}
+
+void World::ReleaseMapDataCache(MapDataCache& cache)
+{
+	if (cache.pPacket == NULL)
+	{
+		// nothing cached
+		return;
+	}
+
+	if (--cache.pPacket->referenceCount == 0)
+	{
+		// no peer is holding it anymore
+		enet_packet_destroy(cache.pPacket);
+	}
+
+	cache.pPacket = NULL;
+	cache.tiles = SerializedTiles();
+}
+
+bool World::FlushJournal()
+{
+	if (m_pWorldTileMap == NULL)
+	{
+		// tile map is null
+		return true;
+	}
+
+	bool bAllChanged = false;
+	if (!m_pWorldTileMap->TakeJournalTiles(m_journalTiles, bAllChanged) || m_ID == -1 || !GetWorldJournal()->IsStarted())
+	{
+		// nothing changed, or the world isn't stored
+		return true;
+	}
+
+	if (bAllChanged)
+	{
+		return false;
+	}
+
+	// records hold the whole tile, a tile changed multiple times during the tick is only journaled once
+	std::sort(m_journalTiles.begin(), m_journalTiles.end());
+	m_journalTiles.erase(std::unique(m_journalTiles.begin(), m_journalTiles.end()), m_journalTiles.end());
+
+	MemoryWriter writer(m_journalTiles.size() * 32);
+	for (int i = 0; i < m_journalTiles.size(); i++)
+	{
+		const uint16_t index = (uint16_t)m_journalTiles[i];
+		if (!GetWorldJournal()->WriteRecord(writer, m_journalSeq + 1, index, m_pWorldTileMap->GetTile(index), m_mapVersion))
+		{
+			return false;
+		}
+
+		m_journalSeq++;
+	}
+
+	GetWorldJournal()->Append(m_ID, writer.GetData(), writer.GetSize());
+	return true;
+}
+
+void World::MarkTileDirty(Tile pTile, const bool& bBroadcast)
+{
+	if (m_pWorldTileMap == NULL)
+	{
+		// tile map is null
+		return;
+	}
+
+	m_pWorldTileMap->MarkTileDirty(pTile, bBroadcast);
+	GetWorldsManager()->QueueFlush(this);
+}
+
+void World::FlushTileUpdates()
+{
+	if (m_pWorldTileMap == NULL)
+	{
+		// tile map is null
+		return;
+	}
+
+	bool bAllChanged = false;
+	if (!m_pWorldTileMap->TakeChangedTiles(m_tileUpdates, bAllChanged) || m_clients.empty())
+	{
+		// nothing changed or nobody to tell
+		return;
+	}
+
+	if (bAllChanged)
+	{
+		ResendMapData();
+		return;
+	}
+
+	// a tile changed multiple times during the tick is only sent once
+	std::sort(m_tileUpdates.begin(), m_tileUpdates.end());
+	m_tileUpdates.erase(std::unique(m_tileUpdates.begin(), m_tileUpdates.end()), m_tileUpdates.end());
+
+	// tile data is built once per protocol class & shared by every client of it
+	ENetPacket* pPackets[WORLD_MAP_DATA_CLASSES] = { NULL };
+	bool bResend = false;
+	for (int i = 0; i < m_clients.size() && bResend == false; i++)
+	{
+		if (m_clients[i] == NULL)
+		{
+			// client was null
+			continue;
+		}
+
+		float fClientVersion = m_clients[i]->GetLoginDetails()->gameVersion;
+		ENetPacket*& pPacket = pPackets[fClientVersion >= 4.31f ? 1 : 0];
+		if (pPacket != NULL)
+		{
+			continue;
+		}
+
+		pPacket = CreateTileUpdatePacket(fClientVersion);
+		if (pPacket == NULL)
+		{
+			// too many changes for a tile update, the whole map is cheaper
+			bResend = true;
+			break;
+		}
+
+		// held until every client got it
+		pPacket->referenceCount++;
+	}
+
+	for (int i = 0; i < m_clients.size() && bResend == false; i++)
+	{
+		if (m_clients[i] == NULL)
+		{
+			// client was null
+			continue;
+		}
+
+		m_clients[i]->SendENetPacket(pPackets[m_clients[i]->GetLoginDetails()->gameVersion >= 4.31f ? 1 : 0]);
+	}
+
+	for (int i = 0; i < WORLD_MAP_DATA_CLASSES; i++)
+	{
+		if (pPackets[i] != NULL && --pPackets[i]->referenceCount == 0)
+		{
+			// no peer is holding it
+			enet_packet_destroy(pPackets[i]);
+		}
+	}
+
+	if (bResend)
+	{
+		ResendMapData();
+	}
+}
+
+ENetPacket* World::CreateTileUpdatePacket(const float& fClientVersion)
+{
+	const size_t maxSize = m_mapDataSizeHint / WORLD_TILE_UPDATE_RESEND_DIVISOR;
+	const bool bSingle = m_tileUpdates.size() == 1;
+
+	MemoryWriter writer(bSingle ? 256 : 4096, ENET_PACKET_FLAG_RELIABLE);
+	eNetMessageType messageType = NET_MESSAGE_GAME_PACKET;
+	writer.Write(messageType);
+
+	size_t headerOffset = writer.Reserve(sizeof(GameUpdatePacket));
+	size_t dataOffset = writer.GetSize();
+	for (int i = 0; i < m_tileUpdates.size(); i++)
+	{
+		Tile pTile = m_pWorldTileMap->GetTile((uint16_t)m_tileUpdates[i]);
+		if (pTile == NULL)
+		{
+			// tile is out of bounds
+			continue;
+		}
+
+		if (!bSingle)
+		{
+			// multiple updates are prefixed with the position of each tile
+			int tileX = m_tileUpdates[i] % m_pWorldTileMap->GetWidth();
+			int tileY = m_tileUpdates[i] / m_pWorldTileMap->GetWidth();
+			writer.Write(tileX);
+			writer.Write(tileY);
+		}
+
+		pTile->Serialize(writer, true, fClientVersion, m_mapVersion);
+		if (writer.GetSize() > maxSize)
+		{
+			// ReleasePacket wasn't called, the writer frees the packet
+			return NULL;
+		}
+	}
+
+	uint8_t zero = 0;
+	uint32_t dataLength = (uint32_t)(writer.GetSize() - dataOffset);
+	writer.Write(zero); // same trailing zero as GameClient::SendPacketRaw
+	if (!writer.IsValid())
+	{
+		return NULL;
+	}
+
+	GameUpdatePacket* pTileUpdatePacket = (GameUpdatePacket*)(writer.GetData() + headerOffset);
+	pTileUpdatePacket->netID = -1;
+	pTileUpdatePacket->flags |= NET_GAME_PACKET_FLAG_EXTENDED;
+	pTileUpdatePacket->dataLength = dataLength;
+	if (bSingle)
+	{
+		pTileUpdatePacket->type = NET_GAME_PACKET_SEND_TILE_UPDATE_DATA;
+		pTileUpdatePacket->tileX = m_tileUpdates[0] % m_pWorldTileMap->GetWidth();
+		pTileUpdatePacket->tileY = m_tileUpdates[0] / m_pWorldTileMap->GetWidth();
+	}
+	else
+	{
+		pTileUpdatePacket->type = NET_GAME_PACKET_SEND_TILE_UPDATE_DATA_MULTIPLE;
+		pTileUpdatePacket->tilesLength = (int32_t)m_tileUpdates.size();
+	}
+
+	return writer.ReleasePacket();
+}
+
+WorldObject* World::DropObject(WorldObject object)
+{
+	if (m_pWorldObjectMap == NULL)
+	{
+		// object map is null
+		return NULL;
+	}
+
+	m_objectChanges.clear();
+	WorldObject * pObject = m_pWorldObjectMap->DropObject(object, GetConfig().bCollidateDrops, m_objectChanges);
+	SendObjectChanges(m_objectChanges);
+	return pObject;
+}
+
+void World::ConsolidateObjects()
+{
+	if (m_pWorldObjectMap == NULL || !m_pWorldObjectMap->NeedsConsolidation())
+	{
+		// object map is null or nothing was dropped since the last time
+		return;
+	}
+
+	m_objectChanges.clear();
+	m_pWorldObjectMap->Consolidate(m_objectChanges);
+	SendObjectChanges(m_objectChanges);
+}
+
+void World::SendObjectChanges(const std::vector<WorldObjectChange>& changes)
+{
+	if (m_clients.empty())
+	{
+		// nobody to tell, the objects are in the map data
+		return;
+	}
+
+	for (int i = 0; i < changes.size(); i++)
+	{
+		const WorldObjectChange& change = changes[i];
+		GameUpdatePacket packet;
+		packet.type = NET_GAME_PACKET_ITEM_CHANGE_OBJECT;
+		packet.objectChangeType = change.changeType;
+		if (change.changeType == CHANGETYPE_REMOVE)
+		{
+			packet.objectID = change.object.ID;
+		}
+		else
+		{
+			packet.itemNetID = change.object.ID;
+			packet.itemID = change.object.itemID;
+			packet.objectType = change.object.flags;
+			packet.objectAltCount = (float)change.object.count;
+			packet.vecX = change.object.x;
+			packet.vecY = change.object.y;
+		}
+
+		Broadcast([&](GameClient* pClient) {
+			pClient->SendPacketRaw(NET_MESSAGE_GAME_PACKET, &packet, sizeof(GameUpdatePacket), ENET_PACKET_FLAG_RELIABLE);
+		});
+	}
+}
+
+void World::ResendMapData()
+{
+	for (int i = 0; i < m_clients.size(); i++)
+	{
+		GameClient* pClient = m_clients[i];
+		if (pClient == NULL)
+		{
+			// client was null
+			continue;
+		}
+
+		ENetPacket* pMapDataPacket = GetMapDataPacket(pClient->GetLoginDetails()->gameVersion);
+		if (pMapDataPacket == NULL || !pClient->SendENetPacket(pMapDataPacket))
+		{
+			// packet stays owned by the world cache
+			continue;
+		}
+
+		// map data clears the players on client side, spawning them back
+		VariantSender::OnSpawn(pClient, pClient->GetSpawnData(true));
+		pClient->SendVariantPacket({ "OnSetPos", pClient->GetPosition() }, pClient->GetNetID());
+		pClient->SendChracterState(pClient);
+		pClient->UpdateClothes(pClient);
+		for (int j = 0; j < m_clients.size(); j++)
+		{
+			GameClient* pPlayer = m_clients[j];
+			if (pPlayer == NULL || pPlayer == pClient)
+			{
+				// player was null or is the client itself
+				continue;
+			}
+
+			VariantSender::OnSpawn(pClient, pPlayer->GetSpawnData(), -1, -1);
+			pClient->SendChracterState(pPlayer);
+			pClient->UpdateClothes(pPlayer);
+		}
+	}
 }
 
 void World::AddClient(GameClient * pClient)
@@ -192,6 +700,13 @@ void World::AddClient(GameClient * pClient)
 		return;
 	}
 
+	if (m_clients.empty() && m_pWorldTileMap != NULL)
+	{
+		// nobody was inside to tell about the pending tile changes, the client got them with the map data
+		bool bAllChanged = false;
+		m_pWorldTileMap->TakeChangedTiles(m_tileUpdates, bAllChanged);
+	}
+
 	auto it = std::find(m_clients.begin(), m_clients.end(), pClient);
 	if (it == m_clients.end())
 	{
@@ -230,7 +745,7 @@ void World::HandlePacketTileChangeRequestPunch(GameClient* pClient, GameUpdatePa
 
 	int tileX = pPacket->intX;
 	int tileY = pPacket->intY;
-	Tile *pTile = m_pWorldTileMap->GetTile(tileX, tileY);
+	Tile pTile = m_pWorldTileMap->GetTile(tileX, tileY);
 	if (pTile == NULL)
 	{
 	    // tile was not found
@@ -257,11 +772,19 @@ void World::HandlePacketTileChangeRequestPunch(GameClient* pClient, GameUpdatePa
 		return;
 	}
 
-	if (nova_clock::now() - pTile->DamageTick >= std::chrono::seconds(pItemInfo->regenTime))
+	if (!CanBuild(pClient, tileX, tileY))
+	{
+		// locked by someone else
+		VariantSender::OnTalkBubble(pClient, pClient->GetNetID(), "That area is owned by someone else.", 0, true);
+		pClient->SendPacket(NET_MESSAGE_GAME_MESSAGE, "action|play_sfx\nfile|audio/punch_locked.wav\ndelayMS|0");
+		return;
+	}
+
+	if (nova_clock::now() - pTile->GetDamageTick() >= std::chrono::seconds(pItemInfo->regenTime))
 	{
 		// reset the tile's damage
 		pTile->SetDamage(0);
-		pTile->DamageTick = nova_clock::now();
+		pTile->SetDamageTick(nova_clock::now());
 	}
 
 	if (pItemInfo->editableTypes & MOD)
@@ -287,6 +810,7 @@ void World::HandlePacketTileChangeRequestPunch(GameClient* pClient, GameUpdatePa
 			}
 
 			pTile->ToggleFlag(TILEFLAG_ENABLED, !pTile->HasFlag(TILEFLAG_ENABLED));
+			MarkTileDirty(pTile);
 			switch (pItemInfo->ID)
 			{
 				case ITEM_ID_SIGNAL_JAMMER:
@@ -356,7 +880,7 @@ void World::HandlePacketTileChangeRequestPunch(GameClient* pClient, GameUpdatePa
 	pPacket->tileDamage = pClient->GetHitPower();
 
 	pTile->SetDamage(pTile->GetDamage() + pClient->GetHitPower());
-	pTile->DamageTick = nova_clock::now();
+	pTile->SetDamageTick(nova_clock::now());
 
 
 	// checking if tile was broken or not
@@ -396,6 +920,12 @@ void World::HandlePacketTileChangeRequestPunch(GameClient* pClient, GameUpdatePa
 
 				break;
 		    }
+
+		    case TYPE_LOCK:
+		    {
+			    ReleaseLock(pTile);
+			    break;
+		    }
 		}
 
 		// handle goodie
@@ -420,7 +950,8 @@ void World::HandlePacketTileChangeRequestPunch(GameClient* pClient, GameUpdatePa
 				obj.y = spawnY;
 				obj.count = 1;
 
-				//TODO: other buffs & add
+				//TODO: other buffs
+				DropObject(obj);
 			}
 
 			if (bSeed)
@@ -431,7 +962,8 @@ void World::HandlePacketTileChangeRequestPunch(GameClient* pClient, GameUpdatePa
 				obj.y = spawnY;
 				obj.count = 1;
 
-				//TODO: other buffs & add
+				//TODO: other buffs
+				DropObject(obj);
 			}
 
 			if (gems > 0) 
@@ -466,6 +998,9 @@ void World::HandlePacketTileChangeRequestPunch(GameClient* pClient, GameUpdatePa
 		{
 			pTile->SetForeground(ITEM_ID_BLANK);
 		}
+
+		// clients break the tile themselves from the echoed request below
+		MarkTileDirty(pTile, false);
 	}
 
 	Broadcast([&](GameClient* pPlayer) {
@@ -487,11 +1022,84 @@ void World::HandlePacketTileChangeRequestPlace(GameClient* pClient, GameUpdatePa
 		return;
 	}
 
+	if (!CanBuild(pClient, pPacket->intX, pPacket->intY))
+	{
+		// locked by someone else
+		VariantSender::OnTalkBubble(pClient, pClient->GetNetID(), "That area is owned by someone else.", 0, true);
+		pClient->SendPacket(NET_MESSAGE_GAME_MESSAGE, "action|play_sfx\nfile|audio/cant_place_tile.wav\ndelayMS|0");
+		return;
+	}
+
+	if (pItemInfo->type == TYPE_LOCK && !PlaceLock(pClient, m_pWorldTileMap->GetTile((int)pPacket->intX, (int)pPacket->intY), pItemInfo))
+	{
+		// tile is taken, or the world has a world lock already
+		pClient->SendPacket(NET_MESSAGE_GAME_MESSAGE, "action|play_sfx\nfile|audio/cant_place_tile.wav\ndelayMS|0");
+		return;
+	}
+
 	Broadcast([&](GameClient* pPlayer) {
 		pPlayer->SendPacketRaw(NET_MESSAGE_GAME_PACKET, pPacket, sizeof(GameUpdatePacket) + pPacket->dataLength, ENET_PACKET_FLAG_RELIABLE);
 	});
 }
 
+bool World::PlaceLock(GameClient* pClient, Tile pTile, ItemInfo* pItemInfo)
+{
+	if (pTile == NULL || pTile->GetForeground() != ITEM_ID_BLANK || pTile->GetParent() != 0)
+	{
+		// tile is taken or locked already
+		return false;
+	}
+
+	const bool bWorldLock = pItemInfo->lockPower == 0;
+	if (bWorldLock && m_lockIndex != 0)
+	{
+		// one world lock per world
+		return false;
+	}
+
+	pTile->SetForeground(pItemInfo->ID);
+	TileExtraLock * pLock = static_cast<TileExtraLock*>(pTile->GetTileExtra());
+	if (pTile->GetForeground() != pItemInfo->ID || pLock == NULL || pLock->GetExtraType() != TILE_EXTRA_TYPE_LOCK)
+	{
+		// lock wasn't placed
+		pTile->SetForeground(ITEM_ID_BLANK);
+		return false;
+	}
+
+	pLock->OwnerID = pClient->GetUserID();
+	pLock->Flags = bWorldLock ? LOCK_FLAG_NONE : LOCK_FLAG_AREA_LOCK;
+	m_pWorldTileMap->SetLockAccess(pTile->GetIndex(), pLock->OwnerID, pLock->Admins);
+	if (bWorldLock)
+	{
+		m_lockIndex = pTile->GetIndex();
+		m_ownerID = pLock->OwnerID;
+		m_stateRevision++;
+	}
+	else
+	{
+		m_pWorldTileMap->AddTilesThisWouldLock(pTile, pItemInfo->lockPower, false);
+	}
+
+	// clients place the lock themselves from the echoed request, the tiles it took are sent with the next flush
+	MarkTileDirty(pTile, false);
+	return true;
+}
+
+void World::ReleaseLock(Tile pTile)
+{
+	m_pWorldTileMap->RemoveAllTilesFromThisLock(pTile);
+	m_pWorldTileMap->SetLockAccess(pTile->GetIndex(), -1, {});
+	if (pTile->GetIndex() == m_lockIndex)
+	{
+		m_lockIndex = 0;
+		m_ownerID = -1;
+		m_stateRevision++;
+	}
+
+	// the tiles it let go of are sent with the next flush
+	GetWorldsManager()->QueueFlush(this);
+}
+
 void World::HandlePacketTileChangeRequestConsume(GameClient* pClient, GameUpdatePacket* pPacket, ItemInfo* pItemInfo)
 {
 	if (pClient == NULL || pPacket == NULL || pItemInfo == NULL)
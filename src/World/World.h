@@ -1,11 +1,18 @@
 #ifndef WORLD_H
 #define WORLD_H
+#include <atomic>
 #include <string>
 #include <vector>
+#include <chrono>
 #include <functional>
 
+#include <enet/enet.h>
+
 #include <World/WorldTileMap.h>
 #include <World/WorldObjectMap.h>
+#include <World/WorldScheduler.h>
+
+#include <SDK/Proton/MemoryWriter.h>
 
 enum eWorldCategories : uint8_t
 {
@@ -53,6 +60,19 @@ enum eWorldCategories : uint8_t
 #define WORLD_DEFAULT_WIDTH 100
 #define WORLD_DEFAULT_HEIGHT 60
 #define WORLD_MAX_NPCS 255 // how many npcs a world can have inside
+#define WORLD_MAP_DATA_CLASSES 2 // map data layouts we send, clients below 4.31 and from 4.31 on
+#define WORLD_TILE_UPDATE_RESEND_DIVISOR 2 // tile updates bigger than 1/n of the map data are replaced by a full map data resend
+
+// last map data packet sent for one protocol class, and what it was built from
+struct MapDataCache
+{
+	ENetPacket                        *pPacket = NULL; // shared by every join, the cache holds one reference
+	uint16_t                          mapVersion = 0;
+	uint32_t                          itemsHash = 0; // items.dat the packet was built against
+	uint32_t                          objectsRevision = 0;
+	uint32_t                          stateRevision = 0;
+	SerializedTiles                   tiles; // tile offsets inside pPacket, used to patch only the dirty chunks
+};
 
 // fowarded definitions
 class GameClient;
@@ -84,30 +104,51 @@ public:
 	uint8_t                           GetCategory() const { return m_category; }
 	std::string                       GetCategoryAsString();
 	int                               GetPlayersCount();
+	size_t                            GetMemoryUsage(); // estimated bytes held by the world, including its cached packets
+	std::chrono::steady_clock::time_point GetIdleSince() const { return m_idleSince; }
+	std::chrono::steady_clock::time_point GetLastSaveTime() const { return m_lastSaveTime; }
+	uint32_t                          GetRevision(); // changes whenever anything that is saved changes
+	bool                              IsDirty() { return GetRevision() != m_savedRevision; }
+	uint32_t                          GetJournalSeq() const { return m_journalSeq; }
+	bool                              CanBuild(GameClient* pClient, const int& tileX, const int& tileY); // whether the locks of the world let the client build or break there
 
 
 	WorldTileMap                      *GetWorldTileMap() { return m_pWorldTileMap; }
 	WorldObjectMap                    *GetWorldObjectMap() { return m_pWorldObjectMap; }
 	std::vector<GameClient*>          GetClients() { return m_clients; }
-
-	size_t                            GetMemoryEstimated(const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5);
+	std::vector<WorldMessage>         &GetMailbox() { return m_mailbox; } // packets waiting for the world scheduler
 
 
 	// set
+	void                              SetID(const int& ID) { m_ID = ID; }
 	void                              SetNetID(const int& netID) { m_netID = netID; }
-	void                              SetName(const std::string& name) { m_name = name; }
-	int                               SetBits(const int& bits) { m_bits = bits; }
+	void                              SetName(const std::string& name) { m_name = name; m_stateRevision++; }
+	void                              SetBits(const int& bits) { m_bits = bits; m_stateRevision++; }
 	void                              ToggleBit(const int& bit, const bool& bSetAsActive = false);
-	void                              SetBaseWeather(const int& weather) { m_baseWeather = weather; }
-	void                              SetWeather(const int& weather) { m_activeWeather = weather; }
+	void                              SetBaseWeather(const int& weather) { m_baseWeather = weather; m_stateRevision++; }
+	void                              SetWeather(const int& weather) { m_activeWeather = weather; m_stateRevision++; }
 	void                              SetWorldOwnerID(const int& userID) { m_ownerID = userID; }
 	void                              SetWorldLockIndex(const int& index) { m_lockIndex = index; }
 	void                              SetCategory(const uint8_t& category) { m_category = category; }
+	void                              SetIdleSince(const std::chrono::steady_clock::time_point& time) { m_idleSince = time; }
+	void                              MarkSaved(); // the world as it is now got saved or loaded
+	void                              SetJournalSeq(const uint32_t& seq) { m_journalSeq = seq; }
+	void                              SetWorldTileMap(WorldTileMap* pTileMap); // takes over the tile map, the previous one is deleted
+	bool                              SetFlushQueued(const bool& bQueued) { return m_bFlushQueued.exchange(bQueued); } // returns whether it was queued before
 
 
 	// fn
-	void                              Serialize(uint8_t * pData, int& memOffset, const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5);
-    //void                              Load(uint8_t * pData, int& memOffset, const bool& bClientSide = true, const uint16_t& worldMapVersion = 5);
+	void                              Serialize(MemoryWriter& writer, const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5, const SerializedTiles* pPreviousTiles = NULL, SerializedTiles* pOutTiles = NULL);
+	ENetPacket                        *GetMapDataPacket(const float& fClientVersion); // NET_GAME_PACKET_SEND_MAP_DATA, cached per protocol class & owned by the world(don't destroy it), NULL on failure
+	void                              MarkTileDirty(Tile pTile, const bool& bBroadcast = true); // marks the tile in the tile map & queues the world for the next flush
+	void                              FlushTileUpdates(); // sends the tiles changed since the last flush to the clients inside, called once per server tick
+	void                              ResendMapData(); // sends the whole map again to every client inside & respawns the players
+	bool                              FlushJournal(); // hands the tiles changed since the last flush to the world journal, false when the world needs a checkpoint instead
+	bool                              Load(uint8_t * pData, int& memOffset, const bool& bClientSide = false); // server side data only, false if it can't be read
+
+	WorldObject                       *DropObject(WorldObject object); // merged into the nearby stacks with consolidate_drops, NULL if nothing was left of it
+	void                              ConsolidateObjects(); // merges the nearby stacks of the whole world & tells the clients inside
+	void                              SendObjectChanges(const std::vector<WorldObjectChange>& changes);
 
 
 	void                              AddClient(GameClient * pClient);
@@ -129,6 +170,24 @@ private:
 	WorldTileMap                      *m_pWorldTileMap = NULL; // world tile map
 	WorldObjectMap                    *m_pWorldObjectMap = NULL; // world object map
 	std::vector<GameClient*>          m_clients{};
+	size_t                            m_mapDataSizeHint = 64 * 1024; // size of the last map data packet, initial capacity for the next one
+	MapDataCache                      m_mapDataCache[WORLD_MAP_DATA_CLASSES];
+	uint32_t                          m_stateRevision = 0; // bumped when the name, bits or weather change
+	std::chrono::steady_clock::time_point m_idleSince; // when the last player left
+	std::chrono::steady_clock::time_point m_lastSaveTime;
+	uint32_t                          m_savedRevision = 0; // GetRevision() when the world was last saved
+	uint32_t                          m_journalSeq = 0; // sequence number of the last tile change handed to the world journal
+
+	std::vector<int>                  m_tileUpdates; // reused between flushes
+	std::vector<int>                  m_journalTiles; // reused between journal flushes
+	std::vector<WorldObjectChange>    m_objectChanges; // reused between drops
+	std::vector<WorldMessage>         m_mailbox;
+	std::atomic<bool>                 m_bFlushQueued = false; // waits in the flush list of the worlds manager
+
+	void                              ReleaseMapDataCache(MapDataCache& cache);
+	bool                              PlaceLock(GameClient* pClient, Tile pTile, ItemInfo* pItemInfo); // false if the lock can't go there
+	void                              ReleaseLock(Tile pTile); // before the lock tile is cleared
+	ENetPacket                        *CreateTileUpdatePacket(const float& fClientVersion); // from m_tileUpdates, NULL when it's too big or failed
 
 	int                               m_activeWeather = 4; // active weather machine ID in the world
 	int                               m_baseWeather = 4; // weather machine ID that it resets to after deactivating the active one
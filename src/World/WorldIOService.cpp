@@ -0,0 +1,320 @@
+#include <BaseApp.h> // precompiled
+#include <World/WorldIOService.h>
+
+#include <World/World.h>
+#include <World/WorldStore.h>
+#include <World/WorldJournal.h>
+#include <Items/ItemInfoPublisher.h>
+
+WorldIOService g_worldIOService;
+WorldIOService* GetWorldIOService() { return &g_worldIOService; }
+
+WorldIOService::~WorldIOService()
+{
+	Stop();
+}
+
+bool WorldIOService::HasPendingSaves()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return !m_pendingSaves.empty();
+}
+
+void WorldIOService::Start(const int& threads)
+{
+	if (!m_threads.empty())
+	{
+		// already running
+		return;
+	}
+
+	m_bStopping = false;
+	for (int i = 0; i < threads; i++)
+	{
+		m_threads.emplace_back(&WorldIOService::WorkerThread, this);
+	}
+}
+
+void WorldIOService::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+
+	// workers drain the queue before leaving, so no save is lost
+	m_jobAdded.notify_all();
+	for (int i = 0; i < m_threads.size(); i++)
+	{
+		if (m_threads[i].joinable())
+		{
+			m_threads[i].join();
+		}
+	}
+
+	m_threads.clear();
+	for (int i = 0; i < m_finishedLoads.size(); i++)
+	{
+		delete m_finishedLoads[i].pWorld;
+	}
+
+	m_finishedLoads.clear();
+}
+
+void WorldIOService::QueueLoad(const std::string& name, const int& worldID)
+{
+	WorldIOJob job;
+	job.name = name;
+	job.worldID = worldID;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(job);
+	}
+
+	m_jobAdded.notify_one();
+}
+
+bool WorldIOService::QueueSave(World* pWorld)
+{
+	if (pWorld == NULL || pWorld->GetID() == -1)
+	{
+		// world is null or was never registered in the world store
+		return false;
+	}
+
+	std::shared_ptr<std::vector<uint8_t>> pRaw = std::make_shared<std::vector<uint8_t>>();
+	if (!GetWorldStore()->SerializeWorld(pWorld, *pRaw))
+	{
+		return false;
+	}
+
+	pWorld->MarkSaved();
+
+	bool bNotify = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		PendingWorldSave& save = m_pendingSaves[pWorld->GetID()];
+		save.pRaw = pRaw;
+		save.journalSeq = pWorld->GetJournalSeq();
+		if (!save.bQueued && !save.bWriting)
+		{
+			// otherwise the queued job or the worker writing it picks the newer data up
+			WorldIOJob job;
+			job.bSave = true;
+			job.name = pWorld->GetName();
+			job.worldID = pWorld->GetID();
+			m_jobs.push_back(job);
+
+			save.bQueued = true;
+			bNotify = true;
+		}
+	}
+
+	if (bNotify)
+	{
+		m_jobAdded.notify_one();
+	}
+
+	return true;
+}
+
+void WorldIOService::PollLoads(std::vector<WorldLoad>& loads)
+{
+	loads.clear();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	loads.swap(m_finishedLoads);
+}
+
+void WorldIOService::WorkerThread()
+{
+	while (true)
+	{
+		WorldIOJob job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (true)
+			{
+				// failed saves go back to the queue once their time came, or right away when stopping
+				const nova_clock::time_point now = nova_clock::now();
+				nova_clock::time_point nextRetry = nova_clock::time_point::max();
+				for (int i = 0; i < m_retries.size();)
+				{
+					if (m_bStopping || m_retries[i].retryTime <= now)
+					{
+						m_jobs.push_back(m_retries[i]);
+						m_retries.erase(m_retries.begin() + i);
+						continue;
+					}
+
+					nextRetry = std::min(nextRetry, m_retries[i].retryTime);
+					i++;
+				}
+
+				if (!m_jobs.empty())
+				{
+					break;
+				}
+
+				if (m_bStopping)
+				{
+					// stopping & nothing left to do
+					return;
+				}
+
+				if (nextRetry == nova_clock::time_point::max())
+				{
+					m_jobAdded.wait(lock);
+				}
+				else
+				{
+					m_jobAdded.wait_until(lock, nextRetry);
+				}
+			}
+
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+
+		// tiles look up their items while they're read & written, off the event loop that needs a pin
+		ItemInfoPin pin;
+		if (job.bSave)
+		{
+			Save(job);
+		}
+		else
+		{
+			Load(job);
+		}
+	}
+}
+
+void WorldIOService::Load(const WorldIOJob& job)
+{
+	WorldLoad load;
+	load.name = job.name;
+	load.worldID = job.worldID;
+
+	std::shared_ptr<std::vector<uint8_t>> pRaw;
+	uint32_t journalSeq = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_pendingSaves.find(job.worldID);
+		if (it != m_pendingSaves.end())
+		{
+			pRaw = it->second.pRaw;
+			journalSeq = it->second.journalSeq;
+		}
+	}
+
+	if (pRaw != NULL)
+	{
+		// the file is outdated until the pending save is written
+		load.pWorld = GetWorldStore()->LoadRaw(pRaw->data(), pRaw->size(), "pending save of " + job.name);
+		if (load.pWorld != NULL)
+		{
+			load.pWorld->SetJournalSeq(journalSeq);
+		}
+	}
+	else if (GetWorldStore()->HasWorldFile(job.worldID))
+	{
+		load.pWorld = GetWorldStore()->Load(job.worldID);
+	}
+	else
+	{
+		load.result = WORLD_LOAD_NOT_FOUND;
+	}
+
+	if (load.pWorld != NULL)
+	{
+		// the changes made after the world was saved
+		if (!GetWorldJournal()->Replay(load.pWorld))
+		{
+			LogError("world %s was loaded without some of its journaled changes", job.name.c_str());
+		}
+
+		load.result = WORLD_LOAD_OK;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_finishedLoads.push_back(load);
+}
+
+void WorldIOService::Save(const WorldIOJob& job)
+{
+	std::shared_ptr<std::vector<uint8_t>> pRaw;
+	uint32_t journalSeq = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		PendingWorldSave& save = m_pendingSaves[job.worldID];
+		save.bQueued = false;
+		save.bWriting = true;
+		pRaw = save.pRaw;
+		journalSeq = save.journalSeq;
+	}
+
+	std::vector<uint8_t> data;
+	const bool bWritten = GetWorldStore()->Compress(*pRaw, job.worldID, journalSeq, data) && GetWorldStore()->WriteWorldFile(job.worldID, data);
+	if (bWritten)
+	{
+		// the journal only needs the changes made since
+		GetWorldJournal()->Checkpoint(job.worldID, journalSeq);
+		m_savesWritten++;
+	}
+	else
+	{
+		m_saveFailures++;
+	}
+
+	bool bNotify = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		PendingWorldSave& save = m_pendingSaves[job.worldID];
+		save.bWriting = false;
+		if (bWritten && save.pRaw == pRaw)
+		{
+			// nothing newer came in while writing, the file is up to date
+			m_pendingSaves.erase(job.worldID);
+		}
+		else if (!bWritten)
+		{
+			// the save stays pending so loads still get it, written again once the disk had some time
+			save.failures++;
+			if (save.bQueued)
+			{
+				// a newer save is queued already & goes in its place
+				LogError("failed to save world %s(%d failures in a row)", job.name.c_str(), save.failures);
+				return;
+			}
+
+			if (m_bStopping && save.failures > 1)
+			{
+				LogError("failed to save world %s again while stopping, its changes are only in the world journal", job.name.c_str());
+				return;
+			}
+
+			const int delayMS = std::min(WORLD_IO_RETRY_MS << std::min(save.failures - 1, 16), WORLD_IO_MAX_RETRY_MS);
+			LogError("failed to save world %s(%d failures in a row), retrying in %d ms", job.name.c_str(), save.failures, delayMS);
+
+			WorldIOJob retry = job;
+			retry.retryTime = nova_clock::now() + std::chrono::milliseconds(delayMS);
+			m_retries.push_back(retry);
+			save.bQueued = true;
+			bNotify = true;
+		}
+		else if (bWritten && !save.bQueued)
+		{
+			// saved again while this one was written
+			save.failures = 0;
+			m_jobs.push_back(job);
+			save.bQueued = true;
+			bNotify = true;
+		}
+	}
+
+	if (bNotify)
+	{
+		m_jobAdded.notify_one();
+	}
+}
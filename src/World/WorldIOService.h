@@ -0,0 +1,106 @@
+#ifndef WORLDIOSERVICE_H
+#define WORLDIOSERVICE_H
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+#include <condition_variable>
+
+#define WORLD_IO_THREADS 2 // world I/O workers, loads & saves are mostly disk and zlib bound
+#define WORLD_IO_RETRY_MS 1000 // a failed save is retried after this long, doubled on every failure in a row
+#define WORLD_IO_MAX_RETRY_MS 60000
+
+// fowarded definitions
+class World;
+
+enum eWorldLoadResult
+{
+	WORLD_LOAD_OK,
+	WORLD_LOAD_NOT_FOUND, // registered, but never saved
+	WORLD_LOAD_FAILED // the world file exists but couldn't be read
+};
+
+struct WorldLoad
+{
+	std::string name;
+	int worldID = -1;
+	eWorldLoadResult result = WORLD_LOAD_FAILED;
+	World* pWorld = NULL; // set when result is WORLD_LOAD_OK, owned by whoever polls it
+};
+
+struct PendingWorldSave
+{
+	std::shared_ptr<std::vector<uint8_t>> pRaw; // newest serialization not on disk yet
+	uint32_t journalSeq = 0; // last world journal record pRaw contains
+	bool bQueued = false; // a save job for the world waits in the queue
+	bool bWriting = false; // a worker is writing the world right now
+	int failures = 0; // failed writes in a row, the save is kept & retried until one goes through
+};
+
+struct WorldIOJob
+{
+	bool bSave = false;
+	std::string name;
+	int worldID = -1;
+	std::chrono::steady_clock::time_point retryTime; // failed saves wait in the retry list until then
+};
+
+/*
+* Loads & saves worlds on a small worker pool, so the event loop never waits on the disk.
+*
+* Loads are read, decompressed & deserialized by a worker, the finished worlds are picked up with PollLoads() from the event loop.
+* Saves are write-behind: the world is serialized on the event loop(it's only a memcpy sized pass), compressing & writing is left
+* to a worker. A world saved again before its previous save was written only keeps the newest serialization, and a load of a world
+* with a save in flight is served from that serialization instead of the outdated file.
+*
+* Written saves checkpoint the world journal, and loads replay it on top of the world file. A save that fails to be written stays
+* pending(loads keep being served from it) & is retried with a growing delay, its changes are also still in the world journal.
+*/
+class WorldIOService
+{
+public:
+	WorldIOService() = default;
+	~WorldIOService();
+
+
+	// get
+	bool                         HasPendingSaves();
+	int                          GetSavesWritten() const { return m_savesWritten; } // world files written since the start
+	int                          GetSaveFailures() const { return m_saveFailures; } // failed writes since the start
+
+
+	// fn
+	void                         Start(const int& threads = WORLD_IO_THREADS);
+	void                         Stop(); // writes the pending saves & joins the workers
+
+	void                         QueueLoad(const std::string& name, const int& worldID);
+	bool                         QueueSave(World* pWorld); // event loop only, false if it couldn't be serialized
+	void                         PollLoads(std::vector<WorldLoad>& loads); // event loop only, hands over the finished loads
+
+private:
+	void                         WorkerThread();
+	void                         Load(const WorldIOJob& job);
+	void                         Save(const WorldIOJob& job);
+
+	std::vector<std::thread>     m_threads;
+	std::mutex                   m_mutex;
+	std::condition_variable      m_jobAdded;
+	std::deque<WorldIOJob>       m_jobs;
+	std::vector<WorldIOJob>      m_retries; // failed saves waiting for their retry time
+	bool                         m_bStopping = false;
+	std::atomic<int>             m_savesWritten = 0;
+	std::atomic<int>             m_saveFailures = 0;
+
+	std::unordered_map<int, PendingWorldSave> m_pendingSaves; // world ID to its save that isn't on disk yet
+	std::vector<WorldLoad>       m_finishedLoads;
+
+};
+
+WorldIOService*                  GetWorldIOService();
+
+#endif WORLDIOSERVICE_H
@@ -0,0 +1,456 @@
+#include <BaseApp.h> // precompiled
+#include <World/WorldJournal.h>
+
+#include <cstdio>
+#include <functional>
+#include <zlib.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <World/World.h>
+#include <World/WorldStore.h>
+
+#include <SDK/Proton/MiscUtils.h>
+#include <SDK/Proton/MemoryWriter.h>
+#include <SDK/Proton/FileSystem/MappedFile.h>
+
+WorldJournal g_worldJournal;
+WorldJournal* GetWorldJournal() { return &g_worldJournal; }
+
+static const int WORLD_JOURNAL_HEADER_SIZE = sizeof(uint32_t) /* magic */ + sizeof(uint16_t) /* version */ + sizeof(int) /* world ID */;
+static const int WORLD_JOURNAL_RECORD_HEADER_SIZE = sizeof(uint32_t) /* seq */ + sizeof(uint16_t) /* tile index */ + sizeof(uint16_t) /* size */ + sizeof(uint32_t) /* crc32 */;
+
+static void WriteJournalHeader(std::vector<uint8_t>& data, const int& worldID)
+{
+	uint32_t magic = WORLD_JOURNAL_MAGIC;
+	uint16_t version = WORLD_JOURNAL_VERSION;
+	int fileWorldID = worldID;
+
+	data.resize(WORLD_JOURNAL_HEADER_SIZE);
+	int offset = 0;
+	MemorySerializeRaw(magic, data.data(), offset, true);
+	MemorySerializeRaw(version, data.data(), offset, true);
+	MemorySerializeRaw(fileWorldID, data.data(), offset, true);
+}
+
+static bool IsJournalHeaderValid(const uint8_t* pData, const size_t& size, const int& worldID)
+{
+	if (pData == NULL || size < WORLD_JOURNAL_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	uint32_t magic = 0;
+	uint16_t version = 0;
+	int fileWorldID = 0;
+
+	int offset = 0;
+	MemorySerializeRaw(magic, (uint8_t*)pData, offset, false);
+	MemorySerializeRaw(version, (uint8_t*)pData, offset, false);
+	MemorySerializeRaw(fileWorldID, (uint8_t*)pData, offset, false);
+	return magic == WORLD_JOURNAL_MAGIC && version == WORLD_JOURNAL_VERSION && fileWorldID == worldID;
+}
+
+// walks the records, stops at the first torn or corrupted one(a crash mid-write) & returns how many bytes were valid
+static size_t ScanRecords(const uint8_t* pData, const size_t& size, std::function<void(const uint32_t&, const uint16_t&, uint8_t*, const size_t&)> fCall)
+{
+	size_t offset = 0;
+	while (size - offset >= WORLD_JOURNAL_RECORD_HEADER_SIZE)
+	{
+		uint32_t seq = 0;
+		uint16_t index = 0;
+		uint16_t payloadSize = 0;
+		uint32_t checksum = 0;
+
+		int memOffset = (int)offset;
+		MemorySerializeRaw(seq, (uint8_t*)pData, memOffset, false);
+		MemorySerializeRaw(index, (uint8_t*)pData, memOffset, false);
+		MemorySerializeRaw(payloadSize, (uint8_t*)pData, memOffset, false);
+		MemorySerializeRaw(checksum, (uint8_t*)pData, memOffset, false);
+		if (size - memOffset < payloadSize || crc32(0L, pData + memOffset, payloadSize) != checksum)
+		{
+			break;
+		}
+
+		fCall(seq, index, (uint8_t*)pData + offset, WORLD_JOURNAL_RECORD_HEADER_SIZE + payloadSize);
+		offset = memOffset + payloadSize;
+	}
+
+	return offset;
+}
+
+static bool SyncFile(FILE* pFile)
+{
+	if (fflush(pFile) != 0)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	return _commit(_fileno(pFile)) == 0;
+#else
+	return fsync(fileno(pFile)) == 0;
+#endif
+}
+
+WorldJournal::~WorldJournal()
+{
+	Stop();
+}
+
+size_t WorldJournal::GetSize(const int& worldID)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_journals.find(worldID);
+	if (it == m_journals.end())
+	{
+		return 0;
+	}
+
+	return it->second.fileSize + it->second.records.size();
+}
+
+void WorldJournal::Start()
+{
+	if (IsStarted())
+	{
+		// already running
+		return;
+	}
+
+	m_bStopping = false;
+	m_thread = std::thread(&WorldJournal::WriterThread, this);
+}
+
+void WorldJournal::Stop()
+{
+	if (!IsStarted())
+	{
+		return;
+	}
+
+	{
+		// records of a failed commit wait in the queue too, the writer takes one more look at every journal
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+		m_bPending = true;
+	}
+
+	m_recordsAdded.notify_all();
+	m_thread.join();
+}
+
+bool WorldJournal::WriteRecord(MemoryWriter& writer, const uint32_t& seq, const uint16_t& index, Tile pTile, const uint16_t& worldMapVersion)
+{
+	if (pTile == NULL)
+	{
+		// tile is null
+		return false;
+	}
+
+	writer.Write(seq);
+	writer.Write(index);
+	size_t headerOffset = writer.Reserve(sizeof(uint16_t) + sizeof(uint32_t));
+	size_t payloadOffset = writer.GetSize();
+	pTile->Serialize(writer, false, 0.f, worldMapVersion);
+
+	size_t payloadSize = writer.GetSize() - payloadOffset;
+	if (!writer.IsValid() || payloadSize > UINT16_MAX)
+	{
+		// only a checkpoint can save this one
+		return false;
+	}
+
+	uint16_t payloadSize16 = (uint16_t)payloadSize;
+	uint32_t checksum = crc32(0L, writer.GetData() + payloadOffset, payloadSize16);
+	int offset = (int)headerOffset;
+	MemorySerializeRaw(payloadSize16, writer.GetData(), offset, true);
+	MemorySerializeRaw(checksum, writer.GetData(), offset, true);
+	return true;
+}
+
+void WorldJournal::Append(const int& worldID, const uint8_t* pData, const size_t& size)
+{
+	if (!IsStarted() || pData == NULL || size == 0)
+	{
+		// journal isn't running or nothing to append
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<uint8_t>& records = m_journals[worldID].records;
+		records.insert(records.end(), pData, pData + size);
+		m_bPending = true;
+	}
+
+	m_recordsAdded.notify_one();
+}
+
+void WorldJournal::Checkpoint(const int& worldID, const uint32_t& seq)
+{
+	if (!IsStarted())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		WorldJournalQueue& journal = m_journals[worldID];
+		journal.checkpointSeq = std::max(journal.checkpointSeq, seq);
+		journal.bCheckpoint = true;
+		m_bPending = true;
+	}
+
+	m_recordsAdded.notify_one();
+}
+
+bool WorldJournal::Replay(World* pWorld)
+{
+	if (pWorld == NULL || pWorld->GetWorldTileMap() == NULL)
+	{
+		// world or tile map is null
+		return false;
+	}
+
+	const std::string fName = GetWorldStore()->GetWorldFilePath(pWorld->GetID(), WORLD_JOURNAL_EXTENSION);
+	MappedFile f;
+	if (fName.empty() || !f.Open(fName))
+	{
+		// no journal, the world file is up to date
+		return true;
+	}
+
+	if (!IsJournalHeaderValid(f.GetAsBytes(), f.GetSize(), pWorld->GetID()))
+	{
+		LogError("%s isn't a journal of world %d", fName.c_str(), pWorld->GetID());
+		return false;
+	}
+
+	WorldTileMap* pTileMap = pWorld->GetWorldTileMap();
+	const uint32_t fromSeq = pWorld->GetJournalSeq();
+	uint32_t lastSeq = fromSeq;
+	int replayed = 0;
+	bool bFailed = false;
+	ScanRecords(f.GetAsBytes() + WORLD_JOURNAL_HEADER_SIZE, f.GetSize() - WORLD_JOURNAL_HEADER_SIZE, [&](const uint32_t& seq, const uint16_t& index, uint8_t* pRecord, const size_t& recordSize)
+	{
+		if (seq <= fromSeq || bFailed)
+		{
+			// already in the world file
+			return;
+		}
+
+		Tile pTile = pTileMap->GetTile(index);
+		int memOffset = WORLD_JOURNAL_RECORD_HEADER_SIZE;
+		if (pTile == NULL || !pTile->Load(pRecord, memOffset, false, pWorld->GetMapVersion()) || memOffset != (int)recordSize)
+		{
+			LogError("failed to replay change %u of tile %d from %s", seq, index, fName.c_str());
+			bFailed = true;
+			return;
+		}
+
+		pTileMap->MarkTileDirty(pTile, false);
+		lastSeq = std::max(lastSeq, seq);
+		replayed++;
+	});
+
+	pWorld->SetJournalSeq(lastSeq);
+	if (replayed > 0)
+	{
+		LogMsg("replayed %d tile changes of world %s", replayed, pWorld->GetName().c_str());
+	}
+
+	return !bFailed;
+}
+
+void WorldJournal::WriterThread()
+{
+	struct JournalBatch
+	{
+		int worldID;
+		std::vector<uint8_t> records;
+		bool bRewrite;
+		bool bCheckpoint;
+		uint32_t minSeq;
+		size_t fileSize;
+	};
+
+	std::vector<JournalBatch> batches;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_recordsAdded.wait(lock, [this]() { return m_bStopping || m_bPending; });
+			if (!m_bPending)
+			{
+				// stopping & everything is committed
+				return;
+			}
+
+			if (!m_bStopping)
+			{
+				// the group commit window, whatever the event loop appends in it goes into the same write & fsync
+				m_recordsAdded.wait_for(lock, std::chrono::milliseconds(WORLD_JOURNAL_COMMIT_INTERVAL_MS), [this]() { return m_bStopping; });
+			}
+
+			m_bPending = false;
+			for (auto it = m_journals.begin(); it != m_journals.end(); ++it)
+			{
+				WorldJournalQueue& journal = it->second;
+				if (journal.records.empty() && !journal.bCheckpoint)
+				{
+					continue;
+				}
+
+				JournalBatch batch;
+				batch.worldID = it->first;
+				batch.records.swap(journal.records);
+				batch.bRewrite = journal.bCheckpoint || !journal.bChecked; // a file of the last run may end in a torn record
+				batch.bCheckpoint = journal.bCheckpoint;
+				batch.minSeq = journal.bCheckpoint ? journal.checkpointSeq : 0;
+				batch.fileSize = journal.fileSize;
+				batches.push_back(std::move(batch));
+
+				journal.bCheckpoint = false;
+				journal.bChecked = true;
+			}
+		}
+
+		for (int i = 0; i < batches.size(); i++)
+		{
+			JournalBatch& batch = batches[i];
+			const bool bCommitted = Commit(batch.worldID, batch.records, batch.bRewrite, batch.minSeq, batch.fileSize);
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!bCommitted)
+			{
+				m_commitFailures++;
+				if (m_bStopping)
+				{
+					// the next checkpoint saves them, if the world is saved before the server goes down
+					LogError("failed to commit %d bytes to the journal of world %d while stopping", (int)batch.records.size(), batch.worldID);
+					continue;
+				}
+
+				// a failed append may have left part of the records behind, the journal is rewritten without them by the next commit,
+				// which also takes these records again
+				WorldJournalQueue& journal = m_journals[batch.worldID];
+				journal.records.insert(journal.records.begin(), batch.records.begin(), batch.records.end());
+				journal.bChecked = false;
+				if (batch.bCheckpoint)
+				{
+					journal.checkpointSeq = std::max(journal.checkpointSeq, batch.minSeq);
+					journal.bCheckpoint = true;
+				}
+
+				LogError("failed to commit %d bytes to the journal of world %d, they're committed with its next changes", (int)batch.records.size(), batch.worldID);
+				continue;
+			}
+
+			auto it = m_journals.find(batch.worldID);
+			if (it == m_journals.end())
+			{
+				continue;
+			}
+
+			it->second.fileSize = batch.fileSize;
+			if (batch.fileSize == 0 && it->second.records.empty() && !it->second.bCheckpoint)
+			{
+				// journal is gone until the world changes again
+				m_journals.erase(it);
+			}
+		}
+
+		batches.clear();
+	}
+}
+
+bool WorldJournal::Commit(const int& worldID, const std::vector<uint8_t>& records, const bool& bRewrite, const uint32_t& minSeq, size_t& fileSize)
+{
+	const std::string fName = GetWorldStore()->GetWorldFilePath(worldID, WORLD_JOURNAL_EXTENSION);
+	if (fName.empty())
+	{
+		// store is disabled or the world was never registered
+		return false;
+	}
+
+	if (!bRewrite)
+	{
+		// the whole group is appended with one write & one fsync
+		std::vector<uint8_t> header;
+		if (fileSize == 0)
+		{
+			WriteJournalHeader(header, worldID);
+		}
+
+		FILE* pFile = fopen(fName.c_str(), "ab");
+		if (pFile == NULL)
+		{
+			LogError("failed to open %s", fName.c_str());
+			return false;
+		}
+
+		bool bWritten = fwrite(header.data(), 1, header.size(), pFile) == header.size() && fwrite(records.data(), 1, records.size(), pFile) == records.size() && SyncFile(pFile);
+		fclose(pFile);
+		if (!bWritten)
+		{
+			return false;
+		}
+
+		const bool bNewFile = fileSize == 0;
+		fileSize += header.size() + records.size();
+
+		// a new journal, its directory entry has to survive a crash too
+		return !bNewFile || GetWorldStore()->SyncDirectory(fName);
+	}
+
+	// rewriting the journal with only the valid records the world file doesn't contain yet
+	std::vector<uint8_t> data;
+	WriteJournalHeader(data, worldID);
+
+	// records of a failed append can be both in the file & queued again, sequence numbers only grow so the copies are skipped
+	uint32_t lastSeq = minSeq;
+	auto fKeep = [&](const uint32_t& seq, const uint16_t& index, uint8_t* pRecord, const size_t& recordSize)
+	{
+		if (seq > lastSeq)
+		{
+			data.insert(data.end(), pRecord, pRecord + recordSize);
+			lastSeq = seq;
+		}
+	};
+
+	MappedFile f;
+	if (f.Open(fName))
+	{
+		if (IsJournalHeaderValid(f.GetAsBytes(), f.GetSize(), worldID))
+		{
+			ScanRecords(f.GetAsBytes() + WORLD_JOURNAL_HEADER_SIZE, f.GetSize() - WORLD_JOURNAL_HEADER_SIZE, fKeep);
+		}
+		else
+		{
+			LogError("%s isn't a journal of world %d, dropping it", fName.c_str(), worldID);
+		}
+
+		f.Close();
+	}
+
+	ScanRecords(records.data(), records.size(), fKeep);
+	if (data.size() == WORLD_JOURNAL_HEADER_SIZE)
+	{
+		// the world file contains everything
+		std::remove(fName.c_str());
+		fileSize = 0;
+		return true;
+	}
+
+	// replaced the same way as world files
+	if (!GetWorldStore()->ReplaceFile(fName, data.data(), data.size()))
+	{
+		return false;
+	}
+
+	fileSize = data.size();
+	return true;
+}
@@ -0,0 +1,81 @@
+#ifndef WORLDJOURNAL_H
+#define WORLDJOURNAL_H
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <condition_variable>
+
+#define WORLD_JOURNAL_EXTENSION ".journal"
+#define WORLD_JOURNAL_MAGIC 0x4C4E4A57 // WJNL
+#define WORLD_JOURNAL_VERSION 1 // bump whenever the record layout or the server side tile serialization changes
+#define WORLD_JOURNAL_COMMIT_INTERVAL_MS 50 // group commit window, the records of a world queued in it share one write & fsync
+#define WORLD_JOURNAL_CHECKPOINT_BYTES (1024 * 1024) // journals above this get checkpointed into the world file
+
+// fowarded definitions
+class World;
+class Tile;
+class MemoryWriter;
+
+struct WorldJournalQueue
+{
+	std::vector<uint8_t> records; // appended by the event loop, not committed yet
+	size_t fileSize = 0; // bytes of the journal file, as of the last commit
+	uint32_t checkpointSeq = 0; // records up to this one are in the world file & can be dropped
+	bool bCheckpoint = false;
+	bool bChecked = false; // the file was read back once, a torn tail of a crash is cut off before appending to it
+};
+
+/*
+* Write-ahead journal of the tile changes of every stored world, so changes are durable without writing the whole world.
+*
+* Each world has an append-only <worldID>.journal next to its world file, holding one record per changed tile: a sequence
+* number, the tile index, the size & crc32 of the server side tile serialization and the serialization itself. Records of a
+* tick are queued by the event loop & written by the journal writer in groups, one write & fsync per world every
+* WORLD_JOURNAL_COMMIT_INTERVAL_MS.
+*
+* The world file carries the last sequence number it contains. After a world file is written the journal is checkpointed,
+* dropping the records the file covers, and loading a world replays the records past it on top of the world file.
+*/
+class WorldJournal
+{
+public:
+	WorldJournal() = default;
+	~WorldJournal();
+
+
+	// get
+	bool                         IsStarted() const { return m_thread.joinable(); }
+	size_t                       GetSize(const int& worldID); // committed & queued bytes of the journal of a world
+	int                          GetCommitFailures() const { return m_commitFailures; } // failed commits since the start, their records are committed with the next ones
+
+
+	// fn
+	void                         Start(); // only when the world store is loaded
+	void                         Stop(); // commits the queued records & joins the writer
+
+	bool                         WriteRecord(MemoryWriter& writer, const uint32_t& seq, const uint16_t& index, Tile pTile, const uint16_t& worldMapVersion); // false if the tile can't be journaled
+	void                         Append(const int& worldID, const uint8_t* pData, const size_t& size); // records written by WriteRecord
+	void                         Checkpoint(const int& worldID, const uint32_t& seq); // the world file got written & contains every record up to seq
+	bool                         Replay(World* pWorld); // applies the records past pWorld->GetJournalSeq(), false if any of them couldn't be applied
+
+private:
+	void                         WriterThread();
+	bool                         Commit(const int& worldID, const std::vector<uint8_t>& records, const bool& bRewrite, const uint32_t& minSeq, size_t& fileSize);
+
+	std::thread                  m_thread;
+	std::mutex                   m_mutex;
+	std::condition_variable      m_recordsAdded;
+	bool                         m_bStopping = false;
+	bool                         m_bPending = false; // records or checkpoints wait for the writer
+	std::atomic<int>             m_commitFailures = 0;
+
+	std::unordered_map<int, WorldJournalQueue> m_journals; // world ID to its journal
+
+};
+
+WorldJournal*                    GetWorldJournal();
+
+#endif WORLDJOURNAL_H
@@ -3,34 +3,16 @@
 #include <World/WorldObject.h>
 
 #include <SDK/Proton/MiscUtils.h>
+#include <SDK/Proton/MemoryWriter.h>
 
-size_t WorldObject::GetMemoryEstimated() 
+void WorldObject::Serialize(MemoryWriter& writer)
 {
-	size_t estimated = 0;
-
-	estimated += sizeof(uint16_t); // item ID
-	estimated += sizeof(float); // x 
-    estimated += sizeof(float); // y
-	estimated += sizeof(uint8_t); // item count
-	estimated += sizeof(uint8_t); // object flags
-	estimated += sizeof(int); // world object offset ID
-	return estimated;
-}
-
-void WorldObject::Serialize(uint8_t * pData, int& memOffset)
-{
-	if (pData == NULL)
-	{
-        // data is null
-		return;
-	}
-
-	MemorySerializeRaw(itemID, pData, memOffset, true);
-	MemorySerializeRaw(x, pData, memOffset, true);
-	MemorySerializeRaw(y, pData, memOffset, true);
-	MemorySerializeRaw(count, pData, memOffset, true);
-	MemorySerializeRaw(flags, pData, memOffset, true);
-	MemorySerializeRaw(ID, pData, memOffset, true);
+	writer.Write(itemID);
+	writer.Write(x);
+	writer.Write(y);
+	writer.Write(count);
+	writer.Write(flags);
+	writer.Write(ID);
 }
 
 void WorldObject::Load(uint8_t * pData, int& memOffset)
@@ -3,6 +3,8 @@
 #define WORLDOBJECT_H
 #include <cstdint>
 
+class MemoryWriter;
+
 enum eObjectChangeTypes
 {
 	CHANGETYPE_EDIT = -3, // modify / edit the object, it's itemID, flags or count
@@ -29,12 +31,8 @@ public:
 	~WorldObject() = default;
 
 
-    // get
-	size_t            GetMemoryEstimated();
-
-
     // fn
-	void              Serialize(uint8_t * pData, int& memOffset);
+	void              Serialize(MemoryWriter& writer);
 	void              Load(uint8_t * pMem, int& memOffset);
 
 public:
@@ -2,51 +2,124 @@
 
 #include <World/WorldObjectMap.h>
 
+#include <cmath>
+
+#include <Items/ItemInfoManager.h>
+
 #include <SDK/Proton/MiscUtils.h>
+#include <SDK/Proton/MemoryWriter.h>
 
 WorldObjectMap::~WorldObjectMap()
 {
     m_objectID = 0;
-    m_objects.clear();
+    m_slots.clear();
+    m_objectSlots.clear();
+    m_cells.clear();
 }
 
 WorldObject * WorldObjectMap::GetObjectByID(const int& objectID)
 {
-    for (int i = 0; i < m_objects.size(); i++)
-	{
-		WorldObject * pObject = &m_objects[i];
-		if (pObject == NULL || pObject->ID != objectID)
-		{
-            // object is null or object ID missmatch
-			continue;
-		}
+    auto it = m_objectSlots.find(objectID);
+    if (it == m_objectSlots.end())
+    {
+        // no object found
+        return NULL;
+    }
 
-		return pObject;
-	}
+    return &m_slots[it->second].object;
+}
 
-    // no object found
-	return NULL;
+size_t WorldObjectMap::GetMemoryUsage() const
+{
+    // hash table entries cost a node with two pointers on top of the value
+    size_t usage = sizeof(WorldObjectMap) + m_slots.capacity() * sizeof(WorldObjectSlot);
+    usage += m_objectSlots.size() * (sizeof(std::pair<const int, int>) + sizeof(void*) * 2);
+    for (auto& cell : m_cells)
+    {
+        usage += sizeof(std::pair<const uint32_t, std::vector<int>>) + sizeof(void*) * 2 + cell.second.capacity() * sizeof(int);
+    }
+
+    return usage;
 }
 
-size_t WorldObjectMap::GetMemoryEstimated()
+void WorldObjectMap::GetObjectsInRect(const CL_Rectf& rect, std::vector<WorldObject*>& objects)
 {
-    size_t estimated = 0;
-    estimated += sizeof(int); // objects size
-    estimated += sizeof(int); // last object ID
+    const int fromX = (int)std::floor(rect.X / WORLD_OBJECT_CELL_SIZE);
+    const int fromY = (int)std::floor(rect.Y / WORLD_OBJECT_CELL_SIZE);
+    const int toX = (int)std::floor((rect.X + rect.W) / WORLD_OBJECT_CELL_SIZE);
+    const int toY = (int)std::floor((rect.Y + rect.H) / WORLD_OBJECT_CELL_SIZE);
 
-	for (int i = 0; i < m_objects.size(); i++)
-	{
-		WorldObject * pObject = &m_objects[i];
-		if (pObject == NULL)
-		{
-            // object is null
-			continue;
-		}
+    auto addInRect = [&](const std::vector<int>& slots)
+    {
+        for (int i = 0; i < slots.size(); i++)
+        {
+            WorldObject& object = m_slots[slots[i]].object;
+            if (object.x >= rect.X && object.x <= rect.X + rect.W && object.y >= rect.Y && object.y <= rect.Y + rect.H)
+            {
+                objects.push_back(&object);
+            }
+        }
+    };
 
-		estimated += pObject->GetMemoryEstimated();
-	}
+    if ((int64_t)(toX - fromX + 1) * (toY - fromY + 1) > (int64_t)m_cells.size())
+    {
+        // the rect covers more cells than have objects, cheaper to go through the ones that do
+        for (auto& cell : m_cells)
+        {
+            addInRect(cell.second);
+        }
+
+        return;
+    }
+
+    for (int cellY = fromY; cellY <= toY; cellY++)
+    {
+        for (int cellX = fromX; cellX <= toX; cellX++)
+        {
+            auto it = m_cells.find(GetCellKey((float)cellX * WORLD_OBJECT_CELL_SIZE, (float)cellY * WORLD_OBJECT_CELL_SIZE));
+            if (it != m_cells.end())
+            {
+                addInRect(it->second);
+            }
+        }
+    }
+}
+
+void WorldObjectMap::GetObjectsInRadius(const CL_Vec2f& pos, const float& radius, std::vector<WorldObject*>& objects)
+{
+    // the bounding square first, then the corners are cut off
+    const size_t first = objects.size();
+    GetObjectsInRect(CL_Rectf(pos.X - radius, pos.Y - radius, radius * 2.f, radius * 2.f), objects);
+    objects.erase(std::remove_if(objects.begin() + first, objects.end(), [&](WorldObject* pObject)
+    {
+        const float dx = pObject->x - pos.X;
+        const float dy = pObject->y - pos.Y;
+        return dx * dx + dy * dy > radius * radius;
+    }), objects.end());
+}
 
-	return estimated;
+bool WorldObjectMap::SetObjectPos(const int& objectID, const CL_Vec2f& pos)
+{
+    auto it = m_objectSlots.find(objectID);
+    if (it == m_objectSlots.end())
+    {
+        // no object found
+        return false;
+    }
+
+    WorldObject& object = m_slots[it->second].object;
+    const uint32_t oldCellKey = GetCellKey(object.x, object.y);
+    const uint32_t newCellKey = GetCellKey(pos.X, pos.Y);
+    if (oldCellKey != newCellKey)
+    {
+        RemoveFromCell(oldCellKey, it->second);
+        AddToCell(newCellKey, it->second);
+    }
+
+    object.x = pos.X;
+    object.y = pos.Y;
+    m_revision++;
+    return true;
 }
 
 void WorldObjectMap::Reset()
@@ -55,32 +128,261 @@ void WorldObjectMap::Reset()
     // @note: keep in mind, that if you use this func in a world with people inside, you'd need to handle visual removal of the objects yourself
 
     m_objectID = 0;
-    m_objects.clear();
+    m_slots.clear();
+    m_firstFree = -1;
+    m_objectSlots.clear();
+    m_cells.clear();
+    m_revision++;
 }
 
-void WorldObjectMap::Serialize(uint8_t * pData, int& memOffset, const bool& bClientSide)
+WorldObject * WorldObjectMap::AddObject(WorldObject& object)
 {
-    if (pData == NULL)
+    object.ID = GetObjectID(true);
+    return InsertObject(object);
+}
+
+bool WorldObjectMap::RemoveObjectByID(const int& ID)
+{
+    auto it = m_objectSlots.find(ID);
+    if (it == m_objectSlots.end())
+    {
+        // no object found
+        return false;
+    }
+
+    const int slot = it->second;
+    WorldObjectSlot& objectSlot = m_slots[slot];
+    RemoveFromCell(GetCellKey(objectSlot.object.x, objectSlot.object.y), slot);
+    m_objectSlots.erase(it);
+
+    objectSlot.object = WorldObject();
+    objectSlot.bUsed = false;
+    objectSlot.nextFree = m_firstFree;
+    m_firstFree = slot;
+    m_revision++;
+    return true;
+}
+
+WorldObject * WorldObjectMap::InsertObject(const WorldObject& object)
+{
+    if (m_objectSlots.find(object.ID) != m_objectSlots.end())
+    {
+        // there's an object with this ID already
+        return NULL;
+    }
+
+    int slot = m_firstFree;
+    if (slot != -1)
+    {
+        // reusing a free slot
+        m_firstFree = m_slots[slot].nextFree;
+    }
+    else
+    {
+        slot = (int)m_slots.size();
+        m_slots.emplace_back();
+    }
+
+    WorldObjectSlot& objectSlot = m_slots[slot];
+    objectSlot.object = object;
+    objectSlot.bUsed = true;
+    objectSlot.nextFree = -1;
+    m_objectSlots[object.ID] = slot;
+    AddToCell(GetCellKey(object.x, object.y), slot);
+    m_revision++;
+    return &objectSlot.object;
+}
+
+// how many of the item a dropped stack can hold
+static int GetMaxStackCount(const short& itemID)
+{
+    ItemInfo * pItemInfo = GetItemInfoManager()->GetItemByID((uint16_t)itemID);
+    return pItemInfo != NULL && pItemInfo->maxCount > 0 ? pItemInfo->maxCount : 200;
+}
+
+int WorldObjectMap::PourIntoNearbyStacks(WorldObject& object, const int& maxCount, std::vector<int>& changedIDs)
+{
+    m_nearbyObjects.clear();
+    GetObjectsInRadius(CL_Vec2f(object.x, object.y), WORLD_OBJECT_CONSOLIDATE_RADIUS, m_nearbyObjects);
+
+    int count = object.count;
+    for (int i = 0; i < m_nearbyObjects.size() && count > 0; i++)
+    {
+        WorldObject * pStack = m_nearbyObjects[i];
+        if (pStack->ID == object.ID || pStack->itemID != object.itemID || pStack->flags != object.flags || pStack->count >= maxCount)
+        {
+            // not the same kind of stack or no room left
+            continue;
+        }
+
+        const int poured = std::min(count, maxCount - (int)pStack->count);
+        pStack->count += (uint8_t)poured;
+        count -= poured;
+        changedIDs.push_back(pStack->ID);
+    }
+
+    if (count != object.count)
+    {
+        m_revision++;
+    }
+
+    return count;
+}
+
+WorldObject * WorldObjectMap::DropObject(WorldObject& object, const bool& bConsolidate, std::vector<WorldObjectChange>& changes)
+{
+    if (bConsolidate)
+    {
+        // object isn't in the map yet, its ID can't match any of the stacks
+        std::vector<int> changedIDs;
+        object.ID = -1;
+        object.count = (uint8_t)PourIntoNearbyStacks(object, GetMaxStackCount(object.itemID), changedIDs);
+        for (int i = 0; i < changedIDs.size(); i++)
+        {
+            changes.push_back({ CHANGETYPE_EDIT, *GetObjectByID(changedIDs[i]) });
+        }
+
+        if (object.count == 0)
+        {
+            // everything fit into the stacks
+            return NULL;
+        }
+    }
+
+    WorldObject * pObject = AddObject(object);
+    if (pObject != NULL)
+    {
+        changes.push_back({ CHANGETYPE_SPAWN, *pObject });
+    }
+
+    return pObject;
+}
+
+void WorldObjectMap::Consolidate(std::vector<WorldObjectChange>& changes)
+{
+    // every object takes what fits from the stacks around it, the emptied ones are removed. An object can change many
+    // times during the pass, clients are only told how it ended up
+    std::vector<int> changedIDs;
+    std::vector<int> removedIDs;
+    for (int i = 0; i < m_slots.size(); i++)
+    {
+        if (!m_slots[i].bUsed)
+        {
+            continue;
+        }
+
+        WorldObject& object = m_slots[i].object;
+        const int maxCount = GetMaxStackCount(object.itemID);
+        if (object.count >= maxCount)
+        {
+            // full already
+            continue;
+        }
+
+        m_nearbyObjects.clear();
+        GetObjectsInRadius(CL_Vec2f(object.x, object.y), WORLD_OBJECT_CONSOLIDATE_RADIUS, m_nearbyObjects);
+        for (int j = 0; j < m_nearbyObjects.size() && object.count < maxCount; j++)
+        {
+            WorldObject * pStack = m_nearbyObjects[j];
+            if (pStack == &object || pStack->itemID != object.itemID || pStack->flags != object.flags)
+            {
+                // not the same kind of stack
+                continue;
+            }
+
+            const int taken = std::min((int)pStack->count, maxCount - (int)object.count);
+            object.count += (uint8_t)taken;
+            pStack->count -= (uint8_t)taken;
+            changedIDs.push_back(object.ID);
+            if (pStack->count == 0)
+            {
+                // only the slot is freed, the pointers of the other nearby objects stay valid
+                removedIDs.push_back(pStack->ID);
+                RemoveObjectByID(pStack->ID);
+            }
+            else
+            {
+                changedIDs.push_back(pStack->ID);
+            }
+        }
+    }
+
+    std::sort(changedIDs.begin(), changedIDs.end());
+    changedIDs.erase(std::unique(changedIDs.begin(), changedIDs.end()), changedIDs.end());
+    for (int i = 0; i < changedIDs.size(); i++)
+    {
+        WorldObject * pObject = GetObjectByID(changedIDs[i]);
+        if (pObject != NULL)
+        {
+            // objects that were removed later on only get the removal
+            changes.push_back({ CHANGETYPE_EDIT, *pObject });
+        }
+    }
+
+    for (int i = 0; i < removedIDs.size(); i++)
+    {
+        WorldObjectChange change;
+        change.changeType = CHANGETYPE_REMOVE;
+        change.object.ID = removedIDs[i];
+        changes.push_back(change);
+    }
+
+    if (!changedIDs.empty())
+    {
+        m_revision++;
+    }
+
+    m_consolidatedRevision = m_revision;
+}
+
+uint32_t WorldObjectMap::GetCellKey(const float& x, const float& y) const
+{
+    const int cellX = (int)std::floor(x / WORLD_OBJECT_CELL_SIZE);
+    const int cellY = (int)std::floor(y / WORLD_OBJECT_CELL_SIZE);
+    return (uint32_t)(uint16_t)cellX << 16 | (uint16_t)cellY;
+}
+
+void WorldObjectMap::AddToCell(const uint32_t& cellKey, const int& slot)
+{
+    m_cells[cellKey].push_back(slot);
+}
+
+void WorldObjectMap::RemoveFromCell(const uint32_t& cellKey, const int& slot)
+{
+    auto it = m_cells.find(cellKey);
+    if (it == m_cells.end())
     {
-        // data is null
         return;
     }
 
-    int objects_size = (int)m_objects.size(); // size of the objects
+    std::vector<int>& slots = it->second;
+    auto slotIt = std::find(slots.begin(), slots.end(), slot);
+    if (slotIt != slots.end())
+    {
+        // order within a cell doesn't matter
+        *slotIt = slots.back();
+        slots.pop_back();
+    }
+
+    if (slots.empty())
+    {
+        m_cells.erase(it);
+    }
+}
+
+void WorldObjectMap::Serialize(MemoryWriter& writer, const bool& bClientSide)
+{
+    int objects_size = (int)m_objectSlots.size(); // size of the objects
 	int object_offset = bClientSide ? m_objectID - 1 /* last object id */: m_objectID /* current object id */;
-	MemorySerializeRaw(objects_size, pData, memOffset, true);
-	MemorySerializeRaw(object_offset, pData, memOffset, true);
+	writer.Write(objects_size);
+	writer.Write(object_offset);
 	
-    for (int i = 0; i < m_objects.size(); i++)
+    for (int i = 0; i < m_slots.size(); i++)
 	{
-		WorldObject * pObject = &m_objects[i];
-		if (pObject == NULL)
+		if (m_slots[i].bUsed)
 		{
-            // object is null
-			continue;
+			m_slots[i].object.Serialize(writer);
 		}
-
-		pObject->Serialize(pData, memOffset);
 	}
 }
 
@@ -101,6 +403,8 @@ void WorldObjectMap::Load(uint8_t * pData, int& memOffset)
 	{
 		WorldObject obj;
 		obj.Load(pData, memOffset);
-        m_objects.push_back(obj);
+        InsertObject(obj);
 	}
-}
\ No newline at end of file
+
+    m_revision++;
+}
@@ -2,12 +2,36 @@
 #define WORLDOBJECTMAP_H
 #include <string>
 #include <vector>
+#include <unordered_map>
 
 #include <World/WorldObject.h>
 
 #include <SDK/Proton/Math.h>
 
+#define WORLD_OBJECT_CELL_SIZE 32 // objects are bucketed in cells of WORLD_OBJECT_CELL_SIZE x WORLD_OBJECT_CELL_SIZE pixels, one tile
+#define WORLD_OBJECT_CONSOLIDATE_RADIUS 16.f // with consolidate_drops, stacks of the same item closer than this many pixels are merged
 
+// where an object lives, free slots chain to the next free one
+struct WorldObjectSlot
+{
+	WorldObject                       object;
+	bool                              bUsed = false;
+	int                               nextFree = -1;
+};
+
+// an object change clients have to be told about
+struct WorldObjectChange
+{
+	int                               changeType = CHANGETYPE_EDIT; // CHANGETYPE_SPAWN, CHANGETYPE_EDIT or CHANGETYPE_REMOVE
+	WorldObject                       object; // as it is after the change, only the ID is set for removals
+};
+
+/*
+* Dropped objects are kept in slots that never move, so pointers & slot indexes stay valid until the object is removed, and
+* removed slots are reused through a free list. Object IDs are handed out in order(clients count them too), an ID to slot
+* table finds an object by its ID. Every object is also bucketed by the cell its position is in, so the rect & radius
+* queries only look at the objects of the cells they overlap.
+*/
 class WorldObjectMap 
 {
 public:
@@ -18,25 +42,49 @@ public:
     // get
 	int                               GetObjectID(const bool& bIncrease = false) { return bIncrease ? m_objectID++ : m_objectID; }
 	WorldObject                       *GetObjectByID(const int& objectID);
-	std::vector<WorldObject>          GetObjects() { return m_objects; }
-	size_t                            GetMemoryEstimated();
+	int                               GetObjectCount() const { return (int)m_objectSlots.size(); }
+	uint32_t                          GetRevision() const { return m_revision; } // bumped whenever the objects change
+	bool                              NeedsConsolidation() const { return m_consolidatedRevision != m_revision; } // objects changed since the last Consolidate()
+	size_t                            GetMemoryUsage() const;
+
+	// the objects whose position is inside the rect or circle, added to objects
+	void                              GetObjectsInRect(const CL_Rectf& rect, std::vector<WorldObject*>& objects);
+	void                              GetObjectsInRadius(const CL_Vec2f& pos, const float& radius, std::vector<WorldObject*>& objects);
 
     // set
     void                              SetObjectID(const int& objectID) { m_objectID = objectID; }
+	bool                              SetObjectPos(const int& objectID, const CL_Vec2f& pos); // objects may only be moved through this, false if there's no such object
 
     // fn
 	void                              Reset();
 
-	void                              AddObject(WorldObject& object);
-	void                              RemoveObjectByID(const int& ID);
+	WorldObject                       *AddObject(WorldObject& object); // gives the object the next ID, returns where it's stored
+	bool                              RemoveObjectByID(const int& ID); // false if there's no such object
 
-	void                              Serialize(uint8_t * pData, int& memOffset, const bool& bClientSide = true);
+	// drops go through here, with bConsolidate the count is poured into the nearby stacks of the same item first & only what
+	// doesn't fit is added, NULL if nothing was left. changes gets what clients have to be told
+	WorldObject                       *DropObject(WorldObject& object, const bool& bConsolidate, std::vector<WorldObjectChange>& changes);
+	void                              Consolidate(std::vector<WorldObjectChange>& changes); // merges the nearby stacks of every object, for worlds that got many drops
+
+	void                              Serialize(MemoryWriter& writer, const bool& bClientSide = true);
 	void                              Load(uint8_t * pData, int& memOffset);
 
 private:
+	WorldObject                       *InsertObject(const WorldObject& object); // keeps the ID of the object
+	uint32_t                          GetCellKey(const float& x, const float& y) const;
+	void                              AddToCell(const uint32_t& cellKey, const int& slot);
+	void                              RemoveFromCell(const uint32_t& cellKey, const int& slot);
+	int                               PourIntoNearbyStacks(WorldObject& object, const int& maxCount, std::vector<int>& changedIDs); // returns the count that didn't fit
+
 	int                               m_objectID = 0;
-	std::vector<WorldObject>          m_objects;
+	std::vector<WorldObjectSlot>      m_slots;
+	int                               m_firstFree = -1; // first free slot, -1 when every slot is used
+	std::unordered_map<int, int>      m_objectSlots; // object ID to its slot
+	std::unordered_map<uint32_t, std::vector<int>> m_cells; // cell key to the slots of the objects in it
+	uint32_t                          m_revision = 0;
+	uint32_t                          m_consolidatedRevision = 0; // m_revision after the last Consolidate()
+	std::vector<WorldObject*>         m_nearbyObjects; // reused by the consolidation
 
 };
 
-#endif WORLDOBJECTMAP_H
\ No newline at end of file
+#endif WORLDOBJECTMAP_H
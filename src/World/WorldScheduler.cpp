@@ -0,0 +1,261 @@
+#include <BaseApp.h> // precompiled
+#include <World/WorldScheduler.h>
+
+#include <Client/GameClient.h>
+#include <Server/PacketHandler.h>
+#include <World/World.h>
+
+WorldScheduler g_worldScheduler;
+WorldScheduler* GetWorldScheduler() { return &g_worldScheduler; }
+
+// outbox slot of the current thread while it runs worlds in parallel, -1 everywhere else
+static thread_local int t_worldSlot = -1;
+
+WorldScheduler::~WorldScheduler()
+{
+	Stop();
+}
+
+bool WorldScheduler::IsWorldThread() const
+{
+	return t_worldSlot != -1;
+}
+
+void WorldScheduler::Start(int threads)
+{
+	if (!m_threads.empty())
+	{
+		// already running
+		return;
+	}
+
+	if (threads <= 0)
+	{
+		// the event loop runs worlds too, so it counts as one of the cores
+		threads = std::max(0, (int)std::thread::hardware_concurrency() - 1);
+	}
+
+	m_bStopping = false;
+	m_queues.clear();
+	m_outboxes.assign(threads + 1, std::vector<WorldOutgoingPacket>());
+	for (int i = 0; i <= threads; i++)
+	{
+		m_queues.emplace_back(std::make_unique<WorldRunQueue>());
+	}
+
+	for (int i = 1; i <= threads; i++)
+	{
+		m_threads.emplace_back(&WorldScheduler::WorkerThread, this, i);
+	}
+
+	LogMsg("running worlds on %d threads", threads + 1);
+}
+
+void WorldScheduler::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+
+	m_runStarted.notify_all();
+	for (int i = 0; i < m_threads.size(); i++)
+	{
+		if (m_threads[i].joinable())
+		{
+			m_threads[i].join();
+		}
+	}
+
+	m_threads.clear();
+}
+
+void WorldScheduler::Post(World* pWorld, GameClient* pClient, ENetPacket* pPacket)
+{
+	if (pWorld == NULL || pClient == NULL || pPacket == NULL)
+	{
+		// world, client or packet is null
+		return;
+	}
+
+	std::vector<WorldMessage>& mailbox = pWorld->GetMailbox();
+	if (mailbox.empty())
+	{
+		m_readyWorlds.push_back(pWorld);
+	}
+
+	mailbox.push_back({ pClient, pPacket });
+	m_pendingMessages++;
+}
+
+void WorldScheduler::Run()
+{
+	if (m_readyWorlds.empty())
+	{
+		// nothing queued
+		return;
+	}
+
+	m_pendingMessages = 0;
+	if (m_threads.empty() || m_readyWorlds.size() == 1)
+	{
+		// nothing to run in parallel, no need to wake the world threads
+		for (int i = 0; i < m_readyWorlds.size(); i++)
+		{
+			RunWorld(m_readyWorlds[i]);
+		}
+
+		m_readyWorlds.clear();
+		return;
+	}
+
+	// dealing the worlds out round robin, threads that run out of worlds steal from the others
+	m_remaining = (int)m_readyWorlds.size();
+	for (int i = 0; i < m_readyWorlds.size(); i++)
+	{
+		WorldRunQueue& queue = *m_queues[i % m_queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.worlds.push_back(m_readyWorlds[i]);
+	}
+
+	m_readyWorlds.clear();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_run++;
+	}
+
+	m_runStarted.notify_all();
+
+	// the event loop takes its share instead of only waiting
+	t_worldSlot = 0;
+	RunQueues(0);
+	t_worldSlot = -1;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_runFinished.wait(lock, [this]() { return m_remaining == 0; });
+	}
+
+	FlushOutboxes();
+}
+
+void WorldScheduler::QueueSend(ENetPeer* pPeer, ENetPacket* pPacket)
+{
+	if (pPeer == NULL || pPacket == NULL || t_worldSlot == -1)
+	{
+		return;
+	}
+
+	// held until the event loop handed it to enet
+	pPacket->referenceCount++;
+	m_outboxes[t_worldSlot].push_back({ pPeer, pPacket });
+}
+
+void WorldScheduler::WorkerThread(const int slot)
+{
+	uint64_t lastRun = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_runStarted.wait(lock, [&]() { return m_bStopping || m_run != lastRun; });
+			if (m_bStopping)
+			{
+				return;
+			}
+
+			lastRun = m_run;
+		}
+
+		t_worldSlot = slot;
+		RunQueues(slot);
+		t_worldSlot = -1;
+	}
+}
+
+void WorldScheduler::RunQueues(const int slot)
+{
+	World* pWorld = NULL;
+	while ((pWorld = TakeWork(slot)) != NULL)
+	{
+		RunWorld(pWorld);
+		if (m_remaining.fetch_sub(1) == 1)
+		{
+			// last world of the run
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_runFinished.notify_all();
+		}
+	}
+}
+
+World* WorldScheduler::TakeWork(const int slot)
+{
+	{
+		WorldRunQueue& queue = *m_queues[slot];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.worlds.empty())
+		{
+			World* pWorld = queue.worlds.front();
+			queue.worlds.pop_front();
+			return pWorld;
+		}
+	}
+
+	for (int i = 1; i < m_queues.size(); i++)
+	{
+		WorldRunQueue& queue = *m_queues[(slot + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.worlds.empty())
+		{
+			World* pWorld = queue.worlds.back();
+			queue.worlds.pop_back();
+			return pWorld;
+		}
+	}
+
+	return NULL;
+}
+
+void WorldScheduler::RunWorld(World* pWorld)
+{
+	std::vector<WorldMessage>& mailbox = pWorld->GetMailbox();
+	for (int i = 0; i < mailbox.size(); i++)
+	{
+		WorldMessage& message = mailbox[i];
+		if (message.pClient->GetWorld() == pWorld)
+		{
+			GetPacketHandler()->HandleIncomingClientPacket(message.pClient->GetPeer(), message.pPacket);
+		}
+
+		enet_packet_destroy(message.pPacket);
+	}
+
+	mailbox.clear();
+
+	// the tile changes of the packets go out from the same thread
+	pWorld->FlushTileUpdates();
+}
+
+void WorldScheduler::FlushOutboxes()
+{
+	for (int i = 0; i < m_outboxes.size(); i++)
+	{
+		std::vector<WorldOutgoingPacket>& outbox = m_outboxes[i];
+		for (int j = 0; j < outbox.size(); j++)
+		{
+			WorldOutgoingPacket& outgoing = outbox[j];
+			if (outgoing.pPeer->state == ENET_PEER_STATE_CONNECTED)
+			{
+				// enet takes its own reference when it accepts the packet
+				enet_peer_send(outgoing.pPeer, 0, outgoing.pPacket);
+			}
+
+			if (--outgoing.pPacket->referenceCount == 0)
+			{
+				enet_packet_destroy(outgoing.pPacket);
+			}
+		}
+
+		outbox.clear();
+	}
+}
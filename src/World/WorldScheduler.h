@@ -0,0 +1,93 @@
+#ifndef WORLDSCHEDULER_H
+#define WORLDSCHEDULER_H
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+#include <enet/enet.h>
+
+#define WORLD_SCHEDULER_THREADS 0 // world threads next to the event loop, 0 is one per core
+#define WORLD_SCHEDULER_MAX_PENDING 512 // queued world packets that get run before more events are read
+
+// fowarded definitions
+class World;
+class GameClient;
+
+struct WorldMessage
+{
+	GameClient                   *pClient;
+	ENetPacket                   *pPacket; // owned by the mailbox until it's handled
+};
+
+struct WorldOutgoingPacket
+{
+	ENetPeer                     *pPeer;
+	ENetPacket                   *pPacket; // the outbox holds one reference
+};
+
+// a world thread's run queue, the owner takes from the front & the others steal from the back
+struct WorldRunQueue
+{
+	std::mutex                   mutex;
+	std::deque<World*>           worlds;
+};
+
+/*
+* Runs worlds as actors: packets that only concern one world are posted to that world's mailbox, and the mailboxes are run
+* in parallel on a work-stealing pool, each world on one thread at a time so its packets keep their order.
+*
+* Everything else(entering & leaving worlds, logons, disconnects, broadcasts) stays on the event loop, which first runs the
+* mailboxes with Run() so nothing overtakes a packet that came before it. Worlds & clients are only touched by the world
+* threads while Run() waits for them. ENet isn't thread safe, so packets sent from a world thread are kept in an outbox of
+* that thread & handed to enet by the event loop once every world is done.
+*/
+class WorldScheduler
+{
+public:
+	WorldScheduler() = default;
+	~WorldScheduler();
+
+
+	// get
+	int                          GetPendingCount() const { return m_pendingMessages; }
+	bool                         IsWorldThread() const; // true while running a world in parallel with others
+
+
+	// fn
+	void                         Start(int threads = WORLD_SCHEDULER_THREADS);
+	void                         Stop();
+
+	void                         Post(World* pWorld, GameClient* pClient, ENetPacket* pPacket); // event loop only, takes over the packet
+	void                         Run(); // event loop only, returns once every mailbox is empty
+	void                         QueueSend(ENetPeer* pPeer, ENetPacket* pPacket); // world threads only, sent by the event loop after the run
+
+private:
+	void                         WorkerThread(const int slot);
+	void                         RunQueues(const int slot);
+	World                        *TakeWork(const int slot);
+	void                         RunWorld(World* pWorld);
+	void                         FlushOutboxes();
+
+	std::vector<std::thread>     m_threads;
+	std::vector<std::unique_ptr<WorldRunQueue>> m_queues; // one per thread, 0 is the event loop
+	std::vector<std::vector<WorldOutgoingPacket>> m_outboxes; // one per thread, 0 is the event loop
+
+	std::mutex                   m_mutex;
+	std::condition_variable      m_runStarted;
+	std::condition_variable      m_runFinished;
+	uint64_t                     m_run = 0; // bumped for every parallel run, wakes the world threads
+	std::atomic<int>             m_remaining = 0; // worlds of the current run that didn't finish yet
+	bool                         m_bStopping = false;
+
+	std::vector<World*>          m_readyWorlds; // worlds with messages in their mailbox
+	int                          m_pendingMessages = 0;
+
+};
+
+WorldScheduler*                  GetWorldScheduler();
+
+#endif WORLDSCHEDULER_H
@@ -0,0 +1,498 @@
+#include <BaseApp.h> // precompiled
+#include <World/WorldStore.h>
+
+#include <cstdio>
+#include <fstream>
+#include <filesystem>
+#include <zlib.h>
+#ifdef _WIN32
+	#ifndef NOMINMAX
+	#define NOMINMAX
+	#endif
+	#include <windows.h>
+	#include <io.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include <World/World.h>
+
+#include <SDK/Proton/TextScanner.h>
+#include <SDK/Proton/MiscUtils.h>
+#include <SDK/Proton/MemoryWriter.h>
+#include <SDK/Proton/FileSystem/MappedFile.h>
+
+WorldStore g_worldStore;
+WorldStore* GetWorldStore() { return &g_worldStore; }
+
+static const int WORLD_FILE_HEADER_SIZE_V1 = sizeof(uint32_t) /* magic */ + sizeof(uint16_t) /* version */ + sizeof(int) /* world ID */ + sizeof(uint32_t) /* raw size */ + sizeof(uint32_t) /* compressed size */ + sizeof(uint32_t) /* crc32 */;
+static const int WORLD_FILE_HEADER_SIZE = WORLD_FILE_HEADER_SIZE_V1 + sizeof(uint32_t) /* journal sequence */;
+
+bool WorldStore::Init()
+{
+	TextScanner t;
+	t.LoadFile(WORLD_STORE_CONFIG_FILE);
+	if (!t.IsLoaded())
+	{
+		LogError("failed to load %s, worlds won't be saved", WORLD_STORE_CONFIG_FILE);
+		return false;
+	}
+
+	std::vector<nova_str> lines = t.GetLines();
+	for (int i = 0; i < lines.size(); i++)
+	{
+		const std::string& line = lines[i];
+		if (line.starts_with('#') || line.empty())
+		{
+			continue;
+		}
+
+		std::vector<nova_str> tokens = Utils::StringTokenize(line);
+		if (tokens.empty() || tokens[0] != "add_world_path")
+		{
+			continue;
+		}
+
+		if (tokens.size() < 4)
+		{
+			LogError("%s: add_world_path needs a path, a start & an end world ID", WORLD_STORE_CONFIG_FILE);
+			continue;
+		}
+
+		WorldPath worldPath;
+		worldPath.path = tokens[1];
+		worldPath.startID = atoi(tokens[2].c_str());
+		worldPath.endID = atoi(tokens[3].c_str());
+
+		// paths have to continue where the previous one ended, otherwise some world IDs would have no home or two of them
+		int expectedStartID = m_paths.empty() ? 0 : m_paths.back().endID;
+		if (worldPath.startID != expectedStartID || worldPath.endID <= worldPath.startID)
+		{
+			LogError("%s: world path %s covers %d-%d but has to start at %d, ignoring it", WORLD_STORE_CONFIG_FILE, worldPath.path.c_str(), worldPath.startID, worldPath.endID, expectedStartID);
+			continue;
+		}
+
+		std::error_code ec;
+		if (!std::filesystem::is_directory(worldPath.path, ec))
+		{
+			LogError("%s: world path %s doesn't exist, create it first", WORLD_STORE_CONFIG_FILE, worldPath.path.c_str());
+			continue;
+		}
+
+		m_paths.push_back(worldPath);
+	}
+
+	t.Kill();
+	if (m_paths.empty())
+	{
+		LogError("no usable world path in %s, worlds won't be saved", WORLD_STORE_CONFIG_FILE);
+		return false;
+	}
+
+	if (!LoadIndex())
+	{
+		m_paths.clear();
+		return false;
+	}
+
+	LogMsg("world store ready, %d worlds in %d paths", (int)m_worldIDs.size(), (int)m_paths.size());
+	return true;
+}
+
+bool WorldStore::LoadIndex()
+{
+	const std::string fName = m_paths[0].path + "/" + WORLD_STORE_INDEX_FILE;
+	std::error_code ec;
+	if (!std::filesystem::exists(fName, ec))
+	{
+		// no world was created yet
+		return true;
+	}
+
+	TextScanner t;
+	t.LoadFile(fName);
+	if (!t.IsLoaded())
+	{
+		LogError("failed to load world index %s", fName.c_str());
+		return false;
+	}
+
+	std::vector<nova_str> lines = t.GetLines();
+	for (int i = 0; i < lines.size(); i++)
+	{
+		std::vector<nova_str> tokens = Utils::StringTokenize(lines[i]);
+		if (tokens.size() < 2)
+		{
+			continue;
+		}
+
+		int worldID = atoi(tokens[1].c_str());
+		m_worldIDs[tokens[0]] = worldID;
+		m_nextWorldID = std::max(m_nextWorldID, worldID + 1);
+	}
+
+	t.Kill();
+	return true;
+}
+
+int WorldStore::GetWorldID(const std::string& name)
+{
+	auto it = m_worldIDs.find(name);
+	if (it == m_worldIDs.end())
+	{
+		return -1;
+	}
+
+	return it->second;
+}
+
+std::string WorldStore::GetWorldFilePath(const int& worldID, const char* extension)
+{
+	if (m_paths.empty() || worldID < 0)
+	{
+		return "";
+	}
+
+	for (int i = 0; i < m_paths.size() - 1; i++)
+	{
+		if (worldID < m_paths[i].endID)
+		{
+			return m_paths[i].path + "/" + std::to_string(worldID) + extension;
+		}
+	}
+
+	// the last path goes to infinity
+	return m_paths.back().path + "/" + std::to_string(worldID) + extension;
+}
+
+int WorldStore::CreateWorldID(const std::string& name)
+{
+	if (m_paths.empty())
+	{
+		// store is disabled
+		return -1;
+	}
+
+	int worldID = GetWorldID(name);
+	if (worldID != -1)
+	{
+		return worldID;
+	}
+
+	// appended right away, so the ID is never handed out twice even if the server dies before the world gets saved
+	std::ofstream o(m_paths[0].path + "/" + WORLD_STORE_INDEX_FILE, std::ios::app);
+	if (!o.is_open())
+	{
+		LogError("failed to open the world index to register %s", name.c_str());
+		return -1;
+	}
+
+	worldID = m_nextWorldID;
+	o << name << "|" << worldID << "\n";
+	o.close();
+	if (o.fail())
+	{
+		LogError("failed to register %s in the world index", name.c_str());
+		return -1;
+	}
+
+	m_worldIDs[name] = worldID;
+	m_nextWorldID++;
+	return worldID;
+}
+
+bool WorldStore::SerializeWorld(World* pWorld, std::vector<uint8_t>& raw)
+{
+	if (pWorld == NULL)
+	{
+		// world is null
+		return false;
+	}
+
+	MemoryWriter writer(m_sizeHint);
+	pWorld->Serialize(writer, false, 0.f, pWorld->GetMapVersion());
+	if (!writer.IsValid())
+	{
+		LogError("failed to serialize world %s", pWorld->GetName().c_str());
+		return false;
+	}
+
+	m_sizeHint = writer.GetSize();
+	raw.assign(writer.GetData(), writer.GetData() + writer.GetSize());
+	return true;
+}
+
+bool WorldStore::Compress(const std::vector<uint8_t>& raw, const int& worldID, const uint32_t& journalSeq, std::vector<uint8_t>& data)
+{
+	if (raw.size() > WORLD_FILE_MAX_RAW_SIZE)
+	{
+		// it couldn't be loaded back
+		LogError("world %d is %d bytes, more than a world file can hold", worldID, (int)raw.size());
+		return false;
+	}
+
+	uint32_t magic = WORLD_FILE_MAGIC;
+	uint16_t fileVersion = WORLD_FILE_VERSION;
+	int fileWorldID = worldID;
+	uint32_t rawSize = (uint32_t)raw.size();
+	uLongf compressedSize = compressBound(rawSize);
+	uint32_t checksum = crc32(0L, raw.data(), rawSize);
+	uint32_t fileJournalSeq = journalSeq;
+	data.resize(WORLD_FILE_HEADER_SIZE + compressedSize);
+	if (compress2(data.data() + WORLD_FILE_HEADER_SIZE, &compressedSize, raw.data(), rawSize, WORLD_FILE_COMPRESSION_LEVEL) != Z_OK)
+	{
+		LogError("failed to compress world %d", worldID);
+		return false;
+	}
+
+	uint32_t compressedSize32 = (uint32_t)compressedSize;
+	int offset = 0;
+	MemorySerializeRaw(magic, data.data(), offset, true);
+	MemorySerializeRaw(fileVersion, data.data(), offset, true);
+	MemorySerializeRaw(fileWorldID, data.data(), offset, true);
+	MemorySerializeRaw(rawSize, data.data(), offset, true);
+	MemorySerializeRaw(compressedSize32, data.data(), offset, true);
+	MemorySerializeRaw(checksum, data.data(), offset, true);
+	MemorySerializeRaw(fileJournalSeq, data.data(), offset, true);
+
+	data.resize(WORLD_FILE_HEADER_SIZE + compressedSize32);
+	return true;
+}
+
+bool WorldStore::Pack(World* pWorld, std::vector<uint8_t>& data)
+{
+	std::vector<uint8_t> raw;
+	if (!SerializeWorld(pWorld, raw))
+	{
+		return false;
+	}
+
+	return Compress(raw, pWorld->GetID(), pWorld->GetJournalSeq(), data);
+}
+
+World* WorldStore::Unpack(const uint8_t* pData, const size_t& size, const int& worldID, const std::string& source)
+{
+	if (pData == NULL || size < WORLD_FILE_HEADER_SIZE_V1)
+	{
+		LogError("%s is truncated", source.c_str());
+		return NULL;
+	}
+
+	uint32_t magic = 0;
+	uint16_t fileVersion = 0;
+	int fileWorldID = 0;
+	uint32_t rawSize = 0;
+	uint32_t compressedSize = 0;
+	uint32_t checksum = 0;
+	uint32_t journalSeq = 0;
+
+	uint8_t* pMem = (uint8_t*)pData;
+	int offset = 0;
+	MemorySerializeRaw(magic, pMem, offset, false);
+	MemorySerializeRaw(fileVersion, pMem, offset, false);
+	MemorySerializeRaw(fileWorldID, pMem, offset, false);
+	MemorySerializeRaw(rawSize, pMem, offset, false);
+	MemorySerializeRaw(compressedSize, pMem, offset, false);
+	MemorySerializeRaw(checksum, pMem, offset, false);
+
+	if (magic != WORLD_FILE_MAGIC || fileVersion < 1 || fileVersion > WORLD_FILE_VERSION)
+	{
+		LogError("%s isn't a world file of version %d or older", source.c_str(), WORLD_FILE_VERSION);
+		return NULL;
+	}
+
+	if (fileVersion >= 2)
+	{
+		// version 1 files were written before the journal, none of its records are in them
+		if (size < WORLD_FILE_HEADER_SIZE)
+		{
+			LogError("%s is truncated", source.c_str());
+			return NULL;
+		}
+
+		MemorySerializeRaw(journalSeq, pMem, offset, false);
+	}
+
+	if (fileWorldID != worldID || compressedSize != (uint32_t)(size - offset) || rawSize > WORLD_FILE_MAX_RAW_SIZE)
+	{
+		// the sizes are checked before anything gets allocated for them
+		LogError("%s is corrupted", source.c_str());
+		return NULL;
+	}
+
+	std::vector<uint8_t> data(rawSize);
+	uLongf uncompressedSize = rawSize;
+	if (uncompress(data.data(), &uncompressedSize, pMem + offset, compressedSize) != Z_OK || uncompressedSize != rawSize || crc32(0L, data.data(), rawSize) != checksum)
+	{
+		LogError("%s is corrupted", source.c_str());
+		return NULL;
+	}
+
+	World* pWorld = LoadRaw(data.data(), data.size(), source);
+	if (pWorld != NULL)
+	{
+		pWorld->SetJournalSeq(journalSeq);
+	}
+
+	return pWorld;
+}
+
+World* WorldStore::LoadRaw(const uint8_t* pData, const size_t& size, const std::string& source)
+{
+	World* pWorld = new World("");
+	int offset = 0;
+	if (!pWorld->Load((uint8_t*)pData, offset, false) || offset != (int)size)
+	{
+		LogError("failed to load world from %s", source.c_str());
+		delete pWorld;
+		return NULL;
+	}
+
+	pWorld->MarkSaved();
+	return pWorld;
+}
+
+bool WorldStore::WriteWorldFile(const int& worldID, const std::vector<uint8_t>& data)
+{
+	const std::string fName = GetWorldFilePath(worldID);
+	if (fName.empty())
+	{
+		// store is disabled or the world was never registered
+		return false;
+	}
+
+	return ReplaceFile(fName, data.data(), data.size());
+}
+
+bool WorldStore::ReplaceFile(const std::string& fName, const uint8_t* pData, const size_t& size)
+{
+	// written next to the file, synced and only then renamed over it, so the rename never points at data that isn't on disk yet
+	const std::string tempName = fName + ".tmp";
+	FILE* pFile = fopen(tempName.c_str(), "wb");
+	if (pFile == NULL)
+	{
+		LogError("failed to open %s", tempName.c_str());
+		return false;
+	}
+
+	bool bWritten = fwrite(pData, 1, size, pFile) == size && fflush(pFile) == 0;
+#ifdef _WIN32
+	bWritten = bWritten && _commit(_fileno(pFile)) == 0;
+#else
+	bWritten = bWritten && fsync(fileno(pFile)) == 0;
+#endif
+	fclose(pFile);
+	if (!bWritten)
+	{
+		LogError("failed to write %s", tempName.c_str());
+		std::remove(tempName.c_str());
+		return false;
+	}
+
+	// the old file stays until the new one takes its name, there's no moment without either
+#ifdef _WIN32
+	const bool bRenamed = MoveFileExA(tempName.c_str(), fName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	const bool bRenamed = std::rename(tempName.c_str(), fName.c_str()) == 0;
+#endif
+	if (!bRenamed)
+	{
+		LogError("failed to replace %s", fName.c_str());
+		std::remove(tempName.c_str());
+		return false;
+	}
+
+	return SyncDirectory(fName);
+}
+
+bool WorldStore::SyncDirectory(const std::string& fName)
+{
+#ifdef _WIN32
+	// MOVEFILE_WRITE_THROUGH & _commit already flushed the metadata
+	return true;
+#else
+	std::string dir = std::filesystem::path(fName).parent_path().string();
+	if (dir.empty())
+	{
+		dir = ".";
+	}
+
+	int fd = open(dir.c_str(), O_RDONLY);
+	if (fd == -1)
+	{
+		LogError("failed to open %s to sync it", dir.c_str());
+		return false;
+	}
+
+	const bool bSynced = fsync(fd) == 0;
+	close(fd);
+	if (!bSynced)
+	{
+		LogError("failed to sync %s", dir.c_str());
+	}
+
+	return bSynced;
+#endif
+}
+
+bool WorldStore::HasWorldFile(const int& worldID)
+{
+	const std::string fName = GetWorldFilePath(worldID);
+	std::error_code ec;
+	return !fName.empty() && std::filesystem::exists(fName, ec);
+}
+
+bool WorldStore::Save(World* pWorld)
+{
+	if (pWorld == NULL || GetWorldFilePath(pWorld->GetID()).empty())
+	{
+		// world is null, store is disabled or the world was never registered
+		return false;
+	}
+
+	std::vector<uint8_t> data;
+	if (!Pack(pWorld, data))
+	{
+		return false;
+	}
+
+	if (!WriteWorldFile(pWorld->GetID(), data))
+	{
+		return false;
+	}
+
+	pWorld->MarkSaved();
+	return true;
+}
+
+World* WorldStore::Load(const std::string& name)
+{
+	int worldID = GetWorldID(name);
+	if (worldID == -1)
+	{
+		// world was never created
+		return NULL;
+	}
+
+	return Load(worldID);
+}
+
+World* WorldStore::Load(const int& worldID)
+{
+	const std::string fName = GetWorldFilePath(worldID);
+	if (fName.empty())
+	{
+		// store is disabled
+		return NULL;
+	}
+
+	MappedFile f;
+	if (!f.Open(fName))
+	{
+		// registered, but never saved
+		return NULL;
+	}
+
+	return Unpack(f.GetAsBytes(), f.GetSize(), worldID, fName);
+}
@@ -0,0 +1,80 @@
+#ifndef WORLDSTORE_H
+#define WORLDSTORE_H
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#define WORLD_STORE_CONFIG_FILE "local_config.txt"
+#define WORLD_STORE_INDEX_FILE "worlds.txt" // name|worldID lines, kept in the first world path
+#define WORLD_FILE_EXTENSION ".world"
+#define WORLD_FILE_MAGIC 0x444C5257 // WRLD
+#define WORLD_FILE_VERSION 2 // bump whenever the server side world serialization changes, 2 added the journal sequence to the header
+#define WORLD_FILE_COMPRESSION_LEVEL 1 // zlib level, worlds are saved way more often than they are read
+#define WORLD_FILE_MAX_RAW_SIZE (255 * 255 * 1024) // a 255x255 world at 1 KB a tile, headers claiming more are corrupted
+
+struct WorldPath
+{
+	std::string path;
+	int startID; // first world ID stored in this path
+	int endID; // world ID this path ends at(exclusive), the last path goes to infinity
+};
+
+// fowarded definitions
+class World;
+
+/*
+* Persistent world storage.
+*
+* Every world is kept in its own file, named after the world ID & placed in the add_world_path directory from local_config.txt
+* that covers the ID. The file is the server side serialization of the world compressed with zlib, behind a versioned header
+* carrying the sizes, a crc32 of the uncompressed data and the last journal record the file already contains(see WorldJournal).
+*/
+class WorldStore
+{
+public:
+	WorldStore() = default;
+	~WorldStore() = default;
+
+
+	// get
+	bool                         IsLoaded() const { return !m_paths.empty(); }
+	int                          GetWorldID(const std::string& name); // -1 if the world was never created
+	std::string                  GetWorldFilePath(const int& worldID, const char* extension = WORLD_FILE_EXTENSION); // files of a world are all kept next to each other
+
+
+	// fn
+	bool                         Init(); // reads the world paths & the world index
+	int                          CreateWorldID(const std::string& name); // registers a new world, -1 on failure
+
+	bool                         Save(World* pWorld);
+	World                        *Load(const std::string& name); // NULL if the world doesn't exist or failed to load
+	World                        *Load(const int& worldID);
+
+	// the world file image, also used to keep evicted worlds compressed in memory when there's no world path
+	bool                         Pack(World* pWorld, std::vector<uint8_t>& data);
+	World                        *Unpack(const uint8_t* pData, const size_t& size, const int& worldID, const std::string& source);
+
+	// steps of Save & Load, everything but SerializeWorld is safe to call from the world I/O workers
+	bool                         SerializeWorld(World* pWorld, std::vector<uint8_t>& raw); // server side serialization, event loop only
+	bool                         Compress(const std::vector<uint8_t>& raw, const int& worldID, const uint32_t& journalSeq, std::vector<uint8_t>& data);
+	World                        *LoadRaw(const uint8_t* pData, const size_t& size, const std::string& source);
+	bool                         WriteWorldFile(const int& worldID, const std::vector<uint8_t>& data); // true once the file is on disk for good
+	bool                         HasWorldFile(const int& worldID);
+
+	// a crash at any point leaves either the old or the new file behind, both calls return once it's on disk for good
+	bool                         ReplaceFile(const std::string& fName, const uint8_t* pData, const size_t& size);
+	bool                         SyncDirectory(const std::string& fName); // the directory entry of the file, after creating or renaming it
+
+private:
+	bool                         LoadIndex();
+
+	std::vector<WorldPath>       m_paths;
+	std::unordered_map<std::string, int> m_worldIDs; // world name to world ID
+	int                          m_nextWorldID = 0;
+	size_t                       m_sizeHint = 64 * 1024; // size of the last saved world, initial capacity for the next one
+
+};
+
+WorldStore*                      GetWorldStore();
+
+#endif WORLDSTORE_H
@@ -0,0 +1,122 @@
+#include <BaseApp.h> // precompiled
+#include <World/WorldTemplatePool.h>
+
+#include <World/World.h>
+#include <Items/ItemInfoPublisher.h>
+
+WorldTemplatePool g_worldTemplatePool;
+WorldTemplatePool* GetWorldTemplatePool() { return &g_worldTemplatePool; }
+
+WorldTemplatePool::~WorldTemplatePool()
+{
+	Stop();
+}
+
+void WorldTemplatePool::Start()
+{
+	if (m_thread.joinable())
+	{
+		// already running
+		return;
+	}
+
+	m_bStopping = false;
+	m_targets[TERRATYPE_SUNNY] = WORLD_TEMPLATES_PER_TYPE;
+	m_thread = std::thread(&WorldTemplatePool::GeneratorThread, this);
+}
+
+void WorldTemplatePool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+
+	m_taken.notify_all();
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+
+	for (int i = 0; i < NUM_TERRAFORMTYPE; i++)
+	{
+		for (int j = 0; j < m_templates[i].size(); j++)
+		{
+			delete m_templates[i][j];
+		}
+
+		m_templates[i].clear();
+	}
+}
+
+WorldTileMap* WorldTemplatePool::Take(const uint8_t& terraformType)
+{
+	if (terraformType >= NUM_TERRAFORMTYPE)
+	{
+		// invalid terraform type
+		return NULL;
+	}
+
+	WorldTileMap * pTileMap = NULL;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// from now on this type is kept ready too
+		m_targets[terraformType] = WORLD_TEMPLATES_PER_TYPE;
+		if (!m_templates[terraformType].empty())
+		{
+			pTileMap = m_templates[terraformType].back();
+			m_templates[terraformType].pop_back();
+		}
+	}
+
+	m_taken.notify_one();
+	return pTileMap;
+}
+
+void WorldTemplatePool::GeneratorThread()
+{
+	// seeded once, every terrain continues the sequence
+	FastRandom rng((uint64_t)std::random_device()() << 32 | std::random_device()());
+	while (true)
+	{
+		int terraformType = -1;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taken.wait(lock, [&]()
+			{
+				if (m_bStopping)
+				{
+					return true;
+				}
+
+				for (int i = 0; i < NUM_TERRAFORMTYPE; i++)
+				{
+					if (m_templates[i].size() < m_targets[i])
+					{
+						terraformType = i;
+						return true;
+					}
+				}
+
+				return false;
+			});
+
+			if (m_bStopping)
+			{
+				return;
+			}
+		}
+
+		// generated without holding the lock, the tile map isn't shared until it's in the pool
+		WorldTileMap * pTileMap = new WorldTileMap(WORLD_DEFAULT_WIDTH, WORLD_DEFAULT_HEIGHT);
+		{
+			// the main door & the collision bits look up items, the snapshot can't be freed under them
+			ItemInfoPin pin;
+			pTileMap->GenerateTerrain(terraformType, WORLD_DEFAULT_WIDTH, WORLD_DEFAULT_HEIGHT, rng.Next() | 1);
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_templates[terraformType].push_back(pTileMap);
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef WORLDTEMPLATEPOOL_H
+#define WORLDTEMPLATEPOOL_H
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+#include <World/WorldTileMap.h>
+
+#define WORLD_TEMPLATES_PER_TYPE 8 // generated terrains kept ready for every terraform type that was asked for
+
+/*
+* Generates the terrain of new worlds ahead of time on a background thread, so creating a world doesn't have to generate it
+* inside WorldsManager::Enter. Every terraform type keeps up to WORLD_TEMPLATES_PER_TYPE ready tile maps of the default size, sunny worlds from the
+* start & the other types once they were asked for. Take() hands a ready tile map over, or NULL when the pool ran dry, in
+* which case the caller generates it itself.
+*/
+class WorldTemplatePool
+{
+public:
+	WorldTemplatePool() = default;
+	~WorldTemplatePool();
+
+
+	// fn
+	void                         Start(); // only once the item database is loaded, the main doors need it
+	void                         Stop();
+
+	WorldTileMap                 *Take(const uint8_t& terraformType); // owned by the caller, NULL if there's none ready
+
+private:
+	void                         GeneratorThread();
+
+	std::thread                  m_thread;
+	std::mutex                   m_mutex;
+	std::condition_variable      m_taken;
+	bool                         m_bStopping = false;
+
+	std::vector<WorldTileMap*>   m_templates[NUM_TERRAFORMTYPE];
+	int                          m_targets[NUM_TERRAFORMTYPE] = {}; // how many templates of every type are kept ready
+
+};
+
+WorldTemplatePool*               GetWorldTemplatePool();
+
+#endif WORLDTEMPLATEPOOL_H
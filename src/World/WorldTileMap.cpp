@@ -1,9 +1,184 @@
 #include <BaseApp.h> // precompiled
 #include <World/WorldTileMap.h>
 
+#include <mutex>
+#include <queue>
+
 #include <SDK/Proton/MiscUtils.h>
 
-Tile* WorldTileMap::GetTile(const int& x, const int& y)
+// the pages tile maps share, by the hash of their fields. Only weak references are kept, so a page goes away with the last
+// tile map using it. Every tile map thread(loading, generating, writing) goes through the mutex.
+struct TilePageStore
+{
+	std::mutex                            mutex;
+	std::unordered_map<uint64_t, std::vector<std::weak_ptr<TilePage>>> pages;
+	size_t                                count = 0; // weak references kept, including expired ones
+	size_t                                nextSweep = 4096; // count at which the expired references are dropped
+};
+
+static TilePageStore s_pageStore;
+
+WorldTileMap::~WorldTileMap()
+{
+	for (auto& extra : m_extras)
+	{
+		m_extraPool.Destroy(extra.second);
+	}
+}
+
+void WorldTileMap::Resize(const uint8_t& width, const uint8_t& height)
+{
+	for (auto& extra : m_extras)
+	{
+		// the slots are kept by the pool for the extras of the new tiles
+		m_extraPool.Destroy(extra.second);
+	}
+
+	m_width = width;
+	m_height = height;
+	m_pageTiles = WORLD_PAGE_ROWS * width;
+	m_solidBits.assign((GetTileCount() + 63) / 64, 0);
+	m_pages.clear();
+	for (int y = 0; y < height; y += WORLD_PAGE_ROWS)
+	{
+		// a blank tile is all zeroes(ITEM_ID_BLANK, TILEFLAGS_NONE, no locks)
+		std::shared_ptr<TilePage> pPage = std::make_shared<TilePage>();
+		pPage->tilesCount = (uint16_t)(std::min(WORLD_PAGE_ROWS, height - y) * width);
+		pPage->fields.assign(NUM_TILEFIELDS * pPage->tilesCount, 0);
+		m_pages.push_back(pPage);
+	}
+
+	m_extras.clear();
+	m_timers.clear();
+	m_locks.clear();
+}
+
+const uint16_t* WorldTileMap::GetRow(const int& field, const int& y) const
+{
+	return m_pages[y / WORLD_PAGE_ROWS]->GetField(field) + (y % WORLD_PAGE_ROWS) * m_width;
+}
+
+uint16_t* WorldTileMap::GetWritableRow(const int& field, const int& y)
+{
+	const int page = y / WORLD_PAGE_ROWS;
+	if (m_pages[page]->bShared)
+	{
+		UnsharePage(page);
+	}
+
+	return m_pages[page]->GetField(field) + (y % WORLD_PAGE_ROWS) * m_width;
+}
+
+void WorldTileMap::UnsharePage(const int& page)
+{
+	std::shared_ptr<TilePage>& pPage = m_pages[page];
+	{
+		// new references are only taken from the store under its lock, so a page nobody else holds stays that way
+		std::lock_guard<std::mutex> lock(s_pageStore.mutex);
+		if (pPage.use_count() == 1)
+		{
+			// no other tile map reads it, taking it back from the store instead of copying it
+			auto it = s_pageStore.pages.find(pPage->hash);
+			if (it != s_pageStore.pages.end())
+			{
+				std::vector<std::weak_ptr<TilePage>>& bucket = it->second;
+				for (int i = 0; i < bucket.size(); i++)
+				{
+					if (!bucket[i].owner_before(pPage) && !pPage.owner_before(bucket[i]))
+					{
+						bucket[i] = bucket.back();
+						bucket.pop_back();
+						s_pageStore.count--;
+						break;
+					}
+				}
+
+				if (bucket.empty())
+				{
+					s_pageStore.pages.erase(it);
+				}
+			}
+
+			pPage->bShared = false;
+			return;
+		}
+	}
+
+	// other tile maps still read the page, the writes go to a copy of it
+	std::shared_ptr<TilePage> pCopy = std::make_shared<TilePage>();
+	pCopy->tilesCount = pPage->tilesCount;
+	pCopy->fields = pPage->fields;
+	pPage = pCopy;
+}
+
+void WorldTileMap::SharePages()
+{
+	std::vector<uint64_t> hashes(m_pages.size());
+	for (int i = 0; i < m_pages.size(); i++)
+	{
+		// hashed before taking the lock, the pages aren't shared yet
+		const std::vector<uint16_t>& fields = m_pages[i]->fields;
+		hashes[i] = HashStringFNV(std::string_view((const char*)fields.data(), fields.size() * sizeof(uint16_t)));
+	}
+
+	std::lock_guard<std::mutex> lock(s_pageStore.mutex);
+	for (int i = 0; i < m_pages.size(); i++)
+	{
+		std::shared_ptr<TilePage>& pPage = m_pages[i];
+		if (pPage->bShared)
+		{
+			// shared already
+			continue;
+		}
+
+		bool bFound = false;
+		std::vector<std::weak_ptr<TilePage>>& bucket = s_pageStore.pages[hashes[i]];
+		for (int j = 0; j < bucket.size(); j++)
+		{
+			std::shared_ptr<TilePage> pShared = bucket[j].lock();
+			if (pShared != NULL && pShared->tilesCount == pPage->tilesCount && pShared->fields == pPage->fields)
+			{
+				// an equal page is around already, this one goes away
+				pPage = pShared;
+				bFound = true;
+				break;
+			}
+		}
+
+		if (!bFound)
+		{
+			pPage->hash = hashes[i];
+			pPage->bShared = true;
+			bucket.push_back(pPage);
+			s_pageStore.count++;
+		}
+	}
+
+	if (s_pageStore.count < s_pageStore.nextSweep)
+	{
+		return;
+	}
+
+	// dropping the references of the pages that went away
+	s_pageStore.count = 0;
+	for (auto it = s_pageStore.pages.begin(); it != s_pageStore.pages.end();)
+	{
+		std::vector<std::weak_ptr<TilePage>>& bucket = it->second;
+		bucket.erase(std::remove_if(bucket.begin(), bucket.end(), [](const std::weak_ptr<TilePage>& page) { return page.expired(); }), bucket.end());
+		if (bucket.empty())
+		{
+			it = s_pageStore.pages.erase(it);
+			continue;
+		}
+
+		s_pageStore.count += bucket.size();
+		it++;
+	}
+
+	s_pageStore.nextSweep = std::max<size_t>(4096, s_pageStore.count * 2);
+}
+
+Tile WorldTileMap::GetTile(const int& x, const int& y)
 {
 	if (x < 0 || x >= m_width || y < 0 || y >= m_height)
 	{
@@ -11,21 +186,21 @@ Tile* WorldTileMap::GetTile(const int& x, const int& y)
 		return NULL;
 	}
 
-	return &m_tiles[x + y * m_width];
+	return Tile(this, (uint16_t)(x + y * m_width));
 }
 
-Tile* WorldTileMap::GetTile(const uint16_t& index)
+Tile WorldTileMap::GetTile(const uint16_t& index)
 {
-	if (index < 0 || index >= m_width * m_height)
+	if (index >= m_width * m_height)
 	{
 		// tile index is out of bounds.
 		return NULL;
 	}
 
-	return &m_tiles[index];
+	return Tile(this, index);
 }
 
-Tile* WorldTileMap::GetTile(const float& x, const float& y)
+Tile WorldTileMap::GetTile(const float& x, const float& y)
 {
 	int tileX = static_cast<int>(x);
 	int tileY = static_cast<int>(y);
@@ -35,10 +210,10 @@ Tile* WorldTileMap::GetTile(const float& x, const float& y)
 		return NULL;
 	}
 
-	return &m_tiles[tileX + tileY * m_width];
+	return Tile(this, (uint16_t)(tileX + tileY * m_width));
 }
 
-Tile* WorldTileMap::GetTile(const CL_Vec2f& vec)
+Tile WorldTileMap::GetTile(const CL_Vec2f& vec)
 {
 	int tileX = static_cast<int>(vec.X);
 	int tileY = static_cast<int>(vec.Y);
@@ -48,10 +223,10 @@ Tile* WorldTileMap::GetTile(const CL_Vec2f& vec)
 		return NULL;
 	}
 
-	return &m_tiles[tileX + tileY * m_width];
+	return Tile(this, (uint16_t)(tileX + tileY * m_width));
 }
 
-Tile* WorldTileMap::GetTile(const CL_Vec2i& vec)
+Tile WorldTileMap::GetTile(const CL_Vec2i& vec)
 {
 	if (vec.X < 0 || vec.X >= m_width || vec.Y < 0 || vec.Y >= m_height)
 	{
@@ -59,355 +234,675 @@ Tile* WorldTileMap::GetTile(const CL_Vec2i& vec)
 		return NULL;
 	}
 
-	return &m_tiles[vec.X + vec.Y * m_width];
+	return Tile(this, (uint16_t)(vec.X + vec.Y * m_width));
 }
 
-size_t WorldTileMap::GetMemoryEstimated(const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion)
+void WorldTileMap::Serialize(MemoryWriter& writer, const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion, const SerializedTiles* pPrevious, SerializedTiles* pOut)
 {
-	size_t estimated = 0;
-	estimated += sizeof(int); // map width
-	estimated += sizeof(int); // map height
-	estimated += sizeof(int); // map tiles size(width * height)
+	int width = m_width;
+	int height = m_height;
+	writer.Write(width);
+	writer.Write(height);
 
+	int tiles_length = m_width * m_height;
+	writer.Write(tiles_length);
+	
 	if (bClientSide && fClientVersion >= 4.31f)
 	{
 		// some new ubisoft garbage for client side only
-		estimated += sizeof(int);
-		estimated += sizeof(uint8_t);
+		int zero = 0;
+		uint8_t zero2 = 0;
+		writer.Write(zero);
+		writer.Write(zero2);
+	}
+
+	const int tilesCount = GetTileCount();
+	if (pOut != NULL)
+	{
+		pOut->revision = m_revision;
+		pOut->offsets.resize(tilesCount + 1);
 	}
 
-	for (int i = 0; i < m_tiles.size(); i++)
+	bool bPatch = pPrevious != NULL && pPrevious->pData != NULL && pPrevious->offsets.size() == tilesCount + 1;
+	int i = 0;
+	while (i < tilesCount)
 	{
-		Tile * pTile = &m_tiles[i];
-		if (pTile == NULL)
+		if (bPatch && !IsTileChangedSince(i, pPrevious->revision))
 		{
-			// tile is null
+			// copying the whole run of unchanged tiles at once
+			int runEnd = i;
+			size_t runStart = writer.GetSize();
+			while (runEnd < tilesCount && !IsTileChangedSince(runEnd, pPrevious->revision))
+			{
+				if (pOut != NULL)
+				{
+					pOut->offsets[runEnd] = (uint32_t)(runStart + pPrevious->offsets[runEnd] - pPrevious->offsets[i]);
+				}
+
+				runEnd++;
+			}
+
+			writer.WriteRaw(pPrevious->pData + pPrevious->offsets[i], pPrevious->offsets[runEnd] - pPrevious->offsets[i]);
+			i = runEnd;
 			continue;
 		}
 
-		estimated += pTile->GetMemoryEstimated(bClientSide, fClientVersion, worldMapVersion);
+		if (pOut != NULL)
+		{
+			pOut->offsets[i] = (uint32_t)writer.GetSize();
+		}
+
+		Tile(this, (uint16_t)i).Serialize(writer, bClientSide, fClientVersion, worldMapVersion);
+		i++;
 	}
 
-	return estimated;
+	if (pOut != NULL)
+	{
+		pOut->offsets[tilesCount] = (uint32_t)writer.GetSize();
+	}
 }
 
-void WorldTileMap::Serialize(uint8_t * pData, int& memOffset, const bool& bClientSide, const float& fClientVersion, const uint16_t& worldMapVersion)
+bool WorldTileMap::Load(uint8_t* pData, int& memOffset, const bool& bClientSide, const uint16_t& worldMapVersion)
 {
-    if (pData == NULL)
+	if (pData == NULL || bClientSide)
 	{
-        // data is null
-		return;
+		// data is null, or client side data which can't be read back
+		return false;
 	}
 
-	int width = m_width;
-	int height = m_height;
-	MemorySerializeRaw(width, pData, memOffset, true);
-	MemorySerializeRaw(height, pData, memOffset, true);
-
-	int tiles_length = m_width * m_height;
-	MemorySerializeRaw(tiles_length, pData, memOffset, true);
-	
-	if (bClientSide && fClientVersion >= 4.31f)
+	int width = 0;
+	int height = 0;
+	int tiles_length = 0;
+	MemorySerializeRaw(width, pData, memOffset, false);
+	MemorySerializeRaw(height, pData, memOffset, false);
+	MemorySerializeRaw(tiles_length, pData, memOffset, false);
+	if (width <= 0 || width > 255 || height <= 0 || height > 255 || tiles_length != width * height)
 	{
-		// some new ubisoft garbage for client side only
-		int zero = 0;
-		uint8_t zero2 = 0;
-		MemorySerializeRaw(zero, pData, memOffset, true);
-		MemorySerializeRaw(zero2, pData, memOffset, true);
+		LogError("world has invalid tile map size %dx%d(%d tiles)", width, height, tiles_length);
+		return false;
 	}
 
-	for (int i = 0; i < m_tiles.size(); i++)
+	Resize((uint8_t)width, (uint8_t)height);
+	m_spawnPoint = CL_Vec2f(0.f, 0.f);
+	for (int i = 0; i < tiles_length; i++)
 	{
-		Tile * pTile = &m_tiles[i];
-		if (pTile == NULL)
+		Tile tile = Tile(this, (uint16_t)i);
+		if (!tile.Load(pData, memOffset, bClientSide, worldMapVersion))
 		{
-			// tile is null
-			continue;
+			return false;
 		}
 
-		pTile->Serialize(pData, memOffset, bClientSide, fClientVersion, worldMapVersion);
+		if (tile.GetForeground() == ITEM_ID_MAIN_DOOR)
+		{
+			// the spawn point isn't saved, it's always the main door
+			m_spawnPoint = CL_Vec2f((float)(i % m_width) * 32.f + 5.f, (float)(i / m_width) * 32.f);
+		}
 	}
+
+	SharePages();
+	MarkAllDirty();
+	return true;
 }
 
-void WorldTileMap::ChooseVisualBackground(Tile* pTile, ItemInfo* pItemInfo, int& textureOffsetX, int& textureOffsetY)
+size_t WorldTileMap::GetMemoryUsage()
 {
-	if (pTile == NULL || pItemInfo == NULL)
+	size_t usage = sizeof(WorldTileMap) + m_chunkRevisions.capacity() * sizeof(uint32_t) + m_changedTiles.capacity() * sizeof(int) + m_journalTiles.capacity() * sizeof(int);
+	usage += m_pages.capacity() * sizeof(std::shared_ptr<TilePage>);
+	for (int i = 0; i < m_pages.size(); i++)
 	{
-		// null pointers, cant procceed.
+		// shared pages are split between the tile maps using them
+		const size_t pageUsage = sizeof(TilePage) + m_pages[i]->fields.capacity() * sizeof(uint16_t);
+		usage += m_pages[i]->bShared ? pageUsage / std::max<long>(1, m_pages[i].use_count()) : pageUsage;
+	}
+
+	// side table entries cost a node with two pointers on top of the value
+	usage += m_extras.size() * (sizeof(std::pair<const uint16_t, TileExtra*>) + sizeof(void*) * 2);
+	usage += m_timers.size() * (sizeof(std::pair<const uint16_t, TileTimers>) + sizeof(void*) * 2);
+	for (auto& lock : m_locks)
+	{
+		usage += sizeof(std::pair<const uint16_t, TileLock>) + sizeof(void*) * 2 + lock.second.tiles.capacity() * sizeof(uint16_t) + lock.second.admins.capacity() * sizeof(int);
+	}
+
+	usage += m_extraPool.GetMemoryUsage();
+	for (auto& extra : m_extras)
+	{
+		usage += extra.second->GetHeapUsage();
+	}
+
+	return usage;
+}
+
+bool WorldTileMap::IsTileChangedSince(const int& index, const uint32_t& revision)
+{
+	const int chunk = GetChunkIndex(index);
+	if (chunk >= m_chunkRevisions.size())
+	{
+		return true;
+	}
+
+	return m_chunkRevisions[chunk] > revision;
+}
+
+bool WorldTileMap::TakeChangedTiles(std::vector<int>& changedTiles, bool& bAllChanged)
+{
+	changedTiles.clear();
+	bAllChanged = m_bAllChanged;
+	if (m_changedTiles.empty() && m_bAllChanged == false)
+	{
+		// nothing changed since the last call
+		return false;
+	}
+
+	changedTiles.swap(m_changedTiles);
+	m_bAllChanged = false;
+	return true;
+}
+
+bool WorldTileMap::TakeJournalTiles(std::vector<int>& changedTiles, bool& bAllChanged)
+{
+	changedTiles.clear();
+	bAllChanged = m_bJournalAll;
+	if (m_journalTiles.empty() && m_bJournalAll == false)
+	{
+		// nothing changed since the last call
+		return false;
+	}
+
+	changedTiles.swap(m_journalTiles);
+	m_bJournalAll = false;
+	return true;
+}
+
+TileLock* WorldTileMap::GetLock(const uint16_t& lockIndex)
+{
+	auto it = m_locks.find(lockIndex);
+	if (it == m_locks.end())
+	{
+		return NULL;
+	}
+
+	return &it->second;
+}
+
+bool WorldTileMap::CanBuildInAreaLock(const int& index, const int& userID)
+{
+	if (index < 0 || index >= GetTileCount())
+	{
+		// tile index is out of bounds.
+		return true;
+	}
+
+	// the tile is either locked by an area lock or a lock itself
+	const uint16_t lockIndex = GetField(TILEFIELD_PARENT, index) != 0 ? GetField(TILEFIELD_PARENT, index) : (uint16_t)index;
+	if (GetField(TILEFIELD_FLAGS, lockIndex) & TILEFLAG_PUBLIC)
+	{
+		// anyone can build in public locks
+		return true;
+	}
+
+	TileLock * pLock = GetLock(lockIndex);
+	if (pLock == NULL || pLock->ownerID == -1)
+	{
+		// lock has no owner
+		return true;
+	}
+
+	return pLock->ownerID == userID || std::find(pLock->admins.begin(), pLock->admins.end(), userID) != pLock->admins.end();
+}
+
+void WorldTileMap::SetLockAccess(const uint16_t& lockIndex, const int& ownerID, const std::vector<int>& admins)
+{
+	if (lockIndex >= GetTileCount())
+	{
+		// lock index is out of bounds.
 		return;
 	}
 
-	// some hardcoded type shi
-	int lut4bit[16] = { 12, 11, 15, 8, 14, 7, 13, 2, 10, 9, 6, 4, 5, 3, 1, 0 };
-	int lut8bit[255];
-	lut8bit[2] = 11;
-	lut8bit[8] = 30;
-	lut8bit[10] = 44;
-	lut8bit[11] = 8;
-	lut8bit[16] = 29;
-	lut8bit[18] = 43;
-	lut8bit[22] = 7;
-	lut8bit[24] = 28;
-	lut8bit[26] = 42;
-	lut8bit[27] = 41;
-	lut8bit[30] = 40;
-	lut8bit[31] = 2;
-	lut8bit[64] = 10;
-	lut8bit[66] = 9;
-	lut8bit[72] = 46;
-	lut8bit[74] = 36;
-	lut8bit[75] = 35;
-	lut8bit[80] = 45;
-	lut8bit[82] = 33;
-	lut8bit[86] = 32;
-	lut8bit[88] = 39;
-	lut8bit[90] = 27;
-	lut8bit[91] = 23;
-	lut8bit[94] = 24;
-	lut8bit[95] = 18;
-	lut8bit[104] = 6;
-	lut8bit[106] = 34;
-	lut8bit[107] = 4;
-	lut8bit[120] = 38;
-	lut8bit[122] = 25;
-	lut8bit[123] = 20;
-	lut8bit[126] = 21;
-	lut8bit[127] = 16;
-	lut8bit[208] = 5;
-	lut8bit[210] = 31;
-	lut8bit[214] = 3;
-	lut8bit[216] = 37;
-	lut8bit[218] = 26;
-	lut8bit[219] = 22;
-	lut8bit[222] = 19;
-	lut8bit[223] = 15;
-	lut8bit[248] = 1;
-	lut8bit[250] = 17;
-	lut8bit[251] = 14;
-	lut8bit[254] = 13;
-	lut8bit[0] = 12;
-
-	int x = pTile->GetIndex() % m_width;
-	int y = pTile->GetIndex() / m_width;
-	int i = x + y * m_width;
-	switch (pItemInfo->tileStorage)
+	TileLock& lock = m_locks[lockIndex];
+	lock.ownerID = ownerID;
+	lock.admins = admins;
+	if (lock.ownerID == -1 && lock.admins.empty() && lock.tiles.empty())
 	{
-	    case STORAGE_SMART_EDGE: 
-	    {
-		    Tile* pTileTopLeft = GetTile(x - 1, y - 1);
-		    Tile* pTileTop = GetTile(x, y - 1);
-		    Tile* pTileTopRight = GetTile(x + 1, y - 1);
-			Tile* pTileLeft = GetTile(x - 1, y);
-			Tile* pTileRight = GetTile(x + 1, y);
-			Tile* pTileBottomLeft = GetTile(x - 1, y + 1);
-			Tile* pTileBottom = GetTile(x, y + 1);
-			Tile* pTileBottomRight = GetTile(x + 1, y + 1);
-
-			bool topLeft = !pTileTopLeft ? true : pTileTopLeft->GetBackground() == pItemInfo->ID ? true : pTileTopLeft->HasFlag(TILEFLAG_GLUE);
-			bool top = !pTileTop ? true : pTileTop->GetBackground() == pItemInfo->ID ? true : pTileTop->HasFlag(TILEFLAG_GLUE);
-			bool topRight = !pTileTopRight ? true : pTileTopRight->GetBackground() == pItemInfo->ID ? true : pTileTopRight->HasFlag(TILEFLAG_GLUE);
-			bool left = !pTileLeft ? true : pTileLeft->GetBackground() == pItemInfo->ID ? true : pTileLeft->HasFlag(TILEFLAG_GLUE);
-			bool right = !pTileRight ? true : pTileRight->GetBackground() == pItemInfo->ID ? true : pTileRight->HasFlag(TILEFLAG_GLUE);
-			bool bottomLeft = !pTileBottomLeft ? true : pTileBottomLeft->GetBackground() == pItemInfo->ID ? true : pTileBottomLeft->HasFlag(TILEFLAG_GLUE);
-			bool bottom = !pTileBottom ? true : pTileBottom->GetBackground() == pItemInfo->ID ? true : pTileBottom->HasFlag(TILEFLAG_GLUE);
-			bool bottomRight = !pTileBottomRight ? true : pTileBottomRight->GetBackground() == pItemInfo->ID ? true : pTileBottomRight->HasFlag(TILEFLAG_GLUE);
+		// nothing left to keep
+		m_locks.erase(lockIndex);
+	}
+}
 
+void WorldTileMap::SetTileParent(const uint16_t& index, const uint16_t& lockIndex)
+{
+	const uint16_t oldLockIndex = GetField(TILEFIELD_PARENT, index);
+	if (oldLockIndex == lockIndex)
+	{
+		return;
+	}
 
-			if (!left || !top)
+	if (oldLockIndex != 0)
+	{
+		auto it = m_locks.find(oldLockIndex);
+		if (it != m_locks.end())
+		{
+			std::vector<uint16_t>& tiles = it->second.tiles;
+			auto tileIt = std::lower_bound(tiles.begin(), tiles.end(), index);
+			if (tileIt != tiles.end() && *tileIt == index)
 			{
-				topLeft = false;
+				tiles.erase(tileIt);
 			}
+		}
+	}
 
-			if (!left || !bottom)
-			{
-				bottomLeft = false;
-			}
+	if (lockIndex != 0)
+	{
+		std::vector<uint16_t>& tiles = m_locks[lockIndex].tiles;
+		tiles.insert(std::lower_bound(tiles.begin(), tiles.end(), index), index);
+	}
 
-			if (!right || !top)
-			{
-				topRight = false;
-			}
+	GetWritableField(TILEFIELD_PARENT, index) = lockIndex;
+}
 
-			if (!right || !bottom)
-			{
-				bottomRight = false;
-			}
+void WorldTileMap::MarkTileDirty(Tile pTile, const bool& bBroadcast)
+{
+	if (pTile == NULL || pTile->GetTileMap() != this)
+	{
+		// tile doesn't belong to this tile map
+		return;
+	}
 
-			int bit = 1 * topLeft + 2 * top + 4 * topRight + 8 * left + 16 * right + 32 * bottomLeft + 64 * bottom + 128 * bottomRight;
+	MarkTileDirty((int)pTile->GetIndex(), bBroadcast);
+}
 
-			textureOffsetX = lut8bit[bit] % 8;
-			textureOffsetY = lut8bit[bit] / 8;
-			break;
-		}
+void WorldTileMap::MarkTileDirty(const int& index, const bool& bBroadcast)
+{
+	if (index < 0 || index >= GetTileCount())
+	{
+		// tile index is out of bounds.
+		return;
+	}
 
-		case STORAGE_SMART_OUTER: 
+	const int chunk = GetChunkIndex(index);
+	if (chunk >= m_chunkRevisions.size())
+	{
+		MarkAllDirty();
+		return;
+	}
+
+	UpdateCollision(index);
+	m_chunkRevisions[chunk] = ++m_revision;
+	if (m_bJournalAll == false)
+	{
+		if (m_journalTiles.size() >= GetTileCount())
 		{
-			Tile* pTileTop = GetTile(x, y - 1);
-			Tile* pTileLeft = GetTile(x - 1, y);
-			Tile* pTileRight = GetTile(x + 1, y);
-			Tile* pTileBottom = GetTile(x, y + 1);
-
-			bool top = !pTileTop ? true : pTileTop->GetBackground() == pItemInfo->ID ? true : pTileTop->HasFlag(TILEFLAG_GLUE);
-			bool left = !pTileLeft ? true : pTileLeft->GetBackground() == pItemInfo->ID ? true : pTileLeft->HasFlag(TILEFLAG_GLUE);
-			bool right = !pTileRight ? true : pTileRight->GetBackground() == pItemInfo->ID ? true : pTileRight->HasFlag(TILEFLAG_GLUE);
-			bool bottom = !pTileBottom ? true : pTileBottom->GetBackground() == pItemInfo->ID ? true : pTileBottom->HasFlag(TILEFLAG_GLUE);
-
-			int bit = 1 * top + 2 * left + 4 * right + 8 * bottom;
-			int b = lut4bit[bit];
-			textureOffsetX = b % 8;
-			textureOffsetY = b / 8;
+			// more changes than tiles, the world journal wouldn't be any cheaper than a checkpoint
+			m_journalTiles.clear();
+			m_bJournalAll = true;
+		}
+		else
+		{
+			m_journalTiles.push_back(index);
+		}
+	}
 
-			if ((pItemInfo->ID == ITEM_ID_CAVE_DIRT || pItemInfo->ID == ITEM_ID_DARK_CAVE_BACKGROUND) && pTile->HasFlag(TILEFLAG_ENABLED))
-			{
-				textureOffsetY += 2;
-			}
+	if (bBroadcast == false || m_bAllChanged)
+	{
+		// clients don't need this tile or get the whole map anyway
+		return;
+	}
 
-			break;
-		}
+	if (m_changedTiles.size() >= GetTileCount())
+	{
+		// more queued changes than tiles, cheaper to send everything again
+		m_changedTiles.clear();
+		m_bAllChanged = true;
+		return;
+	}
 
-		case STORAGE_SMART_EDGE_VERT: 
-		{
-			Tile* pTileTop = GetTile(x, y - 1);
-			Tile* pTileBottom = GetTile(x, y + 1);
+	m_changedTiles.push_back(index);
+}
 
-			bool top = !pTileTop ? true : pTileTop->GetBackground() == pItemInfo->ID ? true : pTileTop->HasFlag(TILEFLAG_GLUE);
-			bool bottom = !pTileBottom ? true : pTileBottom->GetBackground() == pItemInfo->ID ? true : pTileBottom->HasFlag(TILEFLAG_GLUE);
+int WorldTileMap::GetChunkIndex(const int& index) const
+{
+	const int chunksPerRow = (m_width + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+	return (index % m_width) / WORLD_CHUNK_SIZE + (index / m_width) / WORLD_CHUNK_SIZE * chunksPerRow;
+}
 
-			if (!top && !bottom)
-			{
-				textureOffsetX = 3;
-			}
+void WorldTileMap::MarkAllDirty()
+{
+	const int chunksPerRow = (m_width + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+	const int chunksPerColumn = (m_height + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+
+	UpdateAllCollisions();
+	m_revision++;
+	m_chunkRevisions.assign(chunksPerRow * chunksPerColumn, m_revision);
+	m_changedTiles.clear();
+	m_bAllChanged = true;
+	m_journalTiles.clear();
+	m_bJournalAll = true;
+}
 
-			else if (!bottom && top)
-			{
-				textureOffsetX = 0;
-			}
+void WorldTileMap::UpdateCollision(const int& index)
+{
+	// doors, gateways & the like are only solid for some players, they don't block anybody here
+	ItemInfo * pItemInfo = GetItemInfoManager()->GetItemByID(GetField(TILEFIELD_FOREGROUND, index));
+	const uint64_t bit = 1ULL << (index & 63);
+	if (pItemInfo != NULL && pItemInfo->tileCollision == TILE_COLLISION_SOLID)
+	{
+		m_solidBits[index >> 6] |= bit;
+	}
+	else
+	{
+		m_solidBits[index >> 6] &= ~bit;
+	}
+}
 
-			else if (bottom && !top)
-			{
-				textureOffsetX = 2;
-			}
+void WorldTileMap::UpdateAllCollisions()
+{
+	m_solidBits.assign((GetTileCount() + 63) / 64, 0);
+	for (int i = 0; i < GetTileCount(); i++)
+	{
+		UpdateCollision(i);
+	}
+}
 
-			else if (top && bottom)
+bool WorldTileMap::IsSolid(const int& x, const int& y) const
+{
+	if (x < 0 || x >= m_width || y < 0 || y >= m_height)
+	{
+		// the border of the map
+		return true;
+	}
+
+	const int index = x + y * m_width;
+	return (m_solidBits[index >> 6] >> (index & 63)) & 1;
+}
+
+bool WorldTileMap::IsHitboxBlocked(const float& x, const float& y) const
+{
+	const int fromX = (int)std::floor((x + WORLD_PLAYER_HITBOX_X) / 32.f);
+	const int fromY = (int)std::floor((y + WORLD_PLAYER_HITBOX_Y) / 32.f);
+	const int toX = (int)std::floor((x + WORLD_PLAYER_HITBOX_X + WORLD_PLAYER_HITBOX_W) / 32.f);
+	const int toY = (int)std::floor((y + WORLD_PLAYER_HITBOX_Y + WORLD_PLAYER_HITBOX_H) / 32.f);
+	for (int tileY = fromY; tileY <= toY; tileY++)
+	{
+		for (int tileX = fromX; tileX <= toX; tileX++)
+		{
+			if (IsSolid(tileX, tileY))
 			{
-				textureOffsetX = 1;
+				return true;
 			}
-
-			break;
 		}
+	}
 
-		case STORAGE_SMART_EDGE_HORIZ: 
-		{
-			Tile* pTileLeft = GetTile(x - 1, y);
-			Tile* pTileRight = GetTile(x + 1, y);
+	return false;
+}
 
-			bool left = !pTileLeft ? true : pTileLeft->GetBackground() == pItemInfo->ID ? true : pTileLeft->HasFlag(TILEFLAG_GLUE);
-			bool right = !pTileRight ? true : pTileRight->GetBackground() == pItemInfo->ID ? true : pTileRight->HasFlag(TILEFLAG_GLUE);
+bool WorldTileMap::IsReachable(const CL_Vec2i& from, const CL_Vec2i& to, const int& maxSteps)
+{
+	if (std::abs(to.X - from.X) + std::abs(to.Y - from.Y) > maxSteps || IsSolid(to.X, to.Y))
+	{
+		// too far for any path or the goal is inside a wall
+		return false;
+	}
 
-			if (!left && !right)
-			{
-				textureOffsetX = 3;
-			}
+	// A* over a window of maxSteps tiles around the start, nothing outside of it can be reached anyway. Open tiles are keyed
+	// by f << 16 | their index in the window, the lowest f pops first
+	const int size = maxSteps * 2 + 1;
+	m_pathSteps.assign(size * size, 0xFF);
+	auto heuristic = [&](const int& x, const int& y) { return std::abs(to.X - x) + std::abs(to.Y - y); };
+
+	std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> open;
+	const int start = maxSteps + maxSteps * size;
+	m_pathSteps[start] = 0;
+	open.push((uint32_t)heuristic(from.X, from.Y) << 16 | start);
+	while (!open.empty())
+	{
+		const int current = open.top() & 0xFFFF;
+		open.pop();
 
-			else if (!left && right)
-			{
-				textureOffsetX = GetTile(i)->HasFlag(TILEFLAG_FLIPPED) ? 2 : 0;
-			}
+		const int x = from.X + current % size - maxSteps;
+		const int y = from.Y + current / size - maxSteps;
+		if (x == to.X && y == to.Y)
+		{
+			return true;
+		}
 
-			else if (left && !right)
+		const int steps = m_pathSteps[current] + 1;
+		if (steps > maxSteps)
+		{
+			continue;
+		}
+
+		for (int i = 0; i < 4; i++)
+		{
+			// the left, right, top & bottom neighbours, players can't squeeze between two diagonal tiles
+			const int neighbourX = x + (i == 0 ? -1 : i == 1 ? 1 : 0);
+			const int neighbourY = y + (i == 2 ? -1 : i == 3 ? 1 : 0);
+			const int windowX = neighbourX - from.X + maxSteps;
+			const int windowY = neighbourY - from.Y + maxSteps;
+			if (windowX < 0 || windowX >= size || windowY < 0 || windowY >= size || IsSolid(neighbourX, neighbourY))
 			{
-				textureOffsetX = GetTile(i)->HasFlag(TILEFLAG_FLIPPED) ? 0 : 2;
+				continue;
 			}
 
-			else if (left && right)
+			const int neighbour = windowX + windowY * size;
+			if (m_pathSteps[neighbour] <= steps)
 			{
-				textureOffsetX = 1;
+				// got there the same way or shorter already
+				continue;
 			}
 
-			break;
+			m_pathSteps[neighbour] = (uint8_t)steps;
+			open.push((uint32_t)(steps + heuristic(neighbourX, neighbourY)) << 16 | neighbour);
 		}
+	}
 
-		case STORAGE_SMART_CLING: 
-		{
-			Tile* pTileTop = GetTile(x, y - 1);
-			Tile* pTileLeft = GetTile(x - 1, y);
-			Tile* pTileRight = GetTile(x + 1, y);
-			Tile* pTileBottom = GetTile(x, y + 1);
+	return false;
+}
 
-			bool top = !pTileTop ? true : pTileTop->GetBackground() == 0 ? false : pTileTop->GetBackground() != pItemInfo->ID ? true : pTileTop->HasFlag(TILEFLAG_GLUE);
-			bool left = !pTileLeft ? true : pTileLeft->GetBackground() == 0 ? false : pTileLeft->GetBackground() != pItemInfo->ID ? true : pTileLeft->HasFlag(TILEFLAG_GLUE);
-			bool right = !pTileRight ? true : pTileRight->GetBackground() == 0 ? false : pTileRight->GetBackground() != pItemInfo->ID ? true : pTileRight->HasFlag(TILEFLAG_GLUE);
-			bool bottom = !pTileBottom ? true : pTileBottom->GetBackground() == 0 ? false : pTileBottom->GetBackground() != pItemInfo->ID ? true : pTileBottom->HasFlag(TILEFLAG_GLUE);
+bool WorldTileMap::IsMoveValid(const CL_Vec2f& from, const CL_Vec2f& to)
+{
+	if (IsHitboxBlocked(from.X, from.Y))
+	{
+		// stuck in a tile already(one got placed on the player, or the spawn is inside one), nothing to go by
+		return true;
+	}
 
-			textureOffsetX = 4;
-			if (left && !top && !bottom)
-			{
-				textureOffsetX = 0;
-			}
+	if (IsHitboxBlocked(to.X, to.Y))
+	{
+		// ended up inside a wall
+		return false;
+	}
 
-			if (top)
-			{
-				textureOffsetX = 1;
-			}
+	// sweeping the hitbox along the straight line first, almost every move is one
+	const float distance = std::sqrt((to.X - from.X) * (to.X - from.X) + (to.Y - from.Y) * (to.Y - from.Y));
+	const int steps = (int)std::ceil(distance / WORLD_MOVE_SWEEP_STEP);
+	bool bBlocked = false;
+	for (int i = 1; i < steps && !bBlocked; i++)
+	{
+		const float t = (float)i / steps;
+		bBlocked = IsHitboxBlocked(from.X + (to.X - from.X) * t, from.Y + (to.Y - from.Y) * t);
+	}
 
-			if (right && !top && !bottom)
-			{
-				textureOffsetX = 2;
-			}
+	if (!bBlocked)
+	{
+		return true;
+	}
 
-			if (bottom)
-			{
-				textureOffsetX = 3;
-			}
+	// state packets are apart enough for a player to walk around a corner, a short path around the walls is fine too
+	const CL_Vec2i fromTile = CL_Vec2i((int)((from.X + 16.f) / 32.f), (int)((from.Y + 16.f) / 32.f));
+	const CL_Vec2i toTile = CL_Vec2i((int)((to.X + 16.f) / 32.f), (int)((to.Y + 16.f) / 32.f));
+	return IsReachable(fromTile, toTile, WORLD_MOVE_MAX_PATH);
+}
 
-			break;
+// texture of every STORAGE_SMART_EDGE shape, by its neighbour mask once the corners without both of their sides are dropped
+static constexpr std::array<uint8_t, 256> s_smartEdgeLut = []()
+{
+	std::array<uint8_t, 256> lut = {};
+	lut[0] = 12;
+	lut[2] = 11;
+	lut[8] = 30;
+	lut[10] = 44;
+	lut[11] = 8;
+	lut[16] = 29;
+	lut[18] = 43;
+	lut[22] = 7;
+	lut[24] = 28;
+	lut[26] = 42;
+	lut[27] = 41;
+	lut[30] = 40;
+	lut[31] = 2;
+	lut[64] = 10;
+	lut[66] = 9;
+	lut[72] = 46;
+	lut[74] = 36;
+	lut[75] = 35;
+	lut[80] = 45;
+	lut[82] = 33;
+	lut[86] = 32;
+	lut[88] = 39;
+	lut[90] = 27;
+	lut[91] = 23;
+	lut[94] = 24;
+	lut[95] = 18;
+	lut[104] = 6;
+	lut[106] = 34;
+	lut[107] = 4;
+	lut[120] = 38;
+	lut[122] = 25;
+	lut[123] = 20;
+	lut[126] = 21;
+	lut[127] = 16;
+	lut[208] = 5;
+	lut[210] = 31;
+	lut[214] = 3;
+	lut[216] = 37;
+	lut[218] = 26;
+	lut[219] = 22;
+	lut[222] = 19;
+	lut[223] = 15;
+	lut[248] = 1;
+	lut[250] = 17;
+	lut[251] = 14;
+	lut[254] = 13;
+	return lut;
+}();
+
+// texture of every STORAGE_SMART_OUTER shape, by top | left << 1 | right << 2 | bottom << 3
+static constexpr uint8_t s_smartOuterLut[16] = { 12, 11, 15, 8, 14, 7, 13, 2, 10, 9, 6, 4, 5, 3, 1, 0 };
+
+// neighbour offsets in the order of their mask bits
+static constexpr int s_neighbourX[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+static constexpr int s_neighbourY[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+
+uint8_t WorldTileMap::GetNeighbourMask(const int& field, const int& index, const uint16_t& itemID)
+{
+	const int x = index % m_width;
+	const int y = index / m_width;
+	uint8_t mask = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		const int neighbourX = x + s_neighbourX[i];
+		const int neighbourY = y + s_neighbourY[i];
+		if (neighbourX < 0 || neighbourX >= m_width || neighbourY < 0 || neighbourY >= m_height)
+		{
+			// the border connects to everything
+			mask |= 1 << i;
+			continue;
 		}
 
-		case STORAGE_SMART_CLING2: 
+		const int neighbour = neighbourX + neighbourY * m_width;
+		if (GetField(field, neighbour) == itemID || (GetField(TILEFIELD_FLAGS, neighbour) & TILEFLAG_GLUE))
 		{
-			Tile* pTileTop = GetTile(x, y - 1);
-			Tile* pTileLeft = GetTile(x - 1, y);
-			Tile* pTileRight = GetTile(x + 1, y);
-			Tile* pTileBottom = GetTile(x, y + 1);
+			mask |= 1 << i;
+		}
+	}
 
-			bool top = !pTileTop ? true : pTileTop->GetBackground() == 0 ? false : true;
-			bool left = !pTileLeft ? true : pTileLeft->GetBackground() == 0 ? false : true;
-			bool right = !pTileRight ? true : pTileRight->GetBackground() == 0 ? false : true;
-			bool bottom = !pTileBottom ? true : pTileBottom->GetBackground() == 0 ? false : true;
+	return mask;
+}
 
-			textureOffsetX = 3;
-			if (bottom)
+void WorldTileMap::GetNeighbourMasks(const bool& bForeground, std::vector<uint8_t>& masks)
+{
+	const int field = bForeground ? TILEFIELD_FOREGROUND : TILEFIELD_BACKGROUND;
+	const int width = m_width;
+	const int height = m_height;
+	masks.assign(GetTileCount(), 0);
+
+	// one direction at a time over whole rows, the inner loops are branchless over contiguous rows so they get vectorized
+	for (int i = 0; i < 8; i++)
+	{
+		const int dx = s_neighbourX[i];
+		const int dy = s_neighbourY[i];
+		const uint8_t bit = (uint8_t)(1 << i);
+		const int fromX = dx < 0 ? 1 : 0;
+		const int toX = dx > 0 ? width - 1 : width;
+		for (int y = 0; y < height; y++)
+		{
+			uint8_t * pMasks = masks.data() + y * width;
+			if (y + dy < 0 || y + dy >= height)
 			{
-				textureOffsetX = 3;
+				// the border connects to everything
+				for (int x = 0; x < width; x++)
+				{
+					pMasks[x] |= bit;
+				}
+
+				continue;
 			}
 
-			if (top && !bottom)
+			const uint16_t * pRow = GetRow(field, y);
+			const uint16_t * pNeighbours = GetRow(field, y + dy);
+			const uint16_t * pNeighbourFlags = GetRow(TILEFIELD_FLAGS, y + dy);
+			for (int x = fromX; x < toX; x++)
 			{
-				textureOffsetX = 1;
+				const bool bConnected = (pNeighbours[x + dx] == pRow[x]) | ((pNeighbourFlags[x + dx] & TILEFLAG_GLUE) != 0);
+				pMasks[x] |= (uint8_t)(bConnected * bit);
 			}
 
-			if (left && !top && !bottom)
+			if (fromX != 0)
 			{
-				textureOffsetX = 0;
+				pMasks[0] |= bit;
 			}
 
-			if (right && !top && !bottom)
+			if (toX != width)
 			{
-				textureOffsetX = 2;
+				pMasks[width - 1] |= bit;
 			}
-
-			break;
 		}
+	}
+}
 
-		case STORAGE_RANDOM: 
-		{
-			textureOffsetX = Randomizer::Get(0, 3);
-			break;
-		}
+void WorldTileMap::ChooseVisualBackground(Tile pTile, ItemInfo* pItemInfo, int& textureOffsetX, int& textureOffsetY)
+{
+	if (pTile == NULL || pItemInfo == NULL)
+	{
+		// null pointers, cant procceed.
+		return;
+	}
+
+	ChooseVisual(TILEFIELD_BACKGROUND, pTile, pItemInfo, GetNeighbourMask(TILEFIELD_BACKGROUND, pTile->GetIndex(), pItemInfo->ID), textureOffsetX, textureOffsetY);
+}
+
+void WorldTileMap::ChooseVisualBackground(Tile pTile, ItemInfo* pItemInfo, const uint8_t& neighbourMask, int& textureOffsetX, int& textureOffsetY)
+{
+	if (pTile == NULL || pItemInfo == NULL)
+	{
+		// null pointers, cant procceed.
+		return;
+	}
+
+	ChooseVisual(TILEFIELD_BACKGROUND, pTile, pItemInfo, neighbourMask, textureOffsetX, textureOffsetY);
+}
+
+void WorldTileMap::ChooseVisualForeground(Tile pTile, ItemInfo* pItemInfo, int& textureOffsetX, int& textureOffsetY)
+{
+	if (pTile == NULL || pItemInfo == NULL)
+	{
+		// null pointers, cant procceed.
+		return;
 	}
+
+	ChooseVisual(TILEFIELD_FOREGROUND, pTile, pItemInfo, GetNeighbourMask(TILEFIELD_FOREGROUND, pTile->GetIndex(), pItemInfo->ID), textureOffsetX, textureOffsetY);
 }
 
-void WorldTileMap::ChooseVisualForeground(Tile* pTile, ItemInfo* pItemInfo, int& textureOffsetX, int& textureOffsetY)
+void WorldTileMap::ChooseVisualForeground(Tile pTile, ItemInfo* pItemInfo, const uint8_t& neighbourMask, int& textureOffsetX, int& textureOffsetY)
 {
 	if (pTile == NULL || pItemInfo == NULL)
 	{
@@ -415,123 +910,51 @@ void WorldTileMap::ChooseVisualForeground(Tile* pTile, ItemInfo* pItemInfo, int&
 		return;
 	}
 
-	// some hardcoded type shi
-	int lut4bit[16] = { 12, 11, 15, 8, 14, 7, 13, 2, 10, 9, 6, 4, 5, 3, 1, 0 };
-	int lut8bit[255];
-	lut8bit[2] = 11;
-	lut8bit[8] = 30;
-	lut8bit[10] = 44;
-	lut8bit[11] = 8;
-	lut8bit[16] = 29;
-	lut8bit[18] = 43;
-	lut8bit[22] = 7;
-	lut8bit[24] = 28;
-	lut8bit[26] = 42;
-	lut8bit[27] = 41;
-	lut8bit[30] = 40;
-	lut8bit[31] = 2;
-	lut8bit[64] = 10;
-	lut8bit[66] = 9;
-	lut8bit[72] = 46;
-	lut8bit[74] = 36;
-	lut8bit[75] = 35;
-	lut8bit[80] = 45;
-	lut8bit[82] = 33;
-	lut8bit[86] = 32;
-	lut8bit[88] = 39;
-	lut8bit[90] = 27;
-	lut8bit[91] = 23;
-	lut8bit[94] = 24;
-	lut8bit[95] = 18;
-	lut8bit[104] = 6;
-	lut8bit[106] = 34;
-	lut8bit[107] = 4;
-	lut8bit[120] = 38;
-	lut8bit[122] = 25;
-	lut8bit[123] = 20;
-	lut8bit[126] = 21;
-	lut8bit[127] = 16;
-	lut8bit[208] = 5;
-	lut8bit[210] = 31;
-	lut8bit[214] = 3;
-	lut8bit[216] = 37;
-	lut8bit[218] = 26;
-	lut8bit[219] = 22;
-	lut8bit[222] = 19;
-	lut8bit[223] = 15;
-	lut8bit[248] = 1;
-	lut8bit[250] = 17;
-	lut8bit[251] = 14;
-	lut8bit[254] = 13;
-	lut8bit[0] = 12;
-
-	int x = pTile->GetIndex() % m_width;
-	int y = pTile->GetIndex() / m_width;
-	int i = x + y * m_width;
+	ChooseVisual(TILEFIELD_FOREGROUND, pTile, pItemInfo, neighbourMask, textureOffsetX, textureOffsetY);
+}
+
+void WorldTileMap::ChooseVisual(const int& field, Tile pTile, ItemInfo* pItemInfo, const uint8_t& neighbourMask, int& textureOffsetX, int& textureOffsetY)
+{
+	const int x = pTile->GetIndex() % m_width;
+	const int y = pTile->GetIndex() / m_width;
+	const bool top = neighbourMask & NEIGHBOUR_TOP;
+	const bool left = neighbourMask & NEIGHBOUR_LEFT;
+	const bool right = neighbourMask & NEIGHBOUR_RIGHT;
+	const bool bottom = neighbourMask & NEIGHBOUR_BOTTOM;
 	switch (pItemInfo->tileStorage)
 	{
 	    case STORAGE_SMART_EDGE: 
 	    {
-		    Tile* pTileTopLeft = GetTile(x - 1, y - 1);
-		    Tile* pTileTop = GetTile(x, y - 1);
-		    Tile* pTileTopRight = GetTile(x + 1, y - 1);
-			Tile* pTileLeft = GetTile(x - 1, y);
-			Tile* pTileRight = GetTile(x + 1, y);
-			Tile* pTileBottomLeft = GetTile(x - 1, y + 1);
-			Tile* pTileBottom = GetTile(x, y + 1);
-			Tile* pTileBottomRight = GetTile(x + 1, y + 1);
-
-			bool topLeft = !pTileTopLeft ? true : pTileTopLeft->GetForeground() == pItemInfo->ID ? true : pTileTopLeft->HasFlag(TILEFLAG_GLUE);
-			bool top = !pTileTop ? true : pTileTop->GetForeground() == pItemInfo->ID ? true : pTileTop->HasFlag(TILEFLAG_GLUE);
-			bool topRight = !pTileTopRight ? true : pTileTopRight->GetForeground() == pItemInfo->ID ? true : pTileTopRight->HasFlag(TILEFLAG_GLUE);
-			bool left = !pTileLeft ? true : pTileLeft->GetForeground() == pItemInfo->ID ? true : pTileLeft->HasFlag(TILEFLAG_GLUE);
-			bool right = !pTileRight ? true : pTileRight->GetForeground() == pItemInfo->ID ? true : pTileRight->HasFlag(TILEFLAG_GLUE);
-			bool bottomLeft = !pTileBottomLeft ? true : pTileBottomLeft->GetForeground() == pItemInfo->ID ? true : pTileBottomLeft->HasFlag(TILEFLAG_GLUE);
-			bool bottom = !pTileBottom ? true : pTileBottom->GetForeground() == pItemInfo->ID ? true : pTileBottom->HasFlag(TILEFLAG_GLUE);
-			bool bottomRight = !pTileBottomRight ? true : pTileBottomRight->GetForeground() == pItemInfo->ID ? true : pTileBottomRight->HasFlag(TILEFLAG_GLUE);
-
-
+			// corners only count when both of their sides connect
+			uint8_t mask = neighbourMask;
 			if (!left || !top)
 			{
-				topLeft = false;
+				mask &= ~NEIGHBOUR_TOP_LEFT;
 			}
 
 			if (!left || !bottom)
 			{
-				bottomLeft = false;
+				mask &= ~NEIGHBOUR_BOTTOM_LEFT;
 			}
 
 			if (!right || !top)
 			{
-				topRight = false;
+				mask &= ~NEIGHBOUR_TOP_RIGHT;
 			}
 
 			if (!right || !bottom)
 			{
-				bottomRight = false;
+				mask &= ~NEIGHBOUR_BOTTOM_RIGHT;
 			}
 
-			int bit = 1 * topLeft + 2 * top + 4 * topRight + 8 * left + 16 * right + 32 * bottomLeft + 64 * bottom + 128 * bottomRight;
-
-			textureOffsetX = lut8bit[bit] % 8;
-			textureOffsetY = lut8bit[bit] / 8;
+			textureOffsetX = s_smartEdgeLut[mask] % 8;
+			textureOffsetY = s_smartEdgeLut[mask] / 8;
 			break;
 		}
 
 		case STORAGE_SMART_OUTER: 
 		{
-			Tile* pTileTop = GetTile(x, y - 1);
-			Tile* pTileLeft = GetTile(x - 1, y);
-			Tile* pTileRight = GetTile(x + 1, y);
-			Tile* pTileBottom = GetTile(x, y + 1);
-
-			bool top = !pTileTop ? true : pTileTop->GetForeground() == pItemInfo->ID ? true : pTileTop->HasFlag(TILEFLAG_GLUE);
-			bool left = !pTileLeft ? true : pTileLeft->GetForeground() == pItemInfo->ID ? true : pTileLeft->HasFlag(TILEFLAG_GLUE);
-			bool right = !pTileRight ? true : pTileRight->GetForeground() == pItemInfo->ID ? true : pTileRight->HasFlag(TILEFLAG_GLUE);
-			bool bottom = !pTileBottom ? true : pTileBottom->GetForeground() == pItemInfo->ID ? true : pTileBottom->HasFlag(TILEFLAG_GLUE);
-
-			int bit = 1 * top + 2 * left + 4 * right + 8 * bottom;
-			int b = lut4bit[bit];
+			int b = s_smartOuterLut[1 * top + 2 * left + 4 * right + 8 * bottom];
 			textureOffsetX = b % 8;
 			textureOffsetY = b / 8;
 
@@ -545,12 +968,6 @@ void WorldTileMap::ChooseVisualForeground(Tile* pTile, ItemInfo* pItemInfo, int&
 
 		case STORAGE_SMART_EDGE_VERT: 
 		{
-			Tile* pTileTop = GetTile(x, y - 1);
-			Tile* pTileBottom = GetTile(x, y + 1);
-
-			bool top = !pTileTop ? true : pTileTop->GetForeground() == pItemInfo->ID ? true : pTileTop->HasFlag(TILEFLAG_GLUE);
-			bool bottom = !pTileBottom ? true : pTileBottom->GetForeground() == pItemInfo->ID ? true : pTileBottom->HasFlag(TILEFLAG_GLUE);
-
 			if (!top && !bottom)
 			{
 				textureOffsetX = 3;
@@ -576,12 +993,6 @@ void WorldTileMap::ChooseVisualForeground(Tile* pTile, ItemInfo* pItemInfo, int&
 
 		case STORAGE_SMART_EDGE_HORIZ: 
 		{
-			Tile* pTileLeft = GetTile(x - 1, y);
-			Tile* pTileRight = GetTile(x + 1, y);
-
-			bool left = !pTileLeft ? true : pTileLeft->GetForeground() == pItemInfo->ID ? true : pTileLeft->HasFlag(TILEFLAG_GLUE);
-			bool right = !pTileRight ? true : pTileRight->GetForeground() == pItemInfo->ID ? true : pTileRight->HasFlag(TILEFLAG_GLUE);
-
 			if (!left && !right)
 			{
 				textureOffsetX = 3;
@@ -589,12 +1000,12 @@ void WorldTileMap::ChooseVisualForeground(Tile* pTile, ItemInfo* pItemInfo, int&
 
 			else if (!left && right)
 			{
-				textureOffsetX = GetTile(i)->HasFlag(TILEFLAG_FLIPPED) ? 2 : 0;
+				textureOffsetX = pTile->HasFlag(TILEFLAG_FLIPPED) ? 2 : 0;
 			}
 
 			else if (left && !right)
 			{
-				textureOffsetX = GetTile(i)->HasFlag(TILEFLAG_FLIPPED) ? 0 : 2;
+				textureOffsetX = pTile->HasFlag(TILEFLAG_FLIPPED) ? 0 : 2;
 			}
 
 			else if (left && right)
@@ -607,33 +1018,41 @@ void WorldTileMap::ChooseVisualForeground(Tile* pTile, ItemInfo* pItemInfo, int&
 
 		case STORAGE_SMART_CLING: 
 		{
-			Tile* pTileTop = GetTile(x, y - 1);
-			Tile* pTileLeft = GetTile(x - 1, y);
-			Tile* pTileRight = GetTile(x + 1, y);
-			Tile* pTileBottom = GetTile(x, y + 1);
+			// clings to anything that isn't empty or the same item, unless it's glued
+			auto clings = [&](const int& neighbourX, const int& neighbourY)
+			{
+				if (neighbourX < 0 || neighbourX >= m_width || neighbourY < 0 || neighbourY >= m_height)
+				{
+					return true;
+				}
 
-			bool top = !pTileTop ? true : pTileTop->GetForeground() == 0 ? false : pTileTop->GetForeground() != pItemInfo->ID ? true : pTileTop->HasFlag(TILEFLAG_GLUE);
-			bool left = !pTileLeft ? true : pTileLeft->GetForeground() == 0 ? false : pTileLeft->GetForeground() != pItemInfo->ID ? true : pTileLeft->HasFlag(TILEFLAG_GLUE);
-			bool right = !pTileRight ? true : pTileRight->GetForeground() == 0 ? false : pTileRight->GetForeground() != pItemInfo->ID ? true : pTileRight->HasFlag(TILEFLAG_GLUE);
-			bool bottom = !pTileBottom ? true : pTileBottom->GetForeground() == 0 ? false : pTileBottom->GetForeground() != pItemInfo->ID ? true : pTileBottom->HasFlag(TILEFLAG_GLUE);
+				const int neighbour = neighbourX + neighbourY * m_width;
+				const uint16_t neighbourID = GetField(field, neighbour);
+				return neighbourID == 0 ? false : neighbourID != pItemInfo->ID ? true : (GetField(TILEFIELD_FLAGS, neighbour) & TILEFLAG_GLUE) != 0;
+			};
+
+			const bool clingTop = clings(x, y - 1);
+			const bool clingLeft = clings(x - 1, y);
+			const bool clingRight = clings(x + 1, y);
+			const bool clingBottom = clings(x, y + 1);
 
 			textureOffsetX = 4;
-			if (left && !top && !bottom)
+			if (clingLeft && !clingTop && !clingBottom)
 			{
 				textureOffsetX = 0;
 			}
 
-			if (top)
+			if (clingTop)
 			{
 				textureOffsetX = 1;
 			}
 
-			if (right && !top && !bottom)
+			if (clingRight && !clingTop && !clingBottom)
 			{
 				textureOffsetX = 2;
 			}
 
-			if (bottom)
+			if (clingBottom)
 			{
 				textureOffsetX = 3;
 			}
@@ -643,33 +1062,39 @@ void WorldTileMap::ChooseVisualForeground(Tile* pTile, ItemInfo* pItemInfo, int&
 
 		case STORAGE_SMART_CLING2: 
 		{
-			Tile* pTileTop = GetTile(x, y - 1);
-			Tile* pTileLeft = GetTile(x - 1, y);
-			Tile* pTileRight = GetTile(x + 1, y);
-			Tile* pTileBottom = GetTile(x, y + 1);
+			// clings to anything that isn't empty
+			auto clings = [&](const int& neighbourX, const int& neighbourY)
+			{
+				if (neighbourX < 0 || neighbourX >= m_width || neighbourY < 0 || neighbourY >= m_height)
+				{
+					return true;
+				}
 
-			bool top = !pTileTop ? true : pTileTop->GetForeground() == 0 ? false : true;
-			bool left = !pTileLeft ? true : pTileLeft->GetForeground() == 0 ? false : true;
-			bool right = !pTileRight ? true : pTileRight->GetForeground() == 0 ? false : true;
-			bool bottom = !pTileBottom ? true : pTileBottom->GetForeground() == 0 ? false : true;
+				return GetField(field, neighbourX + neighbourY * m_width) != 0;
+			};
+
+			const bool clingTop = clings(x, y - 1);
+			const bool clingLeft = clings(x - 1, y);
+			const bool clingRight = clings(x + 1, y);
+			const bool clingBottom = clings(x, y + 1);
 
 			textureOffsetX = 3;
-			if (bottom)
+			if (clingBottom)
 			{
 				textureOffsetX = 3;
 			}
 
-			if (top && !bottom)
+			if (clingTop && !clingBottom)
 			{
 				textureOffsetX = 1;
 			}
 
-			if (left && !top && !bottom)
+			if (clingLeft && !clingTop && !clingBottom)
 			{
 				textureOffsetX = 0;
 			}
 
-			if (right && !top && !bottom)
+			if (clingRight && !clingTop && !clingBottom)
 			{
 				textureOffsetX = 2;
 			}
@@ -685,241 +1110,101 @@ void WorldTileMap::ChooseVisualForeground(Tile* pTile, ItemInfo* pItemInfo, int&
 	}
 }
 
-void WorldTileMap::GenerateTerrain(const uint8_t& terraformType, uint8_t width, uint8_t height)
+void WorldTileMap::GenerateTerrain(const uint8_t& terraformType, uint8_t width, uint8_t height, const uint64_t& seed)
 {
-	// fixing size
+	// fixing size, uint8_t already keeps them at 255 at most
 	if (width < 30)
 	{
 		width = 30;
 	}
 
-	if (width > 255)
-	{
-		// DO NOT ALLOW MORE THAN 255
-		width = 255;
-	}
-
 	if (height < 30)
 	{
 		height = 30;
 	}
 
-	if (height > 255)
-	{
-		// DO NOT ALLOW MORE THAN 255
-		height = 255;
-	}
+	Resize(width, height);
+	FastRandom rng(seed != 0 ? seed : ((uint64_t)std::random_device()() << 32 | std::random_device()()));
 
-	m_width = width;
-	m_height = height;
-	m_tiles.clear();
-	m_tiles.resize(width * height);
-	switch (terraformType)
+	// the layers are filled a row at a time straight into the pages, only the main door goes through the tile for its extra data
+	auto placeMainDoor = [&](const int& index, const uint16_t& background)
 	{
-		case TERRATYPE_THEMONUCLEAR:
-		{
-			const uint16_t bedrockLayer = (width * height) - (width * 6);
-			const uint16_t doorX = Randomizer::Get(2, width - 2);
-
-			// generating terrain(supports resizing)
-			for (uint8_t x = 0; x < width; ++x)
-			{
-				for (uint8_t y = 0; y < height; ++y)
-				{
-					int index = x + y * width;
-					Tile tile = Tile();
-					tile.SetIndex(index);
-
-					if (index == bedrockLayer - doorX)
-					{
-						// main door
-						tile.SetForeground(ITEM_ID_MAIN_DOOR);
-						tile.SetBackground(ITEM_ID_MONOCHROMATIC_CAVE_BACKGROUND);
-						m_spawnPoint = CL_Vec2f((float)(index % m_width) * 32.f + 5.f, (float)(index / m_width) * 32.f);
-					}
-
-					if (y >= bedrockLayer)
-					{
-						// bedrock
-						tile.SetForeground(ITEM_ID_MONOCHROMATIC_BEDROCK);
-						tile.SetBackground(ITEM_ID_MONOCHROMATIC_CAVE_BACKGROUND);
-					}
+		Tile tile = GetTile((uint16_t)index);
+		tile.SetForeground(ITEM_ID_MAIN_DOOR);
+		tile.SetBackground(background);
+		m_spawnPoint = CL_Vec2f((float)(index % m_width) * 32.f + 5.f, (float)(index / m_width) * 32.f);
+	};
 
-					m_tiles[x + (y * width)] = tile;
-				}
-			}
+	auto generateLayers = [&](const uint16_t& dirt, const uint16_t& rock, const uint16_t& lava, const uint16_t& bedrock, const uint16_t& background)
+	{
+		const int bedrockHeight = height - 6;
+		const int lavaHeight = bedrockHeight - 4;
+		const int dirtHeight = height / 2 - height / 10;
+		const int doorX = rng.Get(2, width - 2);
 
-			break;
-		}
-		case TERRATYPE_MONOCHROME:
+		for (int y = dirtHeight; y < height; y++)
 		{
-			const uint16_t bedrockLayer = (width * height) - (width * 6);
-			const uint16_t bedrockHeight = bedrockLayer / width;
-			const uint16_t lavaLayer = bedrockLayer - (width * 4);
-			const uint16_t lavaHeight = lavaLayer / width;
-			const uint16_t dirtLayer = ((height / 2) * width) - ((height / 10) * width);
-			const uint16_t dirtHeight = dirtLayer / width;
-			uint16_t doorIndex = dirtLayer - (std::rand() % width - 1) + 1;
-			const uint16_t doorX = Randomizer::Get(2, width - 2);
-
-			// fixing door if neccessary
-			if (doorIndex >= dirtLayer)
-			{
-				doorIndex = dirtLayer - 1;
-			}
+			// background from the dirt down, empty above
+			uint16_t * pBackgrounds = GetWritableRow(TILEFIELD_BACKGROUND, y);
+			std::fill(pBackgrounds, pBackgrounds + width, background);
 
-			if (doorIndex < dirtLayer - width)
+			uint16_t * pRow = GetWritableRow(TILEFIELD_FOREGROUND, y);
+			if (y >= bedrockHeight)
 			{
-				doorIndex = dirtLayer - width;
+				std::fill(pRow, pRow + width, bedrock);
+				continue;
 			}
 
-			// generating terrain(supports resizing)
-			int currentHeight = dirtHeight;
-			int originHeight = dirtHeight;
-			for (uint8_t x = 0; x < width; ++x)
+			std::fill(pRow, pRow + width, dirt);
+			for (int x = 1; x < width; x++)
 			{
-				for (uint8_t y = 0; y < height; ++y)
+				if (y >= lavaHeight && rng.Chance(7, 2))
 				{
-					int index = x + y * width;
-
-					Tile tile = Tile();
-
-					if (y == currentHeight - 1)
-					{
-						if (x == doorX)
-						{
-							// main door
-							int i = x + (y * width);
-							tile.SetForeground(ITEM_ID_MAIN_DOOR);
-							tile.SetBackground(ITEM_ID_MONOCHROMATIC_CAVE_BACKGROUND);
-							m_spawnPoint = CL_Vec2f((float)(index % m_width) * 32.f + 5.f, (float)(index / m_width) * 32.f);
-						}
-					}
-
-					if (y >= currentHeight)
-					{
-						tile.SetForeground(ITEM_ID_MONOCHROMATIC_DIRT);
-						tile.SetBackground(ITEM_ID_MONOCHROMATIC_CAVE_BACKGROUND);
-
-						if (y >= currentHeight + 1 && y < bedrockHeight && std::rand() % 80 <= 1 && x > 0 && x < width)
-						{
-							// rock
-							tile.SetForeground(ITEM_ID_OBSIDIAN);
-						}
-
-						if (y >= lavaHeight && y < bedrockHeight && std::rand() % 7 <= 1 && x > 0 && x < width)
-						{
-							// lava
-							tile.SetForeground(ITEM_ID_MONOCHROMATIC_LAVA);
-						}
-
-						if (y >= bedrockHeight)
-						{
-							// bedrock
-							tile.SetForeground(ITEM_ID_MONOCHROMATIC_BEDROCK);
-						}
-
-						if (x == doorX && y == currentHeight)
-						{
-							tile.SetForeground(ITEM_ID_MONOCHROMATIC_BEDROCK);
-							tile.SetBackground(ITEM_ID_MONOCHROMATIC_CAVE_BACKGROUND);
-						}
-					}
-
-					m_tiles[index] = tile;
+					// lava
+					pRow[x] = lava;
+				}
+				else if (y >= dirtHeight + 1 && rng.Chance(80, 2))
+				{
+					// rock
+					pRow[x] = rock;
 				}
 			}
-
-			break;
 		}
-		case TERRATYPE_SUNNY: default:
-		{
-			const uint16_t bedrockLayer = (width * height) - (width * 6);
-			const uint16_t bedrockHeight = bedrockLayer / width;
-			const uint16_t lavaLayer = bedrockLayer - (width * 4);
-			const uint16_t lavaHeight = lavaLayer / width;
-			const uint16_t dirtLayer = ((height / 2) * width) - ((height / 10) * width);
-			const uint16_t dirtHeight = dirtLayer / width;
-			uint16_t doorIndex = dirtLayer - (std::rand() % width - 1) + 1;
-			const uint16_t doorX = Randomizer::Get(2, width - 2);
-
-			// fixing door if neccessary
-			if (doorIndex >= dirtLayer)
-			{
-				doorIndex = dirtLayer - 1;
-			}
-
-			if (doorIndex < dirtLayer - width)
-			{
-				doorIndex = dirtLayer - width;
-			}
-
-			// generating terrain(supports resizing)
-			int currentHeight = dirtHeight;
-			int originHeight = dirtHeight;
-			for (uint8_t x = 0; x < width; ++x)
-			{
-				for (uint8_t y = 0; y < height; ++y)
-				{
-					int index = x + y * width;
-
-					Tile tile = Tile();
-					tile.SetIndex(index);
 
-					if (y == currentHeight - 1)
-					{
-						if (x == doorX)
-						{
-							// main door
-							tile.SetForeground(ITEM_ID_MAIN_DOOR);
-							tile.SetBackground(ITEM_ID_CAVE_BACKGROUND);
-							m_spawnPoint = CL_Vec2f((float)(index % m_width) * 32.f + 5.f, (float)(index / m_width) * 32.f);
-						}
-						else
-						{
-							// add something above the dirt layer except on the main door if you want here
-						}
-					}
+		// the main door stands on bedrock
+		placeMainDoor(doorX + (dirtHeight - 1) * width, background);
+		GetWritableField(TILEFIELD_FOREGROUND, doorX + dirtHeight * width) = bedrock;
+	};
 
-					if (y >= currentHeight)
-					{
-						tile.SetForeground(ITEM_ID_DIRT);
-						tile.SetBackground(ITEM_ID_CAVE_BACKGROUND);
-						if (y >= currentHeight + 1 && y < bedrockHeight && std::rand() % 80 <= 1 && x > 0 && x < width)
-						{
-							// rocks
-							tile.SetForeground(ITEM_ID_ROCK);
-						}
-
-						if (y >= lavaHeight && y < bedrockHeight && std::rand() % 7 <= 1 && x > 0 && x < width)
-						{
-							// lava
-							tile.SetForeground(ITEM_ID_LAVA);
-						}
-
-						if (y >= bedrockHeight)
-						{
-							// bedrock
-							tile.SetForeground(ITEM_ID_BEDROCK);
-						}
-
-						if (x == doorX && y == currentHeight)
-						{
-							tile.SetForeground(ITEM_ID_BEDROCK);
-							tile.SetBackground(ITEM_ID_CAVE_BACKGROUND);
-						}
-					}
+	switch (terraformType)
+	{
+		case TERRATYPE_THEMONUCLEAR:
+		{
+			// nothing but the main door
+			const int bedrockLayer = (width * height) - (width * 6);
+			placeMainDoor(bedrockLayer - rng.Get(2, width - 2), ITEM_ID_MONOCHROMATIC_CAVE_BACKGROUND);
+			break;
+		}
 
-					m_tiles[index] = tile;
-				}
-			}
+		case TERRATYPE_MONOCHROME:
+		{
+			generateLayers(ITEM_ID_MONOCHROMATIC_DIRT, ITEM_ID_OBSIDIAN, ITEM_ID_MONOCHROMATIC_LAVA, ITEM_ID_MONOCHROMATIC_BEDROCK, ITEM_ID_MONOCHROMATIC_CAVE_BACKGROUND);
+			break;
+		}
 
+		case TERRATYPE_SUNNY: default:
+		{
+			generateLayers(ITEM_ID_DIRT, ITEM_ID_ROCK, ITEM_ID_LAVA, ITEM_ID_BEDROCK, ITEM_ID_CAVE_BACKGROUND);
 			break;
 		}
 	}
+
+	// the sky & bedrock are the same in most worlds
+	SharePages();
+	MarkAllDirty();
 }
 
-void WorldTileMap::RemoveAllTilesFromThisLock(Tile* pLock)
+void WorldTileMap::RemoveAllTilesFromThisLock(Tile pLock)
 {
 	if (pLock == NULL)
 	{
@@ -935,64 +1220,44 @@ void WorldTileMap::RemoveAllTilesFromThisLock(Tile* pLock)
 	}
 
 	const uint16_t index = pLock->GetIndex();
-	for (int i = 0; i < m_tiles.size(); i++)
+	auto it = m_locks.find(index);
+	if (it != m_locks.end())
 	{
-		Tile * pTile = GetTile(i);
-		if (pTile == NULL)
-		{
-			// tile is null
-			continue;
-		}
-
-		if (!pTile->HasFlag(TILEFLAG_LOCKED) && pTile->GetParent() == 0 && pTile->GetLockIndex() == 0)
+		// only the tiles the lock owns are touched
+		std::vector<uint16_t>& tiles = it->second.tiles;
+		for (int i = 0; i < tiles.size(); i++)
 		{
-			// tile is not locked
-			continue;
+			const uint16_t tileIndex = tiles[i];
+			GetWritableField(TILEFIELD_PARENT, tileIndex) = 0;
+			GetWritableField(TILEFIELD_FLAGS, tileIndex) &= ~TILEFLAG_LOCKED;
+			MarkTileDirty(tileIndex);
 		}
 
-		if (pTile->GetParent() == index)
-		{
-			// tile is locked by this lock
-			pTile->SetParent(0);
-			pTile->ToggleFlag(TILEFLAG_LOCKED, false);
-		}
+		tiles.clear();
+	}
 
-		if (pItemInfo->lockPower == 0 && pTile->GetLockIndex() == index)
+	if (pItemInfo->lockPower == 0)
+	{
+		// tiles are locked by a world lock, which covers the whole map
+		for (int i = 0; i < GetTileCount(); i++)
 		{
-			// tile is locked by a world lock
-			pTile->SetLockIndex(0);
+			if (GetField(TILEFIELD_LOCK_INDEX, i) == index)
+			{
+				GetWritableField(TILEFIELD_LOCK_INDEX, i) = 0;
+				MarkTileDirty(i);
+			}
 		}
 	}
 }
 
-bool WorldTileMap::NeighboursThisLock(Tile* pLock, Tile* pTile, const bool& bIgnoreEmptyAir)
+bool WorldTileMap::NeighboursThisLock(Tile pLock, Tile pTile, const bool& bIgnoreEmptyAir)
 {
-	if (pLock == NULL || pTile == NULL || pTile->GetParent() != 0)
+	if (pLock == NULL || !IsLockable(pTile, bIgnoreEmptyAir))
 	{
-		// null pointers, or is locked already
+		// null pointers, locked already or not lockable
 		return false;
 	}
 
-	ItemInfo * pItemInfo = pTile->GetItemInfo();
-	if (pItemInfo == NULL)
-	{
-		// item is null
-		return false;
-	}
-
-	if (pItemInfo->type == TYPE_LOCK || pItemInfo->type == TYPE_MAIN_DOOR || pItemInfo->type == TYPE_BEDROCK)
-	{
-		// not lockable
-		return false;
-	}
-
-	if (pItemInfo->ID == ITEM_ID_BLANK && bIgnoreEmptyAir == true)
-	{
-		// ignore empty air option is enabled, but tile is empty
-		return false;
-	}
-
-
 	const uint16_t lockX = pLock->GetIndex() % m_width;
 	const uint16_t lockY = pLock->GetIndex() / m_width;
 	const uint16_t tileX = pTile->GetIndex() % m_width;
@@ -1003,7 +1268,7 @@ bool WorldTileMap::NeighboursThisLock(Tile* pLock, Tile* pTile, const bool& bIgn
 		return false;
 	}
 
-	Tile* pNeighbourRight = GetTile(tileX + 1, tileY);
+	Tile pNeighbourRight = GetTile(tileX + 1, tileY);
 	if (pNeighbourRight)
 	{
 		if (pNeighbourRight->GetParent() == pLock->GetIndex() || (tileX + 1 == lockX && tileY == lockY))
@@ -1013,7 +1278,7 @@ bool WorldTileMap::NeighboursThisLock(Tile* pLock, Tile* pTile, const bool& bIgn
 		}
 	}
 
-	Tile* pNeighbourBottom = GetTile(tileX, tileY + 1);
+	Tile pNeighbourBottom = GetTile(tileX, tileY + 1);
 	if (pNeighbourBottom)
 	{
 		if (pNeighbourBottom->GetParent() == pLock->GetIndex() || (tileX == lockX && tileY + 1 == lockY))
@@ -1023,7 +1288,7 @@ bool WorldTileMap::NeighboursThisLock(Tile* pLock, Tile* pTile, const bool& bIgn
 		}
 	}
 
-	Tile* pNeighbourLeft = GetTile(tileX - 1, tileY);
+	Tile pNeighbourLeft = GetTile(tileX - 1, tileY);
 	if (pNeighbourLeft)
 	{
 		if (pNeighbourLeft->GetParent() == pLock->GetIndex() || (tileX - 1 == lockX && tileY == lockY))
@@ -1033,7 +1298,7 @@ bool WorldTileMap::NeighboursThisLock(Tile* pLock, Tile* pTile, const bool& bIgn
 		}
 	}
 
-	Tile* pNeighbourTop = GetTile(tileX, tileY - 1);
+	Tile pNeighbourTop = GetTile(tileX, tileY - 1);
 	if (pNeighbourTop)
 	{
 		if (pNeighbourTop->GetParent() == pLock->GetIndex() || (tileX == lockX && tileY - 1 == lockY))
@@ -1047,97 +1312,134 @@ bool WorldTileMap::NeighboursThisLock(Tile* pLock, Tile* pTile, const bool& bIgn
 	return false;
 }
 
-void WorldTileMap::AddTilesThisWouldLock(Tile* pLock, const int& lockPower, const bool& bIgnoreEmptyAir)
+void WorldTileMap::AddTilesThisWouldLock(Tile pLock, const int& lockPower, const bool& bIgnoreEmptyAir)
 {
-	int range = 1;
-	int locked = 0;
-	std::vector<Tile*> lockedTiles;
-	CL_Vec2i start = CL_Vec2i{ static_cast<int>(pLock->GetIndex() % m_width), static_cast<int>(pLock->GetIndex() / m_width) };
+	if (pLock == NULL)
+	{
+		// lock is null
+		return;
+	}
+
+	const uint16_t lockIndex = pLock->GetIndex();
+	const int lockX = lockIndex % m_width;
+	const int lockY = lockIndex / m_width;
 	RemoveAllTilesFromThisLock(pLock); // removing existing locked tiles
 
-	while (locked < lockPower)
+	// the lock takes the closest tile touching it or one of its tiles, in a square around the lock that only grows once
+	// nothing in it can be taken anymore, ties go to the lowest x, then the lowest y
+	// frontier holds the tiles that can be taken within the current range as (distance << 16 | x << 8 | y), nextRing the ones
+	// one ring further out, every tile is only looked at once
+	std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> frontier;
+	std::vector<uint32_t> nextRing;
+	std::vector<uint64_t> visited((GetTileCount() + 63) / 64, 0);
+	int range = 1;
+
+	auto visit = [&](const int& x, const int& y)
 	{
-		if (start.X - range > start.X + range || start.Y - range > start.Y + range)
+		if (x < 0 || x >= m_width || y < 0 || y >= m_height)
 		{
-			// exceeds the range
-			break;
+			// outside of the map
+			return;
 		}
 
-		bool bAssigned = false;
-		while (true)
+		const int index = x + y * m_width;
+		if (visited[index / 64] & (1ull << (index % 64)))
 		{
-			int32_t minDist = 99999;
-			int32_t SX = -1;
-			int32_t SY = -1;
-			for (uint8_t tileX = start.X - range; tileX <= start.X + range; tileX++)
-			{
-				for (uint8_t tileY = start.Y - range; tileY <= start.Y + range; tileY++)
-				{
-					Tile * pCandidateTile = GetTile(tileX, tileY);
-					if (pCandidateTile == NULL)
-					{
-						// candidate tile is null
-						continue;
-					}
-
-					auto it = std::find(lockedTiles.begin(), lockedTiles.end(), pCandidateTile);
-					if (it != lockedTiles.end())
-					{
-						// has already been checked
-						continue;
-					}
+			return;
+		}
 
-					if (!NeighboursThisLock(pLock, pCandidateTile, bIgnoreEmptyAir))
-					{
-						// cannot be locked
-						continue;
-					}
+		visited[index / 64] |= 1ull << (index % 64);
+		if (!IsLockable(Tile(this, (uint16_t)index), bIgnoreEmptyAir))
+		{
+			return;
+		}
 
-					const int32_t distance = std::abs(static_cast<int>(tileY - start.Y)) + std::abs(static_cast<int>(tileX - start.X));
-					if (distance >= minDist)
-					{
-						// too far away to be locked
-						continue;
-					}
+		const int dx = std::abs(x - lockX);
+		const int dy = std::abs(y - lockY);
+		const uint32_t key = (uint32_t)(dx + dy) << 16 | (uint32_t)x << 8 | (uint32_t)y;
+		if (std::max(dx, dy) <= range)
+		{
+			frontier.push(key);
+		}
+		else
+		{
+			nextRing.push_back(key);
+		}
+	};
 
-					minDist = distance;
-					SX = tileX;
-					SY = tileY;
-				}
-			}
+	visited[lockIndex / 64] |= 1ull << (lockIndex % 64);
+	visit(lockX + 1, lockY);
+	visit(lockX, lockY + 1);
+	visit(lockX - 1, lockY);
+	visit(lockX, lockY - 1);
 
-			if (SX == -1 && SY == -1)
+	int locked = 0;
+	while (locked < lockPower)
+	{
+		if (frontier.empty())
+		{
+			if (nextRing.empty())
 			{
-				// no tile was selected
-				break;
+				// nothing touches the lock anymore
+				return;
 			}
 
-			bAssigned = true;
-			Tile * pSelectedTile = GetTile(SX, SY);
-			if (pSelectedTile == NULL)
+			// growing the range by a ring
+			range++;
+			for (int i = 0; i < nextRing.size(); i++)
 			{
-				// selected tile is null
-				continue;
+				frontier.push(nextRing[i]);
 			}
 
-			// locking the tile
-			pSelectedTile->SetParent(pLock->GetIndex());
-			pSelectedTile->ToggleFlag(TILEFLAG_LOCKED, true);
-			lockedTiles.emplace_back(pSelectedTile);
-			++locked;
-			if (locked >= lockPower)
-			{
-				// passed the power limit, stopping the lock
-				break;
-			}
+			nextRing.clear();
 		}
 
-		if (!bAssigned)
-		{
-			// no tile was selected, empty lock?
-			return;
-		}
+		const uint32_t key = frontier.top();
+		frontier.pop();
+
+		const int x = (key >> 8) & 0xFF;
+		const int y = key & 0xFF;
+		Tile pSelectedTile = GetTile(x, y);
+
+		// locking the tile
+		pSelectedTile->SetParent(lockIndex);
+		pSelectedTile->ToggleFlag(TILEFLAG_LOCKED, true);
+		MarkTileDirty(pSelectedTile);
+		++locked;
+
+		visit(x + 1, y);
+		visit(x, y + 1);
+		visit(x - 1, y);
+		visit(x, y - 1);
+	}
+}
+
+bool WorldTileMap::IsLockable(Tile pTile, const bool& bIgnoreEmptyAir)
+{
+	if (pTile == NULL || pTile->GetParent() != 0)
+	{
+		// null pointer, or is locked already
+		return false;
+	}
+
+	ItemInfo * pItemInfo = pTile->GetItemInfo();
+	if (pItemInfo == NULL)
+	{
+		// item is null
+		return false;
+	}
+
+	if (pItemInfo->type == TYPE_LOCK || pItemInfo->type == TYPE_MAIN_DOOR || pItemInfo->type == TYPE_BEDROCK)
+	{
+		// not lockable
+		return false;
+	}
 
-		++range;
+	if (pItemInfo->ID == ITEM_ID_BLANK && bIgnoreEmptyAir == true)
+	{
+		// ignore empty air option is enabled, but tile is empty
+		return false;
 	}
-}
\ No newline at end of file
+
+	return true;
+}
@@ -1,7 +1,10 @@
 #ifndef WORLDTILEMAP_H
 #define WORLDTILEMAP_H
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <vector>
+#include <unordered_map>
 
 #include <SDK/Proton/Math.h>
 
@@ -24,68 +27,230 @@ enum eTerraformTypes
 	NUM_TERRAFORMTYPE
 };
 
+#define WORLD_CHUNK_SIZE 8 // tile changes are tracked in chunks of WORLD_CHUNK_SIZE x WORLD_CHUNK_SIZE tiles
+#define WORLD_PAGE_ROWS 4 // tiles are stored in pages of WORLD_PAGE_ROWS whole rows, tile maps share equal pages until one writes to them
+
+// the part of a player's 32x32 sprite checked against the collision grid, a bit smaller than the client's so lag & rounding
+// don't get players that stand against a wall sent back
+#define WORLD_PLAYER_HITBOX_X 8.f
+#define WORLD_PLAYER_HITBOX_Y 4.f
+#define WORLD_PLAYER_HITBOX_W 16.f
+#define WORLD_PLAYER_HITBOX_H 26.f
+#define WORLD_MOVE_SWEEP_STEP 8.f // pixels between the hitbox positions checked along a move, below the hitbox size so no tile is skipped
+#define WORLD_MOVE_MAX_PATH 16 // longest detour in tiles a move that isn't a straight line may have taken between two state packets
+
+// bits of a neighbour mask, set when that neighbour connects to the tile(same item, glued, or outside of the map)
+#define NEIGHBOUR_TOP_LEFT 0x01
+#define NEIGHBOUR_TOP 0x02
+#define NEIGHBOUR_TOP_RIGHT 0x04
+#define NEIGHBOUR_LEFT 0x08
+#define NEIGHBOUR_RIGHT 0x10
+#define NEIGHBOUR_BOTTOM_LEFT 0x20
+#define NEIGHBOUR_BOTTOM 0x40
+#define NEIGHBOUR_BOTTOM_RIGHT 0x80
+
+// the arrays of a tile page, in the order they're laid out
+enum eTileFields
+{
+	TILEFIELD_FOREGROUND,
+	TILEFIELD_BACKGROUND,
+	TILEFIELD_FLAGS,
+	TILEFIELD_PARENT, // the index of the area lock the tile is locked by
+	TILEFIELD_LOCK_INDEX, // the index of the world lock the tile belongs to
+
+	NUM_TILEFIELDS
+};
+
+// WORLD_PAGE_ROWS rows of a tile map, every field of them one after the other
+struct TilePage
+{
+	uint16_t                              tilesCount = 0; // less than a full page for the last rows when the height isn't a multiple of WORLD_PAGE_ROWS
+	std::vector<uint16_t>                 fields; // NUM_TILEFIELDS * tilesCount
+	uint64_t                              hash = 0; // of the fields, set once the page got shared
+	bool                                  bShared = false; // other tile maps may read it, it's never written again
+
+	uint16_t                              *GetField(const int& field) { return fields.data() + field * tilesCount; }
+	const uint16_t                        *GetField(const int& field) const { return fields.data() + field * tilesCount; }
+};
+
+// where every tile got serialized, lets Serialize copy the tiles that didn't change since instead of serializing them again
+struct SerializedTiles
+{
+	const uint8_t                         *pData = NULL; // the previous serialization, NULL when there's none
+	uint32_t                              revision = 0; // tile map revision pData was serialized at
+	std::vector<uint32_t>                 offsets; // start of every tile inside pData, plus the end of the last one
+};
+
+// a lock & the tiles it owns, kept up to date by the tile map so unlocking & build checks don't have to scan the map
+struct TileLock
+{
+	std::vector<uint16_t>                 tiles; // sorted indexes of the tiles whose parent is the lock
+	int                                   ownerID = -1; // userID of the owner, -1 until the lock's extra data sets it
+	std::vector<int>                      admins; // userIDs that can build in the lock besides the owner
+};
+
+// the rarely set parts of a tile, only the tiles that have any of them get an entry
+struct TileTimers
+{
+	uint8_t                               damage = 0; // the amount of damage, that has been applied to the tile
+	std::chrono::steady_clock::time_point damageTick; // when the tile was last hit
+	std::chrono::steady_clock::time_point fxTick;
+};
+
+/*
+* Tiles are stored as parallel arrays, one per field & indexed by x + y * width, so walking the map only touches the fields
+* that are needed & never the cold ones. Extra data & timers are only set on a few tiles, they live in side tables keyed by
+* the tile index. GetTile() hands out Tile handles that read & write these arrays.
+*
+* The arrays are split into pages of WORLD_PAGE_ROWS rows. Generated & loaded tile maps swap their pages for equal ones other
+* tile maps already have(the sky & bedrock of new worlds, the untouched parts of barely built ones), and a shared page is
+* copied the first time a tile of it is written. Writes have to go through GetWritableField() or GetWritableRow().
+*/
 class WorldTileMap
 {
+	friend class Tile;
+
 public:
 	WorldTileMap()
 	{
-		m_width = 100;
-		m_height = 60;
-		m_tiles.resize(static_cast<size_t>(m_width * m_height));
+		Resize(100, 60);
+		MarkAllDirty();
 	}
 
 	WorldTileMap(const uint8_t& width = 100, const uint8_t& height = 60)
 	{
-		m_width = width;
-		m_height = height;
-		m_tiles.resize(static_cast<size_t>(m_width * m_height));
+		Resize(width, height);
+		MarkAllDirty();
 	}
 
-	~WorldTileMap() = default;
+	~WorldTileMap();
 
 
 	
 	// get
 	uint8_t                               GetWidth() const { return m_width; }
 	uint8_t                               GetHeight() const { return m_height; }
-	std::vector<Tile>                     GetTiles() const { return m_tiles; }
+	int                                   GetTileCount() const { return (int)m_width * m_height; }
 	CL_Vec2f                              GetSpawnPoint() const { return m_spawnPoint; }
+	uint32_t                              GetRevision() const { return m_revision; }
+	size_t                                GetMemoryUsage(); // estimated bytes held by the tile map
+	bool                                  IsTileChangedSince(const int& index, const uint32_t& revision);
+	bool                                  TakeChangedTiles(std::vector<int>& changedTiles, bool& bAllChanged); // hands over the tiles clients weren't told about yet, false if there are none
+	bool                                  TakeJournalTiles(std::vector<int>& changedTiles, bool& bAllChanged); // hands over the tiles the world journal didn't get yet, false if there are none
+	TileLock                              *GetLock(const uint16_t& lockIndex); // NULL if the lock owns no tiles & has no access set
+	bool                                  CanBuildInAreaLock(const int& index, const int& userID); // true unless the tile is, or is in, an area lock the user has no access to
+	bool                                  IsSolid(const int& x, const int& y) const; // the foreground blocks everyone, outside of the map counts as solid
+	bool                                  IsMoveValid(const CL_Vec2f& from, const CL_Vec2f& to); // false if a player moving between the positions went through a solid tile
 
 
-	Tile                                  *GetTile(const int& x, const int& y);
-	Tile                                  *GetTile(const uint16_t& index);
-	Tile                                  *GetTile(const float& x, const float& y);
-	Tile                                  *GetTile(const CL_Vec2f& vec);
-	Tile                                  *GetTile(const CL_Vec2i& vec);
-	size_t                                GetMemoryEstimated(const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5);
+	Tile                                  GetTile(const int& x, const int& y);
+	Tile                                  GetTile(const uint16_t& index);
+	Tile                                  GetTile(const float& x, const float& y);
+	Tile                                  GetTile(const CL_Vec2f& vec);
+	Tile                                  GetTile(const CL_Vec2i& vec);
 
 
 	// set
 	void                                  SetSpawnPoint(const CL_Vec2f& spawn) { m_spawnPoint = spawn; }
+	void                                  SetLockAccess(const uint16_t& lockIndex, const int& ownerID, const std::vector<int>& admins); // caches who can build in a lock, call whenever its extra data changes
 
 
 
 	// fn
-	void                                  Serialize(uint8_t * pData, int& memOffset, const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5);
-    void                                  Load(uint8_t * pData, int& memOffset, const bool& bClientSide = true, const uint16_t& worldMapVersion = 5);
+	void                                  Serialize(MemoryWriter& writer, const bool& bClientSide = true, const float& fClientVersion = 2.998f, const uint16_t& worldMapVersion = 5, const SerializedTiles* pPrevious = NULL, SerializedTiles* pOut = NULL);
+	bool                                  Load(uint8_t * pData, int& memOffset, const bool& bClientSide = false, const uint16_t& worldMapVersion = 5); // server side data only, false if it can't be read
+
+	// call after changing anything of a tile that is serialized, invalidates the cached map data of that chunk
+	// bBroadcast queues the tile for the next tile update of the world, pass false when clients already applied the change themselves
+	void                                  MarkTileDirty(Tile pTile, const bool& bBroadcast = true);
+	void                                  MarkTileDirty(const int& index, const bool& bBroadcast = true);
+	void                                  MarkAllDirty();
 
-	void                                  ChooseVisualBackground(Tile* pTile, ItemInfo* pItemInfo, int& textureOffsetX, int& textureOffsetY);
-	void                                  ChooseVisualForeground(Tile* pTile, ItemInfo* pItemInfo, int& textureOffsetX, int& textureOffsetY);
+	// when choosing the visuals of many tiles, get the neighbour masks of the whole layer once & pass them in
+	void                                  GetNeighbourMasks(const bool& bForeground, std::vector<uint8_t>& masks); // one NEIGHBOUR_ mask per tile, compared against the item of the tile itself
+	void                                  ChooseVisualBackground(Tile pTile, ItemInfo* pItemInfo, int& textureOffsetX, int& textureOffsetY);
+	void                                  ChooseVisualBackground(Tile pTile, ItemInfo* pItemInfo, const uint8_t& neighbourMask, int& textureOffsetX, int& textureOffsetY);
+	void                                  ChooseVisualForeground(Tile pTile, ItemInfo* pItemInfo, int& textureOffsetX, int& textureOffsetY);
+	void                                  ChooseVisualForeground(Tile pTile, ItemInfo* pItemInfo, const uint8_t& neighbourMask, int& textureOffsetX, int& textureOffsetY);
 
-	void                                  GenerateTerrain(const uint8_t& terraformType = TERRATYPE_SUNNY, uint8_t width = 100, uint8_t height = 60);
+	void                                  GenerateTerrain(const uint8_t& terraformType = TERRATYPE_SUNNY, uint8_t width = 100, uint8_t height = 60, const uint64_t& seed = 0); // 0 picks a random seed
 
-	void                                  RemoveAllTilesFromThisLock(Tile* pTile);
-	bool                                  NeighboursThisLock(Tile* pLock, Tile* pTile, const bool& bIgnoreEmptyAir);
-	void                                  AddTilesThisWouldLock(Tile* pTile, const int& lockPower, const bool& bIgnoreEmptyAir);
+	void                                  RemoveAllTilesFromThisLock(Tile pTile);
+	bool                                  NeighboursThisLock(Tile pLock, Tile pTile, const bool& bIgnoreEmptyAir);
+	void                                  AddTilesThisWouldLock(Tile pTile, const int& lockPower, const bool& bIgnoreEmptyAir);
 
 private:
 	uint8_t                               m_width = 100;
 	uint8_t                               m_height = 60;
-	std::vector<Tile>                     m_tiles;
+
+	void                                  Resize(const uint8_t& width, const uint8_t& height); // every tile becomes blank
+	bool                                  IsLockable(Tile pTile, const bool& bIgnoreEmptyAir); // whether an area lock could take the tile, ignoring where it is
+	void                                  SetTileParent(const uint16_t& index, const uint16_t& lockIndex); // moves the tile between the locks
+	uint8_t                               GetNeighbourMask(const int& field, const int& index, const uint16_t& itemID);
+	void                                  ChooseVisual(const int& field, Tile pTile, ItemInfo* pItemInfo, const uint8_t& neighbourMask, int& textureOffsetX, int& textureOffsetY);
+	int                                   GetChunkIndex(const int& index) const;
+
+	uint16_t                              GetField(const int& field, const int& index) const;
+	uint16_t&                             GetWritableField(const int& field, const int& index); // copies the page first if it's shared
+	const uint16_t                        *GetRow(const int& field, const int& y) const;
+	uint16_t                              *GetWritableRow(const int& field, const int& y); // copies the page first if it's shared
+	void                                  UnsharePage(const int& page);
+	void                                  SharePages(); // swaps every page for an equal shared one, or shares it with the next tile maps
+
+	void                                  UpdateCollision(const int& index);
+	void                                  UpdateAllCollisions();
+	bool                                  IsHitboxBlocked(const float& x, const float& y) const; // hitbox of a player at x, y overlaps a solid tile
+	bool                                  IsReachable(const CL_Vec2i& from, const CL_Vec2i& to, const int& maxSteps); // path over tiles that aren't solid, at most maxSteps long
+
+	std::vector<std::shared_ptr<TilePage>> m_pages; // WORLD_PAGE_ROWS rows each, from the top
+	int                                   m_pageTiles = 0; // tiles of a full page
+	std::vector<uint64_t>                 m_solidBits; // a bit per tile by its index, set when the foreground is solid
+	std::vector<uint8_t>                  m_pathSteps; // reused by IsReachable
+	std::unordered_map<uint16_t, TileExtra*> m_extras; // only for the tiles with extra data
+	TileExtraPool                         m_extraPool; // where the extras live
+	std::unordered_map<uint16_t, TileTimers> m_timers; // only for the damaged tiles
+	std::unordered_map<uint16_t, TileLock> m_locks; // lock index to the lock
+
+	std::vector<uint32_t>                 m_chunkRevisions; // revision every chunk was last changed at
+	uint32_t                              m_revision = 0; // bumped on every tile change
+
+	std::vector<int>                      m_changedTiles; // indexes waiting for the next tile update, may contain duplicates
+	bool                                  m_bAllChanged = false; // the whole map changed, clients need the full map data again
+
+	std::vector<int>                      m_journalTiles; // indexes waiting for the world journal, may contain duplicates
+	bool                                  m_bJournalAll = false; // the whole map changed, only a checkpoint can save it
 
 	// server side info
 	CL_Vec2f                              m_spawnPoint = CL_Vec2f(0, 0);
 
 };
 
+inline uint16_t WorldTileMap::GetField(const int& field, const int& index) const
+{
+	const TilePage& page = *m_pages[index / m_pageTiles];
+	return page.fields[field * page.tilesCount + index % m_pageTiles];
+}
+
+inline uint16_t& WorldTileMap::GetWritableField(const int& field, const int& index)
+{
+	const int page = index / m_pageTiles;
+	if (m_pages[page]->bShared)
+	{
+		UnsharePage(page);
+	}
+
+	TilePage& tilePage = *m_pages[page];
+	return tilePage.fields[field * tilePage.tilesCount + index % m_pageTiles];
+}
+
+// the hot accessors of the tile handle, defined here since they need the pages of the tile map
+inline uint16_t Tile::GetForeground() const { return m_pTileMap->GetField(TILEFIELD_FOREGROUND, m_index); }
+inline uint16_t Tile::GetBackground() const { return m_pTileMap->GetField(TILEFIELD_BACKGROUND, m_index); }
+inline uint16_t Tile::GetParent() const { return m_pTileMap->GetField(TILEFIELD_PARENT, m_index); }
+inline uint16_t Tile::GetFlags() const { return m_pTileMap->GetField(TILEFIELD_FLAGS, m_index); }
+inline uint16_t Tile::GetLockIndex() const { return m_pTileMap->GetField(TILEFIELD_LOCK_INDEX, m_index); }
+inline void Tile::SetParent(const uint16_t& lockIndex) { m_pTileMap->SetTileParent(m_index, lockIndex); }
+inline void Tile::SetFlags(const uint16_t& flags) { m_pTileMap->GetWritableField(TILEFIELD_FLAGS, m_index) = flags; }
+inline void Tile::SetLockIndex(const uint16_t& lockIndex) { m_pTileMap->GetWritableField(TILEFIELD_LOCK_INDEX, m_index) = lockIndex; }
+
 #endif WORLDTILEMAP_H
\ No newline at end of file
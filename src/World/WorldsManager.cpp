@@ -3,6 +3,11 @@
 
 #include <Client/GameClient.h>
 #include <World/World.h>
+#include <World/WorldStore.h>
+#include <World/WorldIOService.h>
+#include <World/WorldJournal.h>
+#include <World/WorldTemplatePool.h>
+#include <GrowRender/WorldThumbnailer.h>
 
 #include <SDK/Proton/MiscUtils.h>
 
@@ -14,61 +19,87 @@ WorldsManager::~WorldsManager()
 	//
 }
 
-World * WorldsManager::GetWorldByName(const std::string& fName)
+World * WorldsManager::GetWorldByName(std::string_view fName)
 {
-	bool bFound = false;
-	for (int i = 0; i < m_activeWorlds.size(); i++)
+	auto active = m_worldsByName.find(fName);
+	if (active != m_worldsByName.end())
 	{
-		World * pWorld = m_activeWorlds[i];
-		if (pWorld == NULL)
-		{
-			// world is null
-			continue;
-		}
+		m_cacheStats.hits++;
+		return active->second;
+	}
 
-		nova_str upper_name = Utils::StringUppercase(fName);
-		if (pWorld->GetName() != upper_name)
-		{
-			// name mismatching
-			continue;
-		}
+	// not active, worlds evicted without a world path are still in memory(compressed)
+	m_cacheStats.misses++;
+	auto it = m_packedWorlds.find(fName);
+	if (it == m_packedWorlds.end())
+	{
+		return NULL;
+	}
 
-		bFound = true;
-		return pWorld;
+	World * pWorld = GetWorldStore()->Unpack(it->second.data(), it->second.size(), -1, "evicted world " + it->first);
+	m_packedWorlds.erase(it);
+	if (pWorld != NULL)
+	{
+		AddActiveWorld(pWorld);
 	}
 
-	if (!bFound)
+	return pWorld;
+}
+
+World * WorldsManager::GetWorldByID(const int& ID)
+{
+	auto it = m_worldsByID.find(ID);
+	if (it == m_worldsByID.end())
 	{
-		// get from db
+		// not in memory
+		m_cacheStats.misses++;
 		return NULL;
 	}
 
-	return NULL;
+	m_cacheStats.hits++;
+	return it->second;
 }
 
-World * WorldsManager::GetWorldByID(const int& ID)
+void WorldsManager::AddActiveWorld(World* pWorld)
 {
-	bool bFound = false;
-	for (int i = 0; i < m_activeWorlds.size(); i++)
+	if (pWorld == NULL)
 	{
-		World* pWorld = m_activeWorlds[i];
-		if (pWorld == NULL || pWorld->GetID() != ID)
-		{
-			// world is null or ID mismatch
-			continue;
-		}
+		// world is null
+		return;
+	}
+
+	m_activeWorlds.emplace_back(pWorld);
+	m_worldsByName[pWorld->GetName()] = pWorld;
+	if (pWorld->GetID() != -1)
+	{
+		m_worldsByID[pWorld->GetID()] = pWorld;
+	}
+
+	// new, generated or replayed worlds have the whole map to flush
+	QueueFlush(pWorld);
+}
 
-		bFound = true;
-		return pWorld;
+void WorldsManager::RemoveActiveWorld(World* pWorld)
+{
+	auto it = std::find(m_activeWorlds.begin(), m_activeWorlds.end(), pWorld);
+	if (it == m_activeWorlds.end())
+	{
+		// not active
+		return;
 	}
 
-	if (!bFound)
+	m_activeWorlds.erase(it);
+	if (pWorld->SetFlushQueued(false))
 	{
-		// get from db
-		return NULL;
+		std::lock_guard<std::mutex> lock(m_flushMutex);
+		m_flushWorlds.erase(std::find(m_flushWorlds.begin(), m_flushWorlds.end(), pWorld));
 	}
 
-	return NULL;
+	m_worldsByName.erase(pWorld->GetName());
+	if (pWorld->GetID() != -1)
+	{
+		m_worldsByID.erase(pWorld->GetID());
+	}
 }
 
 void WorldsManager::SendWorldOffers(GameClient* pClient, const bool& bOnlineMessage)
@@ -113,49 +144,63 @@ bool WorldsManager::Enter(GameClient * pClient, const char * fName, CL_Vec2f spa
 		return false;
 	}
 
+	if (IsEntering(pClient))
+	{
+		// already waiting for a world
+		return false;
+	}
+
 	nova_str upper_name = Utils::StringUppercase(fName);
 	World *  pWorld = GetWorldByName(upper_name);
 	if (pWorld == NULL)
 	{
-		// creating a new world object
-		pWorld = new World(upper_name);
-		pWorld->GetWorldTileMap()->GenerateTerrain(TERRATYPE_SUNNY, 100, 60);
-		m_activeWorlds.emplace_back(pWorld);
+		int worldID = GetWorldStore()->GetWorldID(upper_name);
+		if (worldID != -1)
+		{
+			// parking the client until the world I/O service loaded the world, joins of the same world share one load
+			std::vector<PendingEnter>& pending = m_pendingEnters[upper_name];
+			if (pending.empty())
+			{
+				GetWorldIOService()->QueueLoad(upper_name, worldID);
+			}
+
+			pending.push_back({ pClient, spawnPoint });
+			return true;
+		}
+
+		pWorld = CreateWorld(upper_name, GetWorldStore()->CreateWorldID(upper_name));
 	}
 
 	if (pWorld->HasBit(WORLDBIT_NOGO)) // missing moderator check
 	{
 		pClient->SendEntryFail("`4To reduce confusion, that is not a valid world name.`` Try another?");
+		MarkIdle(pWorld); // created or unpacked for this entry, it still has to be evictable
 		return false;
 	}
 
 	if (pWorld->HasBit(WORLDBIT_INACCESSIBLE)) // missing moderator check
 	{
 		pClient->SendEntryFail("That world is inaccessible.");
+		MarkIdle(pWorld);
 		return false;
 	}
 
-	// serializing world data and sending packet to the game client
-	int                memOffset = 0;
-	size_t             world_data_length = pWorld->GetMemoryEstimated(true, pClient->GetLoginDetails()->gameVersion, pWorld->GetMapVersion()); // getting the size of the world
-	GameUpdatePacket * pMapDataPacket = (GameUpdatePacket*)std::malloc(sizeof(GameUpdatePacket) + world_data_length);
+	// sending the cached map data packet, it's only serialized again when the world changed since the last join
+	ENetPacket * pMapDataPacket = pWorld->GetMapDataPacket(pClient->GetLoginDetails()->gameVersion);
 	if (pMapDataPacket == NULL)
 	{
 		// failed to allocate for the packet, missing resources maybe???
 		pClient->SendEntryFail("Something failed while entering world.");
-		nova_dealloc(pMapDataPacket);
+		MarkIdle(pWorld);
 		return false;
 	}
 
-	pMapDataPacket->type = NET_GAME_PACKET_SEND_MAP_DATA;
-	pMapDataPacket->netID = -1;
-	pMapDataPacket->flags |= NET_GAME_PACKET_FLAG_EXTENDED;
-	pMapDataPacket->dataLength = (uint32_t)world_data_length;
-
-	// copying world data to the packet & sending it to client and freeing it
-	pWorld->Serialize(pMapDataPacket->data, memOffset, true, pClient->GetLoginDetails()->gameVersion, pWorld->GetMapVersion());
-	pClient->SendPacketRaw(NET_MESSAGE_GAME_PACKET, pMapDataPacket, sizeof(GameUpdatePacket) + pMapDataPacket->dataLength, ENET_PACKET_FLAG_RELIABLE);
-	nova_dealloc(pMapDataPacket);
+	if (!pClient->SendENetPacket(pMapDataPacket))
+	{
+		// peer didn't take the packet, the world keeps owning it
+		MarkIdle(pWorld);
+		return false;
+	}
 
 	if (spawnPoint == CL_Vec2f(0.f, 0.f))
 	{
@@ -163,6 +208,12 @@ bool WorldsManager::Enter(GameClient * pClient, const char * fName, CL_Vec2f spa
 		spawnPoint = pWorld->GetWorldTileMap()->GetSpawnPoint();
 	}
 
+	if (pWorld->GetClients().empty())
+	{
+		// world is in use again, it can't be evicted
+		m_idleWorlds.remove(pWorld);
+	}
+
 	pWorld->AddClient(pClient);
 	pClient->SetWorld(pWorld);
 	pClient->SetNetID(pWorld->GetNetID(true));
@@ -283,9 +334,18 @@ void WorldsManager::Exit(GameClient* pClient, const bool& bShowWorldOffers)
 	{
 		// world is inactive	
 		pWorld->SetNetID(0);
-		// pWorld->SaveToDB();
+		if (pWorld->IsDirty())
+		{
+			// written behind by the world I/O service
+			if (GetWorldIOService()->QueueSave(pWorld))
+			{
+				GetWorldThumbnailer()->Queue(pWorld);
+			}
+		}
 
-		// TODO: push to cache & remove from activeWorlds
+		// stays in memory for the next visitor, until it's evicted by UpdateCache
+		pWorld->SetIdleSince(std::chrono::steady_clock::now());
+		m_idleWorlds.push_front(pWorld);
 	}
 
 	if (bShowWorldOffers)
@@ -299,4 +359,291 @@ void WorldsManager::Exit(GameClient* pClient, const bool& bShowWorldOffers)
 
 		SendWorldOffers(pClient, true);
 	}
-}
\ No newline at end of file
+}
+
+void WorldsManager::QueueFlush(World* pWorld)
+{
+	if (pWorld == NULL || pWorld->SetFlushQueued(true))
+	{
+		// world is null or already queued
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_flushMutex);
+	m_flushWorlds.push_back(pWorld);
+}
+
+void WorldsManager::FlushWorlds()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_flushMutex);
+		m_flushingWorlds.swap(m_flushWorlds);
+	}
+
+	// only the worlds that changed, a tick costs nothing for the worlds that didn't
+	for (int i = 0; i < m_flushingWorlds.size(); i++)
+	{
+		World * pWorld = m_flushingWorlds[i];
+		pWorld->SetFlushQueued(false);
+		pWorld->FlushTileUpdates();
+		if (!pWorld->FlushJournal() && pWorld->IsDirty())
+		{
+			// the whole map changed(new, replayed or regenerated world), saving the world is cheaper than journaling every tile
+			GetWorldIOService()->QueueSave(pWorld);
+		}
+	}
+
+	m_flushingWorlds.clear();
+}
+
+bool WorldsManager::IsEntering(GameClient * pClient)
+{
+	for (auto it = m_pendingEnters.begin(); it != m_pendingEnters.end(); ++it)
+	{
+		for (int i = 0; i < it->second.size(); i++)
+		{
+			if (it->second[i].pClient == pClient)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void WorldsManager::CancelEnter(GameClient * pClient)
+{
+	for (auto it = m_pendingEnters.begin(); it != m_pendingEnters.end(); ++it)
+	{
+		std::vector<PendingEnter>& pending = it->second;
+		for (int i = 0; i < pending.size(); i++)
+		{
+			if (pending[i].pClient == pClient)
+			{
+				// the load still finishes, the world just stays empty
+				pending.erase(pending.begin() + i);
+				return;
+			}
+		}
+	}
+}
+
+World * WorldsManager::CreateWorld(const std::string& name, const int& worldID)
+{
+	World * pWorld = new World(name);
+	pWorld->SetID(worldID);
+
+	WorldTileMap * pTileMap = GetWorldTemplatePool()->Take(TERRATYPE_SUNNY);
+	if (pTileMap != NULL)
+	{
+		// generated ahead of time
+		pWorld->SetWorldTileMap(pTileMap);
+	}
+	else
+	{
+		// the pool ran dry, generating it right away
+		pWorld->GetWorldTileMap()->GenerateTerrain(TERRATYPE_SUNNY, WORLD_DEFAULT_WIDTH, WORLD_DEFAULT_HEIGHT);
+	}
+
+	AddActiveWorld(pWorld);
+	return pWorld;
+}
+
+void WorldsManager::FinishLoads()
+{
+	GetWorldIOService()->PollLoads(m_finishedLoads);
+	for (int i = 0; i < m_finishedLoads.size(); i++)
+	{
+		WorldLoad& load = m_finishedLoads[i];
+
+		std::vector<PendingEnter> pending;
+		auto it = m_pendingEnters.find(load.name);
+		if (it != m_pendingEnters.end())
+		{
+			pending.swap(it->second);
+			m_pendingEnters.erase(it);
+		}
+
+		World * pWorld = NULL;
+		switch (load.result)
+		{
+			case WORLD_LOAD_OK:
+			{
+				pWorld = load.pWorld;
+				AddActiveWorld(pWorld);
+				break;
+			}
+
+			case WORLD_LOAD_NOT_FOUND:
+			{
+				// registered, but the server went down before it was saved
+				pWorld = CreateWorld(load.name, load.worldID);
+				break;
+			}
+
+			default:
+			{
+				LogError("failed to load world %s", load.name.c_str());
+				break;
+			}
+		}
+
+		for (int j = 0; j < pending.size(); j++)
+		{
+			GameClient * pClient = pending[j].pClient;
+			if (pWorld == NULL)
+			{
+				pClient->SendEntryFail("Something failed while entering world.");
+				continue;
+			}
+
+			Enter(pClient, load.name.c_str(), pending[j].spawnPoint);
+		}
+
+		if (pWorld != NULL)
+		{
+			// everybody waiting for it left or failed to enter, cached like any other empty world
+			MarkIdle(pWorld);
+		}
+	}
+
+	m_finishedLoads.clear();
+}
+
+void WorldsManager::OnEventLoopTick()
+{
+	FlushWorlds();
+	FinishLoads();
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - m_lastCacheCheck >= std::chrono::milliseconds(WORLD_CACHE_CHECK_INTERVAL_MS))
+	{
+		m_lastCacheCheck = now;
+		UpdateCache();
+	}
+}
+
+void WorldsManager::UpdateCache()
+{
+	size_t usage = 0;
+	for (int i = 0; i < m_activeWorlds.size(); i++)
+	{
+		if (m_activeWorlds[i] != NULL)
+		{
+			usage += m_activeWorlds[i]->GetMemoryUsage();
+		}
+	}
+
+	const size_t budget = (size_t)GetConfig().worldCacheBudgetMB * 1024 * 1024;
+	const auto graceTime = std::chrono::milliseconds(GetConfig().delayedWorldDeleteTimeMS);
+	const auto autoSaveTime = std::chrono::seconds(GetConfig().autoSaveSeconds);
+	const auto now = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < m_activeWorlds.size(); i++)
+	{
+		World * pWorld = m_activeWorlds[i];
+		if (pWorld == NULL || !pWorld->IsDirty())
+		{
+			continue;
+		}
+
+		if (now - pWorld->GetLastSaveTime() >= autoSaveTime || GetWorldJournal()->GetSize(pWorld->GetID()) >= WORLD_JOURNAL_CHECKPOINT_BYTES)
+		{
+			// tile changes are safe in the journal, but the rest of the world is only saved here & long journals slow down loading
+			if (GetConfig().bCollidateDrops && pWorld->GetClients().empty())
+			{
+				// nobody is inside to drop anything, the stacks of the drops left behind are merged into the save
+				pWorld->ConsolidateObjects();
+			}
+
+			if (GetWorldIOService()->QueueSave(pWorld))
+			{
+				GetWorldThumbnailer()->Queue(pWorld);
+			}
+		}
+	}
+
+	// the worlds left the longest ago go first
+	int evicted = 0;
+	auto it = m_idleWorlds.end();
+	while (usage > budget && it != m_idleWorlds.begin())
+	{
+		--it;
+		World * pWorld = *it;
+		if (now - pWorld->GetIdleSince() < graceTime)
+		{
+			// this one and every world after it were left too recently
+			break;
+		}
+
+		size_t worldUsage = pWorld->GetMemoryUsage();
+		if (!EvictWorld(pWorld))
+		{
+			// couldn't be saved, keeping it in memory
+			continue;
+		}
+
+		it = m_idleWorlds.erase(it);
+		usage -= std::min(usage, worldUsage);
+		++evicted;
+	}
+
+	m_cacheStats.memoryUsage = usage;
+	if (evicted > 0)
+	{
+		LogMsg("evicted %d worlds, %d worlds in memory(%d KB) - hits: %llu, misses: %llu, evictions: %llu", evicted, (int)m_activeWorlds.size(), (int)(usage / 1024),
+			(unsigned long long)m_cacheStats.hits, (unsigned long long)m_cacheStats.misses, (unsigned long long)m_cacheStats.evictions);
+	}
+}
+
+void WorldsManager::MarkIdle(World* pWorld)
+{
+	if (pWorld == NULL || !pWorld->GetClients().empty() || std::find(m_idleWorlds.begin(), m_idleWorlds.end(), pWorld) != m_idleWorlds.end())
+	{
+		// world is null, somebody is inside or it's cached already
+		return;
+	}
+
+	pWorld->SetIdleSince(std::chrono::steady_clock::now());
+	m_idleWorlds.push_front(pWorld);
+}
+
+bool WorldsManager::EvictWorld(World * pWorld)
+{
+	if (pWorld == NULL || !pWorld->GetClients().empty() || !pWorld->GetMailbox().empty())
+	{
+		// world is null, somebody is inside or packets for it wait for the world scheduler
+		return false;
+	}
+
+	if (GetConfig().bCollidateDrops)
+	{
+		// the stacks of the drops left behind are merged once, before the world leaves memory
+		pWorld->ConsolidateObjects();
+	}
+
+	if (GetWorldStore()->IsLoaded())
+	{
+		if (pWorld->IsDirty() && !GetWorldIOService()->QueueSave(pWorld))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		// nowhere to save it, keeping it compressed in memory instead
+		std::vector<uint8_t> data;
+		if (!GetWorldStore()->Pack(pWorld, data))
+		{
+			return false;
+		}
+
+		m_packedWorlds[pWorld->GetName()] = std::move(data);
+	}
+
+	RemoveActiveWorld(pWorld);
+	delete pWorld;
+	m_cacheStats.evictions++;
+	return true;
+}
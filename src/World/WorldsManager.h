@@ -2,14 +2,78 @@
 #define WORLDSMANAGER_H
 #include <string>
 #include <vector>
+#include <list>
+#include <mutex>
+#include <chrono>
+#include <string_view>
+#include <unordered_map>
 
 #include <World/World.h>
+#include <World/WorldIOService.h>
 #include <SDK/Builders/WorldOffersBuilder.h>
 #include <SDK/Builders/DialogBuilder.h>
 
+#define WORLD_CACHE_CHECK_INTERVAL_MS 1000 // how often the worlds in memory are checked against world_cache_budget_mb
+
 // fowarded definitions
 class GameClient;
 
+struct PendingEnter
+{
+	GameClient                   *pClient;
+	CL_Vec2f                     spawnPoint;
+};
+
+// case insensitive hashing & comparing of world names, the world indexes can be searched with any string_view without an uppercase copy
+struct WorldNameHash
+{
+	using is_transparent = void;
+	size_t operator()(std::string_view name) const
+	{
+		// FNV-1a of the uppercase name
+		size_t hash = 14695981039346656037ULL;
+		for (int i = 0; i < name.size(); i++)
+		{
+			hash ^= (size_t)toupper((unsigned char)name[i]);
+			hash *= 1099511628211ULL;
+		}
+
+		return hash;
+	}
+};
+
+struct WorldNameEqual
+{
+	using is_transparent = void;
+	bool operator()(std::string_view a, std::string_view b) const
+	{
+		if (a.size() != b.size())
+		{
+			return false;
+		}
+
+		for (int i = 0; i < a.size(); i++)
+		{
+			if (toupper((unsigned char)a[i]) != toupper((unsigned char)b[i]))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
+
+template <typename T> using WorldNameMap = std::unordered_map<std::string, T, WorldNameHash, WorldNameEqual>;
+
+struct WorldCacheStats
+{
+	uint64_t                     hits = 0; // requested world was in memory already
+	uint64_t                     misses = 0; // requested world had to be loaded or doesn't exist
+	uint64_t                     evictions = 0; // empty worlds unloaded to stay in the memory budget
+	size_t                       memoryUsage = 0; // estimated bytes of the worlds in memory, as of the last check
+};
+
 class WorldsManager
 {
 public:
@@ -19,21 +83,47 @@ public:
 	
 	// get
 	std::vector<World*>          GetActiveWorlds() const { return m_activeWorlds; }
+	WorldCacheStats              GetCacheStats() const { return m_cacheStats; }
 
 
-	World                        *GetWorldByName(const std::string& fName);
+	// only worlds in memory, worlds on disk are loaded by Enter through the world I/O service
+	World                        *GetWorldByName(std::string_view fName); // any case
 	World                        *GetWorldByID(const int& ID);
+	bool                         IsEntering(GameClient * pClient); // waiting for a world to load
 	
 	// set
 
 
 	// fn
 	void                         SendWorldOffers(GameClient * pClient, const bool& bOnlineMessage = false);
-	bool                         Enter(GameClient * pClient, const char * fName, CL_Vec2f spawnPoint = CL_Vec2f(0.f, 0.f));
+	bool                         Enter(GameClient * pClient, const char * fName, CL_Vec2f spawnPoint = CL_Vec2f(0.f, 0.f)); // true when entered or waiting for the world to load
+	void                         CancelEnter(GameClient * pClient); // call when the client goes away while waiting for a world
 	void                         Exit(GameClient* pClient, const bool& bShowWorldOffers = true);
+	void                         QueueFlush(World* pWorld); // any thread, the tile changes of the world get flushed on the next tick
+	void                         FlushWorlds(); // sends the tile changes of the queued worlds & hands them to the world journal
+	void                         OnEventLoopTick(); // call from the event loop, flushes the tile updates & keeps the worlds in memory within budget
 
 private:
+	World                        *CreateWorld(const std::string& name, const int& worldID);
+	void                         AddActiveWorld(World* pWorld); // the world's name & ID must not change while it's active
+	void                         RemoveActiveWorld(World* pWorld);
+	void                         FinishLoads();
+	void                         UpdateCache();
+	bool                         EvictWorld(World* pWorld);
+	void                         MarkIdle(World* pWorld); // caches the world for eviction once nobody is in it, if it isn't already
+
 	std::vector<World*>          m_activeWorlds; // active(loaded) worlds in this server
+	WorldNameMap<World*>         m_worldsByName; // index of m_activeWorlds by uppercase name
+	std::unordered_map<int, World*> m_worldsByID; // index of m_activeWorlds by world ID, worlds without one aren't in it
+	std::list<World*>            m_idleWorlds; // active worlds nobody is in, the most recently left first
+	WorldNameMap<std::vector<uint8_t>> m_packedWorlds; // evicted worlds kept compressed, when there's no world path to save them to
+	std::chrono::steady_clock::time_point m_lastCacheCheck;
+	std::unordered_map<std::string, std::vector<PendingEnter>> m_pendingEnters; // clients waiting for a world to load, by world name
+	std::vector<WorldLoad>       m_finishedLoads; // reused between ticks
+	std::mutex                   m_flushMutex; // world threads queue worlds in parallel
+	std::vector<World*>          m_flushWorlds; // worlds with tile changes since the last flush
+	std::vector<World*>          m_flushingWorlds; // reused between ticks
+	WorldCacheStats              m_cacheStats;
 
 };
 
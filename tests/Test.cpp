@@ -0,0 +1,55 @@
+#include <BaseApp.h> // precompiled
+#include "Test.h"
+
+#include <cstring>
+#include <filesystem>
+
+static int s_failures = 0;
+
+std::vector<TestCase>& GetTestCases()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+void FailTest(const char* file, const int& line, const char* expression)
+{
+	std::printf("%s:%d: CHECK(%s) failed\n", file, line, expression);
+	s_failures++;
+}
+
+std::string GetTestDirectory(const char* name)
+{
+	std::filesystem::path dir = std::filesystem::temp_directory_path() / "growbase_tests" / name;
+	std::error_code ec;
+	std::filesystem::remove_all(dir, ec);
+	std::filesystem::create_directories(dir, ec);
+	return dir.string();
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<TestCase>& tests = GetTestCases();
+	int ran = 0;
+	for (int i = 0; i < tests.size(); i++)
+	{
+		if (argc > 1 && std::strcmp(argv[1], tests[i].name) != 0)
+		{
+			// only the test asked for
+			continue;
+		}
+
+		const int failures = s_failures;
+		tests[i].fTest();
+		std::printf("%s %s\n", s_failures == failures ? "[ OK ]" : "[FAIL]", tests[i].name);
+		ran++;
+	}
+
+	if (ran == 0)
+	{
+		std::printf("no test named %s\n", argc > 1 ? argv[1] : "");
+		return 1;
+	}
+
+	return s_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#ifndef TEST_H
+#define TEST_H
+#include <string>
+#include <vector>
+#include <cstdio>
+
+struct TestCase
+{
+	const char* name;
+	void (*fTest)();
+};
+
+std::vector<TestCase>&           GetTestCases();
+void                             FailTest(const char* file, const int& line, const char* expression);
+std::string                      GetTestDirectory(const char* name); // an empty directory of the test, under the system temp directory
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, void (*fTest)()) { GetTestCases().push_back({ name, fTest }); }
+};
+
+// registers a test, run by name with GrowBaseTests <name> or all of them without arguments
+#define TEST(name) \
+	static void Test##name(); \
+	static TestRegistrar s_test##name##Registrar(#name, &Test##name); \
+	static void Test##name()
+
+// registers a benchmark, they're built into GrowBaseBench instead & print how long the code took
+#define BENCHMARK(name) TEST(name)
+
+// fails the test & leaves it, the other tests keep running
+#define CHECK(expression) \
+	if (!(expression)) \
+	{ \
+		FailTest(__FILE__, __LINE__, #expression); \
+		return; \
+	}
+
+#endif TEST_H
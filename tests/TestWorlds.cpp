@@ -0,0 +1,206 @@
+#include <BaseApp.h> // precompiled
+#include "TestWorlds.h"
+#include "Test.h"
+
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+#include <World/World.h>
+#include <World/WorldStore.h>
+#include <World/WorldTileMap.h>
+#include <Items/ItemInfoManager.h>
+
+bool InitTestItems()
+{
+	static bool bInitialized = false;
+	static bool bLoaded = false;
+	if (bInitialized)
+	{
+		return bLoaded;
+	}
+
+	// items.dat is opened relative to the working directory, the tests run in theirs
+	bInitialized = true;
+	const std::filesystem::path dir = std::filesystem::current_path();
+	std::filesystem::current_path(TEST_DATA_DIRECTORY);
+	bLoaded = GetItemInfoManager()->LoadFile();
+	std::filesystem::current_path(dir);
+	return bLoaded;
+}
+
+bool InitTestWorldStore()
+{
+	static bool bInitialized = false;
+	static bool bLoaded = false;
+	if (bInitialized)
+	{
+		return bLoaded;
+	}
+
+	bInitialized = true;
+	const std::string dir = GetTestDirectory("world_store");
+	std::filesystem::current_path(dir);
+	std::filesystem::create_directories("worlds");
+
+	std::ofstream o(WORLD_STORE_CONFIG_FILE);
+	o << "add_world_path|worlds|0|100000\n";
+	o.close();
+
+	bLoaded = GetWorldStore()->Init();
+	return bLoaded;
+}
+
+World* CreateTestWorld(const std::string& name, const uint8_t& width, const uint8_t& height, const uint64_t& seed)
+{
+	World * pWorld = new World(name);
+	pWorld->SetID(GetWorldStore()->CreateWorldID(name));
+	pWorld->GetWorldTileMap()->GenerateTerrain(TERRATYPE_SUNNY, width, height, seed);
+	return pWorld;
+}
+
+// the flags above TILEFLAG_PUBLIC are plain data to the server, tests store their values in them
+#define TEST_TILE_VALUE_SHIFT 9
+
+uint16_t GetTileValue(World* pWorld, const int& index)
+{
+	return pWorld->GetWorldTileMap()->GetTile((uint16_t)index)->GetFlags() >> TEST_TILE_VALUE_SHIFT;
+}
+
+void SetTileValue(World* pWorld, const int& index, const int& value)
+{
+	WorldTileMap * pTileMap = pWorld->GetWorldTileMap();
+	Tile pTile = pTileMap->GetTile((uint16_t)index);
+	pTile->SetFlags((pTile->GetFlags() & ((1 << TEST_TILE_VALUE_SHIFT) - 1)) | (uint16_t)((value & 127) << TEST_TILE_VALUE_SHIFT));
+	pTileMap->MarkTileDirty(index, false);
+}
+
+bool HasSameTiles(World* pWorld, World* pOther)
+{
+	WorldTileMap * pTileMap = pWorld->GetWorldTileMap();
+	WorldTileMap * pOtherTileMap = pOther->GetWorldTileMap();
+	if (pTileMap->GetWidth() != pOtherTileMap->GetWidth() || pTileMap->GetHeight() != pOtherTileMap->GetHeight())
+	{
+		return false;
+	}
+
+	for (int i = 0; i < pTileMap->GetTileCount(); i++)
+	{
+		Tile pTile = pTileMap->GetTile((uint16_t)i);
+		Tile pOtherTile = pOtherTileMap->GetTile((uint16_t)i);
+		if (pTile->GetForeground() != pOtherTile->GetForeground() || pTile->GetBackground() != pOtherTile->GetBackground() || pTile->GetFlags() != pOtherTile->GetFlags())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void RandomizeTestTiles(WorldTileMap* pTileMap, const uint64_t& seed)
+{
+	static const uint16_t foregrounds[] = { ITEM_ID_BLANK, ITEM_ID_DIRT, ITEM_ID_ROCK, ITEM_ID_GRASS, ITEM_ID_BEDROCK };
+	FastRandom rng(seed);
+	for (int i = 0; i < pTileMap->GetTileCount(); i++)
+	{
+		Tile pTile = pTileMap->GetTile((uint16_t)i);
+		pTile->SetForeground(foregrounds[rng.Get(0, 4)]);
+		if (rng.Chance(20, 1))
+		{
+			// taken by a lock somewhere else
+			pTile->SetParent((uint16_t)rng.Get(1, pTileMap->GetTileCount() - 1));
+			pTile->ToggleFlag(TILEFLAG_LOCKED, true);
+		}
+	}
+}
+
+bool HasSameLocks(WorldTileMap* pTileMap, WorldTileMap* pOther)
+{
+	if (pTileMap->GetTileCount() != pOther->GetTileCount())
+	{
+		return false;
+	}
+
+	for (int i = 0; i < pTileMap->GetTileCount(); i++)
+	{
+		Tile pTile = pTileMap->GetTile((uint16_t)i);
+		Tile pOtherTile = pOther->GetTile((uint16_t)i);
+		if (pTile->GetParent() != pOtherTile->GetParent() || pTile->GetFlags() != pOtherTile->GetFlags())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// the lock takes the closest tile touching it or one of its tiles within a square around it, the square only grows once
+// nothing in it can be taken anymore, the coordinates are ints so it also holds up next to the edges of the map
+void AddTilesThisWouldLockReference(WorldTileMap* pTileMap, const uint16_t& lockIndex, const int& lockPower, const bool& bIgnoreEmptyAir)
+{
+	Tile pLock = pTileMap->GetTile(lockIndex);
+	const int startX = lockIndex % pTileMap->GetWidth();
+	const int startY = lockIndex / pTileMap->GetWidth();
+	std::vector<uint16_t> lockedTiles;
+	pTileMap->RemoveAllTilesFromThisLock(pLock);
+
+	int range = 1;
+	int locked = 0;
+	while (locked < lockPower)
+	{
+		bool bAssigned = false;
+		while (locked < lockPower)
+		{
+			int minDist = 99999;
+			int SX = -1;
+			int SY = -1;
+			for (int tileX = startX - range; tileX <= startX + range; tileX++)
+			{
+				for (int tileY = startY - range; tileY <= startY + range; tileY++)
+				{
+					Tile pCandidateTile = pTileMap->GetTile(tileX, tileY);
+					if (pCandidateTile == NULL || std::find(lockedTiles.begin(), lockedTiles.end(), pCandidateTile->GetIndex()) != lockedTiles.end())
+					{
+						// outside of the map or taken already
+						continue;
+					}
+
+					if (!pTileMap->NeighboursThisLock(pLock, pCandidateTile, bIgnoreEmptyAir))
+					{
+						continue;
+					}
+
+					const int distance = std::abs(tileX - startX) + std::abs(tileY - startY);
+					if (distance < minDist)
+					{
+						minDist = distance;
+						SX = tileX;
+						SY = tileY;
+					}
+				}
+			}
+
+			if (SX == -1)
+			{
+				// nothing left within the range
+				break;
+			}
+
+			Tile pSelectedTile = pTileMap->GetTile(SX, SY);
+			pSelectedTile->SetParent(lockIndex);
+			pSelectedTile->ToggleFlag(TILEFLAG_LOCKED, true);
+			pTileMap->MarkTileDirty(pSelectedTile);
+			lockedTiles.push_back(pSelectedTile->GetIndex());
+			bAssigned = true;
+			++locked;
+		}
+
+		if (!bAssigned)
+		{
+			// nothing touches the lock anymore
+			return;
+		}
+
+		++range;
+	}
+}
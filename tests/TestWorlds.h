@@ -0,0 +1,24 @@
+#ifndef TESTWORLDS_H
+#define TESTWORLDS_H
+#include <string>
+#include <cstdint>
+
+// fowarded definitions
+class World;
+class WorldTileMap;
+
+bool                             InitTestItems(); // items.dat of bin/ in the items every thread sees, loaded once for the whole run
+bool                             InitTestWorldStore(); // a world store in an empty test directory, the same one for the whole run
+World                            *CreateTestWorld(const std::string& name, const uint8_t& width = 100, const uint8_t& height = 60, const uint64_t& seed = 1); // registered in the store & generated, not saved yet
+uint16_t                         GetTileValue(World* pWorld, const int& index);
+void                             SetTileValue(World* pWorld, const int& index, const int& value); // 0-127 kept in the paint & effect flags of the tile, marks it dirty for the journal
+
+void                             RandomizeTestTiles(WorldTileMap* pTileMap, const uint64_t& seed); // random blocks, air, bedrock & tiles of some other lock, needs InitTestItems()
+
+bool                             HasSameTiles(World* pWorld, World* pOther); // every tile of both worlds is the same
+bool                             HasSameLocks(WorldTileMap* pTileMap, WorldTileMap* pOther); // every tile of both maps has the same lock
+
+// the lock solver as it was before the flood fill, for checking & timing the flood fill against it
+void                             AddTilesThisWouldLockReference(WorldTileMap* pTileMap, const uint16_t& lockIndex, const int& lockPower, const bool& bIgnoreEmptyAir);
+
+#endif TESTWORLDS_H
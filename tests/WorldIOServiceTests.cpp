@@ -0,0 +1,162 @@
+#include <BaseApp.h> // precompiled
+#include "Test.h"
+#include "TestWorlds.h"
+
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+
+#include <World/World.h>
+#include <World/WorldStore.h>
+#include <World/WorldIOService.h>
+#include <World/WorldTileMap.h>
+
+// the world of a queued load, NULL if it didn't finish in time or failed
+static World* WaitForLoad(const int& worldID)
+{
+	std::vector<WorldLoad> loads;
+	auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (std::chrono::steady_clock::now() < timeout)
+	{
+		GetWorldIOService()->PollLoads(loads);
+		for (int i = 0; i < loads.size(); i++)
+		{
+			if (loads[i].worldID == worldID)
+			{
+				return loads[i].pWorld;
+			}
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return NULL;
+}
+
+// a load queued right behind saves of the same world sees the last of them, whichever worker picks either job up
+TEST(WorldIOLoadAfterSaves)
+{
+	CHECK(InitTestWorldStore());
+	GetWorldIOService()->Start(4);
+
+	World * pWorld = CreateTestWorld("IOORDER");
+	const int tilesCount = pWorld->GetWorldTileMap()->GetTileCount();
+	bool bSame = true;
+	for (int round = 1; round <= 200 && bSame; round++)
+	{
+		// up to 3 saves in flight before the load
+		for (int save = 0; save < round % 4; save++)
+		{
+			SetTileValue(pWorld, (round * 37 + save * 11) % tilesCount, round + save);
+			CHECK(GetWorldIOService()->QueueSave(pWorld));
+		}
+
+		GetWorldIOService()->QueueLoad(pWorld->GetName(), pWorld->GetID());
+		World * pLoaded = WaitForLoad(pWorld->GetID());
+		bSame = pLoaded != NULL && HasSameTiles(pWorld, pLoaded);
+		delete pLoaded;
+	}
+
+	CHECK(bSame);
+
+	// stopping writes whatever is still pending, the file has the last save
+	SetTileValue(pWorld, 0, 99);
+	CHECK(GetWorldIOService()->QueueSave(pWorld));
+	GetWorldIOService()->Stop();
+	CHECK(!GetWorldIOService()->HasPendingSaves());
+
+	World * pStored = GetWorldStore()->Load(pWorld->GetID());
+	CHECK(pStored != NULL);
+	CHECK(HasSameTiles(pWorld, pStored));
+	delete pStored;
+	delete pWorld;
+}
+
+// saves of the same world queued faster than they're written keep only the newest serialization, & are written fewer times
+TEST(WorldIOSavesCoalesce)
+{
+	CHECK(InitTestWorldStore());
+	World * pWorld = CreateTestWorld("IOCOALESCE");
+
+	// queued while no worker runs, all of them are a single write
+	int written = GetWorldIOService()->GetSavesWritten();
+	for (int i = 0; i < 100; i++)
+	{
+		SetTileValue(pWorld, i, i);
+		CHECK(GetWorldIOService()->QueueSave(pWorld));
+	}
+
+	GetWorldIOService()->Start(2);
+	GetWorldIOService()->Stop();
+	CHECK(GetWorldIOService()->GetSavesWritten() - written == 1);
+
+	// queued while the workers write them, the ones coming in during a write are taken by the next one
+	written = GetWorldIOService()->GetSavesWritten();
+	GetWorldIOService()->Start(2);
+	for (int i = 0; i < 100; i++)
+	{
+		SetTileValue(pWorld, i, 100 - i);
+		CHECK(GetWorldIOService()->QueueSave(pWorld));
+	}
+
+	GetWorldIOService()->Stop();
+	const int saves = GetWorldIOService()->GetSavesWritten() - written;
+	CHECK(saves >= 1 && saves < 100);
+
+	World * pStored = GetWorldStore()->Load(pWorld->GetID());
+	CHECK(pStored != NULL);
+	CHECK(HasSameTiles(pWorld, pStored));
+	delete pStored;
+	delete pWorld;
+}
+
+// a save that couldn't be written stays pending, loads are served from it & it's written once the disk lets it
+TEST(WorldIOSaveRetriedAfterFailure)
+{
+	CHECK(InitTestWorldStore());
+	GetWorldIOService()->Start(2);
+
+	World * pWorld = CreateTestWorld("IOFAILURE");
+	SetTileValue(pWorld, 0, 42);
+
+	// a directory in place of the world file, renaming the new file over it fails
+	const std::string fName = GetWorldStore()->GetWorldFilePath(pWorld->GetID());
+	std::filesystem::create_directories(fName);
+	std::ofstream(fName + "/blocker") << "blocker";
+
+	const int failures = GetWorldIOService()->GetSaveFailures();
+	CHECK(GetWorldIOService()->QueueSave(pWorld));
+	auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (GetWorldIOService()->GetSaveFailures() == failures && std::chrono::steady_clock::now() < timeout)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	CHECK(GetWorldIOService()->GetSaveFailures() > failures);
+	CHECK(GetWorldIOService()->HasPendingSaves());
+
+	GetWorldIOService()->QueueLoad(pWorld->GetName(), pWorld->GetID());
+	World * pLoaded = WaitForLoad(pWorld->GetID());
+	CHECK(pLoaded != NULL);
+	const bool bSame = HasSameTiles(pWorld, pLoaded);
+	delete pLoaded;
+	CHECK(bSame);
+
+	// the retry goes through once the directory is gone
+	std::filesystem::remove_all(fName);
+	timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (GetWorldIOService()->HasPendingSaves() && std::chrono::steady_clock::now() < timeout)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	CHECK(!GetWorldIOService()->HasPendingSaves());
+	GetWorldIOService()->Stop();
+
+	World * pStored = GetWorldStore()->Load(pWorld->GetID());
+	CHECK(pStored != NULL);
+	CHECK(HasSameTiles(pWorld, pStored));
+	delete pStored;
+	delete pWorld;
+}
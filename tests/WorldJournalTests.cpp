@@ -0,0 +1,202 @@
+#include <BaseApp.h> // precompiled
+#include "Test.h"
+#include "TestWorlds.h"
+
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+
+#include <World/World.h>
+#include <World/WorldStore.h>
+#include <World/WorldJournal.h>
+#include <World/WorldTileMap.h>
+
+// a new world as it's first saved, the journal only holds what changes after
+static World* CreateSavedWorld(const std::string& name)
+{
+	World * pWorld = CreateTestWorld(name);
+	pWorld->FlushJournal(); // takes the generated tiles, a checkpoint covers them
+	if (!GetWorldStore()->Save(pWorld))
+	{
+		delete pWorld;
+		return NULL;
+	}
+
+	GetWorldJournal()->Checkpoint(pWorld->GetID(), pWorld->GetJournalSeq());
+	return pWorld;
+}
+
+// the world the server finds after a restart, the world file with the journal replayed on top
+static World* LoadAfterRestart(const int& worldID)
+{
+	World * pWorld = GetWorldStore()->Load(worldID);
+	if (pWorld != NULL && !GetWorldJournal()->Replay(pWorld))
+	{
+		delete pWorld;
+		return NULL;
+	}
+
+	return pWorld;
+}
+
+// the server died after the journal committed its records, and after the world file got written but before it was checkpointed:
+// the journal still holds records the world file has, replaying them again must not undo the newer ones
+TEST(WorldJournalReplayAfterCrash)
+{
+	CHECK(InitTestWorldStore());
+	GetWorldJournal()->Start();
+
+	World * pWorld = CreateSavedWorld("JOURNALCRASH");
+	CHECK(pWorld != NULL);
+
+	// committed, then in the world file without a checkpoint
+	for (int i = 0; i < 50; i++)
+	{
+		SetTileValue(pWorld, i, 1);
+	}
+
+	CHECK(pWorld->FlushJournal());
+	CHECK(GetWorldStore()->Save(pWorld));
+
+	// only committed, half of them overwrite tiles the world file has
+	for (int i = 25; i < 75; i++)
+	{
+		SetTileValue(pWorld, i, 2);
+	}
+
+	CHECK(pWorld->FlushJournal());
+	GetWorldJournal()->Stop(); // commits what's queued, the crash comes right after
+
+	World * pRestarted = LoadAfterRestart(pWorld->GetID());
+	CHECK(pRestarted != NULL);
+	CHECK(HasSameTiles(pWorld, pRestarted));
+	CHECK(pRestarted->GetJournalSeq() == pWorld->GetJournalSeq());
+	delete pRestarted;
+	delete pWorld;
+}
+
+// the server died before the world file got written, every committed record is replayed on the previous file
+TEST(WorldJournalReplayWithoutWorldFile)
+{
+	CHECK(InitTestWorldStore());
+	GetWorldJournal()->Start();
+
+	World * pWorld = CreateSavedWorld("JOURNALNOFILE");
+	CHECK(pWorld != NULL);
+	for (int round = 1; round <= 10; round++)
+	{
+		// a tick each
+		for (int i = 0; i < 20; i++)
+		{
+			SetTileValue(pWorld, (round * 7 + i * 13) % pWorld->GetWorldTileMap()->GetTileCount(), round);
+		}
+
+		CHECK(pWorld->FlushJournal());
+	}
+
+	GetWorldJournal()->Stop();
+
+	World * pRestarted = LoadAfterRestart(pWorld->GetID());
+	CHECK(pRestarted != NULL);
+	CHECK(HasSameTiles(pWorld, pRestarted));
+	delete pRestarted;
+	delete pWorld;
+}
+
+// a crash in the middle of an append leaves a torn record at the end of the journal, replay stops in front of it
+TEST(WorldJournalReplayTornTail)
+{
+	CHECK(InitTestWorldStore());
+	GetWorldJournal()->Start();
+
+	World * pWorld = CreateSavedWorld("JOURNALTORN");
+	CHECK(pWorld != NULL);
+	for (int i = 0; i < 30; i++)
+	{
+		SetTileValue(pWorld, i, 3);
+	}
+
+	CHECK(pWorld->FlushJournal());
+	GetWorldJournal()->Stop();
+
+	const std::string fName = GetWorldStore()->GetWorldFilePath(pWorld->GetID(), WORLD_JOURNAL_EXTENSION);
+	FILE * pFile = fopen(fName.c_str(), "ab");
+	CHECK(pFile != NULL);
+	const uint8_t torn[] = { 0xFF, 0x00, 0x00, 0x00, 0x05, 0x00, 0x20 };
+	fwrite(torn, 1, sizeof(torn), pFile);
+	fclose(pFile);
+
+	World * pRestarted = LoadAfterRestart(pWorld->GetID());
+	CHECK(pRestarted != NULL);
+	CHECK(HasSameTiles(pWorld, pRestarted));
+	delete pRestarted;
+	delete pWorld;
+}
+
+// an append failed & left a torn record at the end of the journal: its records are committed again with the next ones,
+// and they don't end up behind the torn record where replay never reaches
+TEST(WorldJournalAppendAfterTornTail)
+{
+	CHECK(InitTestWorldStore());
+	GetWorldJournal()->Start();
+
+	World * pWorld = CreateSavedWorld("JOURNALFAILED");
+	CHECK(pWorld != NULL);
+	for (int i = 0; i < 50; i++)
+	{
+		SetTileValue(pWorld, i, 1);
+	}
+
+	CHECK(pWorld->FlushJournal());
+	GetWorldJournal()->Stop();
+	GetWorldJournal()->Start();
+
+	// a directory in place of the journal fails the next append
+	const std::string fName = GetWorldStore()->GetWorldFilePath(pWorld->GetID(), WORLD_JOURNAL_EXTENSION);
+	std::ifstream f(fName, std::ios::binary);
+	std::vector<uint8_t> committed((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+	f.close();
+	std::filesystem::remove(fName);
+	std::filesystem::create_directories(fName);
+
+	const int failures = GetWorldJournal()->GetCommitFailures();
+	for (int i = 25; i < 75; i++)
+	{
+		SetTileValue(pWorld, i, 2);
+	}
+
+	CHECK(pWorld->FlushJournal());
+	auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (GetWorldJournal()->GetCommitFailures() == failures && std::chrono::steady_clock::now() < timeout)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	CHECK(GetWorldJournal()->GetCommitFailures() > failures);
+
+	// the journal is back, ending in the record header & part of the payload the failed append got out
+	std::filesystem::remove_all(fName);
+	const uint8_t torn[] = { 0x40, 0x00, 0x00, 0x00, 0x19, 0x00, 0x20, 0x00, 0x12, 0x34, 0x56, 0x78, 0x01, 0x02 };
+	committed.insert(committed.end(), torn, torn + sizeof(torn));
+	std::ofstream o(fName, std::ios::binary);
+	o.write((const char*)committed.data(), committed.size());
+	o.close();
+
+	for (int i = 60; i < 100; i++)
+	{
+		SetTileValue(pWorld, i, 3);
+	}
+
+	CHECK(pWorld->FlushJournal());
+	GetWorldJournal()->Stop();
+
+	World * pRestarted = LoadAfterRestart(pWorld->GetID());
+	CHECK(pRestarted != NULL);
+	CHECK(HasSameTiles(pWorld, pRestarted));
+	CHECK(pRestarted->GetJournalSeq() == pWorld->GetJournalSeq());
+	delete pRestarted;
+	delete pWorld;
+}
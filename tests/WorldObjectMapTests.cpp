@@ -0,0 +1,47 @@
+#include <BaseApp.h> // precompiled
+#include "Test.h"
+#include "TestWorlds.h"
+
+#include <World/WorldObjectMap.h>
+
+static WorldObject CreateDrop(const short& itemID, const float& x, const float& y, const uint8_t& count)
+{
+	WorldObject object;
+	object.itemID = itemID;
+	object.x = x;
+	object.y = y;
+	object.count = count;
+	return object;
+}
+
+// the second of two nearby drops of the same item is poured into the first, the clients only see the first one change
+TEST(WorldObjectMapDropsMerge)
+{
+	CHECK(InitTestItems());
+
+	WorldObjectMap objectMap;
+	std::vector<WorldObjectChange> changes;
+	WorldObject first = CreateDrop(ITEM_ID_DIRT, 64.f, 64.f, 5);
+	WorldObject * pFirst = objectMap.DropObject(first, true, changes);
+	CHECK(pFirst != NULL);
+	CHECK(changes.size() == 1 && changes[0].changeType == CHANGETYPE_SPAWN);
+	const int firstID = pFirst->ID;
+
+	changes.clear();
+	WorldObject second = CreateDrop(ITEM_ID_DIRT, 64.f + WORLD_OBJECT_CONSOLIDATE_RADIUS / 2, 64.f, 7);
+	CHECK(objectMap.DropObject(second, true, changes) == NULL);
+	CHECK(objectMap.GetObjectCount() == 1);
+	CHECK(objectMap.GetObjectByID(firstID)->count == 12);
+	CHECK(changes.size() == 1 && changes[0].changeType == CHANGETYPE_EDIT && changes[0].object.ID == firstID && changes[0].object.count == 12);
+
+	// another item, or too far away, or without consolidate_drops, makes a stack of its own
+	changes.clear();
+	WorldObject other = CreateDrop(ITEM_ID_ROCK, 64.f, 64.f, 1);
+	WorldObject far = CreateDrop(ITEM_ID_DIRT, 64.f + WORLD_OBJECT_CONSOLIDATE_RADIUS * 4, 64.f, 1);
+	WorldObject unconsolidated = CreateDrop(ITEM_ID_DIRT, 64.f, 64.f, 1);
+	CHECK(objectMap.DropObject(other, true, changes) != NULL);
+	CHECK(objectMap.DropObject(far, true, changes) != NULL);
+	CHECK(objectMap.DropObject(unconsolidated, false, changes) != NULL);
+	CHECK(objectMap.GetObjectCount() == 4);
+	CHECK(objectMap.GetObjectByID(firstID)->count == 12);
+}
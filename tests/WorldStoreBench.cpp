@@ -0,0 +1,64 @@
+#include <BaseApp.h> // precompiled
+#include "Test.h"
+#include "TestWorlds.h"
+
+#include <chrono>
+
+#include <World/World.h>
+#include <World/WorldStore.h>
+
+// milliseconds a call of fBench takes on average
+template <typename F> static double TimeRuns(const int& runs, F fBench)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < runs; i++)
+	{
+		fBench();
+	}
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / runs;
+}
+
+// save & load throughput of a generated world, the MB/s are of the uncompressed world data
+BENCHMARK(WorldStoreBench)
+{
+	CHECK(InitTestWorldStore());
+
+	static const uint8_t sizes[][2] = { { 100, 60 }, { 255, 255 } };
+	for (int i = 0; i < 2; i++)
+	{
+		World * pWorld = CreateTestWorld("STOREBENCH" + std::to_string(i), sizes[i][0], sizes[i][1]);
+		std::vector<uint8_t> raw;
+		std::vector<uint8_t> data;
+		CHECK(GetWorldStore()->SerializeWorld(pWorld, raw));
+		CHECK(GetWorldStore()->Pack(pWorld, data));
+
+		const int runs = sizes[i][0] > 100 ? 20 : 100;
+		bool bFailed = false;
+		const double serialize = TimeRuns(runs, [&]() { bFailed |= !GetWorldStore()->SerializeWorld(pWorld, raw); });
+		const double pack = TimeRuns(runs, [&]() { bFailed |= !GetWorldStore()->Pack(pWorld, data); });
+		const double unpack = TimeRuns(runs, [&]()
+		{
+			World * pLoaded = GetWorldStore()->Unpack(data.data(), data.size(), pWorld->GetID(), "bench");
+			bFailed |= pLoaded == NULL;
+			delete pLoaded;
+		});
+
+		// through the world file, every save waits until it's on disk
+		const double save = TimeRuns(runs, [&]() { bFailed |= !GetWorldStore()->Save(pWorld); });
+		const double load = TimeRuns(runs, [&]()
+		{
+			World * pLoaded = GetWorldStore()->Load(pWorld->GetID());
+			bFailed |= pLoaded == NULL;
+			delete pLoaded;
+		});
+
+		CHECK(!bFailed);
+
+		const double rawMB = raw.size() / (1024.0 * 1024.0);
+		std::printf("%dx%d world, %d bytes raw, %d bytes packed\n", sizes[i][0], sizes[i][1], (int)raw.size(), (int)data.size());
+		std::printf("  serialize %.2f ms (%.1f MB/s), pack %.2f ms (%.1f MB/s), unpack %.2f ms (%.1f MB/s)\n", serialize, rawMB / serialize * 1000, pack, rawMB / pack * 1000, unpack, rawMB / unpack * 1000);
+		std::printf("  save %.2f ms (%.1f MB/s), load %.2f ms (%.1f MB/s)\n", save, rawMB / save * 1000, load, rawMB / load * 1000);
+		delete pWorld;
+	}
+}
@@ -0,0 +1,27 @@
+#include <BaseApp.h> // precompiled
+#include "Test.h"
+#include "TestWorlds.h"
+
+#include <World/World.h>
+#include <World/WorldStore.h>
+
+// a world file claiming more world data than any world has is rejected before the data is allocated
+TEST(WorldStoreRejectsOversizedWorld)
+{
+	CHECK(InitTestWorldStore());
+
+	World * pWorld = CreateTestWorld("STOREOVERSIZED");
+	std::vector<uint8_t> data;
+	CHECK(GetWorldStore()->Pack(pWorld, data));
+
+	World * pUnpacked = GetWorldStore()->Unpack(data.data(), data.size(), pWorld->GetID(), "packed world");
+	CHECK(pUnpacked != NULL);
+	delete pUnpacked;
+
+	// the uncompressed size follows the magic, the version & the world ID
+	uint32_t rawSize = 0xFFFFFFF0;
+	int offset = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(int);
+	MemorySerializeRaw(rawSize, data.data(), offset, true);
+	CHECK(GetWorldStore()->Unpack(data.data(), data.size(), pWorld->GetID(), "oversized world") == NULL);
+	delete pWorld;
+}
@@ -0,0 +1,47 @@
+#include <BaseApp.h> // precompiled
+#include "Test.h"
+#include "TestWorlds.h"
+
+#include <chrono>
+
+#include <World/WorldTileMap.h>
+
+// microseconds a lock of the power takes to find its tiles in the middle of a random map, with either solver
+static double TimeLock(WorldTileMap* pTileMap, const int& lockPower, const bool& bReference)
+{
+	const uint16_t lockIndex = (uint16_t)(pTileMap->GetWidth() / 2 + pTileMap->GetHeight() / 2 * pTileMap->GetWidth());
+	const int runs = lockPower >= 200 ? 20 : 200;
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < runs; i++)
+	{
+		if (bReference)
+		{
+			AddTilesThisWouldLockReference(pTileMap, lockIndex, lockPower, true);
+		}
+		else
+		{
+			pTileMap->AddTilesThisWouldLock(pTileMap->GetTile(lockIndex), lockPower, true);
+		}
+	}
+
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / runs;
+}
+
+BENCHMARK(WorldTileMapLockBench)
+{
+	CHECK(InitTestItems());
+
+	static const uint8_t sizes[][2] = { { 100, 60 }, { 255, 255 } };
+	static const int lockPowers[] = { 10, 48, 200 };
+	for (int i = 0; i < 2; i++)
+	{
+		WorldTileMap tileMap(sizes[i][0], sizes[i][1]);
+		RandomizeTestTiles(&tileMap, 1);
+		for (int j = 0; j < 3; j++)
+		{
+			const double reference = TimeLock(&tileMap, lockPowers[j], true);
+			const double floodFill = TimeLock(&tileMap, lockPowers[j], false);
+			std::printf("%dx%d lock of %d tiles: square scan %.1f us, flood fill %.1f us (%.1fx)\n", sizes[i][0], sizes[i][1], lockPowers[j], reference, floodFill, reference / floodFill);
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#include <BaseApp.h> // precompiled
+#include "Test.h"
+#include "TestWorlds.h"
+
+#include <World/WorldTileMap.h>
+
+// the flood fill has to lock the very same tiles as the square scan it replaced, on any map & for any lock
+TEST(WorldTileMapLockSameAsReference)
+{
+	CHECK(InitTestItems());
+
+	static const int lockPowers[] = { 10, 48, 200 }; // small, big & huge locks
+	FastRandom rng(1);
+	for (int i = 0; i < 100; i++)
+	{
+		const uint8_t width = (uint8_t)rng.Get(30, 255);
+		const uint8_t height = (uint8_t)rng.Get(30, 255);
+		WorldTileMap tileMap(width, height);
+		WorldTileMap referenceTileMap(width, height);
+		const uint64_t seed = rng.Next();
+		RandomizeTestTiles(&tileMap, seed);
+		RandomizeTestTiles(&referenceTileMap, seed);
+
+		// locks next to the edges too, the old solver wrapped around there
+		const uint16_t lockIndex = (uint16_t)rng.Get(1, tileMap.GetTileCount() - 1);
+		for (int j = 0; j < 2; j++)
+		{
+			// the second time the lock gets a new size & lets go of its tiles first
+			const int lockPower = rng.Chance(4, 1) ? rng.Get(1, 300) : lockPowers[rng.Get(0, 2)];
+			const bool bIgnoreEmptyAir = rng.Chance(2, 1);
+			tileMap.AddTilesThisWouldLock(tileMap.GetTile(lockIndex), lockPower, bIgnoreEmptyAir);
+			AddTilesThisWouldLockReference(&referenceTileMap, lockIndex, lockPower, bIgnoreEmptyAir);
+			CHECK(HasSameLocks(&tileMap, &referenceTileMap));
+		}
+	}
+}